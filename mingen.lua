@@ -10,7 +10,6 @@ mincore = require('deps/mincore')
 stb = require('deps/stb')
 vma = require('deps/vma')
 slang = require('deps/slang')
-yyjson = require('deps/yyjson')
 
 
 include_dirs = merge(
@@ -19,8 +18,7 @@ include_dirs = merge(
 	vulkan.includes,
 	mincore.includes,
 	-- stb.includes
-	vma.includes,
-	yyjson.includes
+	vma.includes
 )
 
 platform_define = {}
@@ -90,14 +88,38 @@ elseif (mg.platform() == 'linux') then
 	platform_deps = merge(wayland.projects, xkb.project, libdecor.project)
 end
 
+-- Runtime shader reload (--shader-dir), which links the Slang compiler into vulkanbox.
+-- Enabled unless VKB_HOT_RELOAD is set to 0.
+hot_reload = os.getenv('VKB_HOT_RELOAD') ~= '0'
+hot_reload_define = {}
+hot_reload_deps = {}
+
+-- Shader compiler, shared by slangrc and the runtime shader reload. Built with the
+-- standard library, unlike vulkanbox.
+local slangrc_lib = mg.project({
+	name = 'slangrc_lib',
+	type = mg.project_type.sources,
+	sources = {'src/slangrc/compiler.cc', 'src/slangrc/reflection.cc'},
+	includes = merge(include_dirs, slang.includes),
+	compile_options = merge('-g', '-std=c++20', '-Wall', '-Wextra', '-Werror', platform_define, platform_compile_options),
+	release = {
+		compile_options = {'-O2'}
+	}
+})
+
+if hot_reload then
+	hot_reload_define = {'-D"VKB_HOT_RELOAD"'}
+	hot_reload_deps = {slangrc_lib, slang.project}
+end
+
 local vkb = mg.project({
 	name = 'vulkanbox',
 	type = mg.project_type.executable,
 	sources = {'src/vkb/**.cc'},
 	includes = include_dirs,
-	compile_options = merge('-g', '-std=c++20', '-Wall', '-Wextra', '-Werror', '-nostdinc++', platform_define, platform_compile_options),
+	compile_options = merge('-g', '-std=c++20', '-Wall', '-Wextra', '-Werror', '-nostdinc++', platform_define, hot_reload_define, platform_compile_options),
 	link_options = merge(platform_link_options, '-g'),
-	dependencies = merge(imgui.project, vulkan.project, mincore.project, yyjson.project, platform_deps),
+	dependencies = merge(imgui.project, vulkan.project, mincore.project, hot_reload_deps, platform_deps),
 	release = {
 		compile_options = {'-O2'}
 	}
@@ -105,6 +127,15 @@ local vkb = mg.project({
 
 remove_platform_sources(vkb)
 
+if not hot_reload then
+	for i=1, #vkb.sources do
+		if string.find(vkb.sources[i].file, 'shader_reloader') ~= nil then
+			table.remove(vkb.sources, i)
+			break
+		end
+	end
+end
+
 for i=1, #vkb.sources do
 	if string.find(vkb.sources[i].file, 'vma') ~= nil then
 		vkb.sources[i].compile_options = string.gsub(vkb.compile_options, ' %-nostdinc%+%+', '')
@@ -114,11 +145,11 @@ end
 local slangrc = mg.project({
 	name = 'slangrc',
 	type = mg.project_type.executable,
-	sources = {'src/slangrc/**.cc'},
+	sources = {'src/slangrc/main.cc'},
 	includes = merge(include_dirs, slang.includes),
 	compile_options = merge('-g', '-std=c++20', '-Wall', '-Wextra', '-Werror', platform_define, platform_compile_options),
 	link_options = merge('-g', platform_link_options),
-	dependencies = merge(slang.project, mincore.project),
+	dependencies = merge(slangrc_lib, slang.project, mincore.project),
 	release = {
 		compile_options = {'-O2'}
 	}
@@ -126,30 +157,92 @@ local slangrc = mg.project({
 
 remove_platform_sources(slangrc)
 
-slangrc_ext = ''
+-- Checks the reflection written by slangrc_lib, run after each build.
+local slangrc_test = mg.project({
+	name = 'slangrc_test',
+	type = mg.project_type.executable,
+	sources = {'src/slangrc/tests/reflection_test.cc'},
+	includes = merge(include_dirs, slang.includes),
+	compile_options = merge('-g', '-std=c++20', '-Wall', '-Wextra', '-Werror', platform_define, platform_compile_options),
+	link_options = merge('-g', platform_link_options),
+	dependencies = merge(slangrc_lib, slang.project, mincore.project),
+	release = {
+		compile_options = {'-O2'}
+	}
+})
+
+local packrc = mg.project({
+	name = 'packrc',
+	type = mg.project_type.executable,
+	sources = {'src/packrc/**.cc'},
+	includes = include_dirs,
+	compile_options = merge('-g', '-std=c++20', '-Wall', '-Wextra', '-Werror', platform_define, platform_compile_options),
+	link_options = merge('-g', platform_link_options),
+	release = {
+		compile_options = {'-O2'}
+	}
+})
+
+remove_platform_sources(packrc)
+
+exe_ext = ''
 if (mg.platform() == 'windows') then
-	slangrc_ext = '.exe'
+	exe_ext = '.exe'
 end
-slangrc_bin = '"' .. mg.get_build_dir() .. 'bin/slangrc' .. slangrc_ext .. '"'
+slangrc_bin = '"' .. mg.get_build_dir() .. 'bin/slangrc' .. exe_ext .. '"'
+packrc_bin = '"' .. mg.get_build_dir() .. 'bin/packrc' .. exe_ext .. '"'
+slangrc_test_bin = '"' .. mg.get_build_dir() .. 'bin/slangrc_test' .. exe_ext .. '"'
+
+mg.add_post_build_cmd(slangrc_test, {
+	input = {'src/slangrc/tests/struct_array.slang'},
+	output = mg.get_build_dir() .. 'slangrc_test.stamp',
+	cmd = slangrc_test_bin .. ' ${in} ${out}'
+})
+
+-- Packed resources, named after their path relative to bin/
+pack_inputs = {}
+
+-- Shaders are compiled by a single slangrc process, which only recompiles the ones
+-- whose sources or includes changed since the last run.
 shaders = mg.collect_files('res/shaders/*.slang')
+shader_outputs = {}
 for i=1,#shaders do
 	spirv = mg.get_build_dir() .. 'bin/' .. string.gsub(shaders[i], '.slang', '.spv')
-	mg.add_post_build_cmd(slangrc, {
-		input = shaders[i],
-		output = spirv,
-		cmd = slangrc_bin .. ' ${in} ${out}'
-	})
+	table.insert(shader_outputs, spirv)
+	table.insert(shader_outputs, spirv .. '.refl')
 end
+mg.add_post_build_cmd(slangrc, {
+	input = shaders,
+	output = shader_outputs,
+	cmd = slangrc_bin .. ' --batch "' .. mg.get_build_dir() .. 'bin/res/shaders" ${in}'
+})
+pack_inputs = merge(pack_inputs, shader_outputs)
 
--- Textures
+-- Textures, also baked to .vtex, uploaded without decoding
 textures = mg.collect_files('res/textures/*.png')
 for i=1,#textures do
 	mg.add_post_build_copy(vkb, {
 		input = textures[i],
 		output = mg.get_build_dir() .. 'bin/' .. textures[i];
 	})
+	table.insert(pack_inputs, textures[i])
+
+	baked = mg.get_build_dir() .. 'bin/' .. string.gsub(textures[i], '%.png$', '.vtex')
+	mg.add_post_build_cmd(packrc, {
+		input = textures[i],
+		output = baked,
+		cmd = packrc_bin .. ' --texture ${in} ${out}'
+	})
+	table.insert(pack_inputs, baked)
 end
 
+-- Loose files are kept next to the pack, as fallback for resources missing from it
+mg.add_post_build_cmd(packrc, {
+	input = pack_inputs,
+	output = mg.get_build_dir() .. 'bin/res.pack',
+	cmd = packrc_bin .. ' ${out} "' .. mg.get_build_dir() .. 'bin/" ${in}'
+})
+
 if mg.need_generate() then
-	mg.generate({vkb, slangrc})
+	mg.generate({vkb, slangrc, slangrc_test, packrc})
 end
\ No newline at end of file
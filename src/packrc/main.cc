@@ -0,0 +1,152 @@
+#include "texture.hh"
+
+#include <vkb/core/pack_format.hh>
+
+#include <algorithm>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	struct file_entry
+	{
+		char const*             path;
+		char const*             name;
+		vkb::pack_format::entry entry;
+	};
+
+	bool write_padding(FILE* out, uint64_t& off)
+	{
+		uint8_t  zeros[vkb::pack_format::alignment] {};
+		uint64_t pad = (vkb::pack_format::alignment - off % vkb::pack_format::alignment) %
+		               vkb::pack_format::alignment;
+		off += pad;
+		return fwrite(zeros, 1, pad, out) == pad;
+	}
+
+	bool write_file(FILE* out, file_entry& file, uint64_t& off)
+	{
+		FILE* in = fopen(file.path, "rb");
+		if (!in)
+		{
+			fprintf(stderr, "Could not open %s\n", file.path);
+			return false;
+		}
+
+		file.entry.off = off;
+		file.entry.size = 0;
+
+		uint8_t  buf[64 * 1024];
+		uint64_t read;
+		while ((read = fread(buf, 1, sizeof(buf), in)) > 0)
+		{
+			if (fwrite(buf, 1, read, out) != read)
+			{
+				fclose(in);
+				return false;
+			}
+			file.entry.size += read;
+		}
+		fclose(in);
+
+		off += file.entry.size;
+		return write_padding(out, off);
+	}
+}
+
+// packrc <out> <root> <files...>
+// Entries are named after their path relative to root, or the path itself when
+// outside of root, which matches the paths used by the runtime to load resources.
+// packrc --texture <in> <out>
+// Bakes the image in, so the runtime uploads it without decoding.
+int main(int argc, char** argv)
+{
+	if (argc == 4 && strcmp(argv[1], "--texture") == 0)
+		return bake_texture(argv[2], argv[3]) ? 0 : 1;
+
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: packrc <out> <root> <files...>\n"
+		                "       packrc --texture <in> <out>\n");
+		return 1;
+	}
+
+	char const* root = argv[2];
+	uint64_t    root_len = strlen(root);
+
+	std::vector<file_entry> files;
+	for (int i {3}; i < argc; ++i)
+	{
+		file_entry file {.path = argv[i], .name = argv[i], .entry = {}};
+		if (strncmp(file.path, root, root_len) == 0)
+			file.name = file.path + root_len;
+		while (*file.name == '/')
+			++file.name;
+		file.entry.hash = vkb::pack_format::hash(file.name, strlen(file.name));
+		files.push_back(file);
+	}
+
+	std::sort(files.begin(), files.end(), [](file_entry const& a, file_entry const& b)
+	{
+		return a.entry.hash < b.entry.hash;
+	});
+	for (uint64_t i {1}; i < files.size(); ++i)
+	{
+		if (files[i].entry.hash == files[i - 1].entry.hash)
+		{
+			fprintf(stderr, "Hash collision between %s and %s\n", files[i - 1].name,
+			        files[i].name);
+			return 1;
+		}
+	}
+
+	FILE* out = fopen(argv[1], "wb");
+	if (!out)
+	{
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	vkb::pack_format::header header {.magic = vkb::pack_format::magic,
+	                                 .version = vkb::pack_format::version,
+	                                 .toc_off = 0,
+	                                 .entry_cnt = static_cast<uint32_t>(files.size()),
+	                                 .pad = 0};
+	uint64_t off = sizeof(header);
+	bool res = fwrite(&header, sizeof(header), 1, out) == 1;
+	res = res && write_padding(out, off);
+	for (uint64_t i {0}; res && i < files.size(); ++i)
+		res = write_file(out, files[i], off);
+
+	header.toc_off = off;
+	uint64_t name_off = off + files.size() * sizeof(vkb::pack_format::entry);
+	for (uint64_t i {0}; i < files.size(); ++i)
+	{
+		files[i].entry.name_off = name_off;
+		files[i].entry.name_len = strlen(files[i].name);
+		name_off += files[i].entry.name_len;
+	}
+	for (uint64_t i {0}; res && i < files.size(); ++i)
+		res = fwrite(&files[i].entry, sizeof(files[i].entry), 1, out) == 1;
+	for (uint64_t i {0}; res && i < files.size(); ++i)
+	{
+		uint64_t len = files[i].entry.name_len;
+		res = fwrite(files[i].name, 1, len, out) == len;
+	}
+
+	res = res && fseek(out, 0, SEEK_SET) == 0;
+	res = res && fwrite(&header, sizeof(header), 1, out) == 1;
+	fclose(out);
+
+	if (!res)
+	{
+		fprintf(stderr, "Could not write %s\n", argv[1]);
+		remove(argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
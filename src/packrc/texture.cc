@@ -0,0 +1,160 @@
+#include "texture.hh"
+
+#include <vkb/core/texture_format.hh>
+
+#include <vulkan/vulkan.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <vector>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace
+{
+	struct level
+	{
+		uint32_t             w;
+		uint32_t             h;
+		std::vector<uint8_t> pixels;
+	};
+
+	float to_linear(uint8_t v)
+	{
+		float c = v / 255.f;
+		return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	uint8_t to_srgb(float c)
+	{
+		float v = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.f / 2.4f) - 0.055f;
+		v = v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+		return static_cast<uint8_t>(v * 255.f + 0.5f);
+	}
+
+	// 2x2 box filter, in linear space for the color channels. Odd sizes repeat their
+	// last row or column.
+	level downsample(level const& src)
+	{
+		level dst {.w = src.w > 1 ? src.w / 2 : 1,
+		           .h = src.h > 1 ? src.h / 2 : 1,
+		           .pixels = {}};
+		dst.pixels.resize(static_cast<uint64_t>(dst.w) * dst.h * 4);
+
+		for (uint32_t y {0}; y < dst.h; ++y)
+		{
+			uint32_t y0 = y * 2 < src.h ? y * 2 : src.h - 1;
+			uint32_t y1 = y * 2 + 1 < src.h ? y * 2 + 1 : src.h - 1;
+			for (uint32_t x {0}; x < dst.w; ++x)
+			{
+				uint32_t x0 = x * 2 < src.w ? x * 2 : src.w - 1;
+				uint32_t x1 = x * 2 + 1 < src.w ? x * 2 + 1 : src.w - 1;
+
+				uint8_t const* texels[4] {
+					&src.pixels[(static_cast<uint64_t>(y0) * src.w + x0) * 4],
+					&src.pixels[(static_cast<uint64_t>(y0) * src.w + x1) * 4],
+					&src.pixels[(static_cast<uint64_t>(y1) * src.w + x0) * 4],
+					&src.pixels[(static_cast<uint64_t>(y1) * src.w + x1) * 4]};
+
+				uint8_t* out = &dst.pixels[(static_cast<uint64_t>(y) * dst.w + x) * 4];
+				for (uint32_t c {0}; c < 3; ++c)
+				{
+					float sum {0.f};
+					for (uint32_t i {0}; i < 4; ++i)
+						sum += to_linear(texels[i][c]);
+					out[c] = to_srgb(sum / 4.f);
+				}
+
+				uint32_t alpha {0};
+				for (uint32_t i {0}; i < 4; ++i)
+					alpha += texels[i][3];
+				out[3] = static_cast<uint8_t>((alpha + 2) / 4);
+			}
+		}
+
+		return dst;
+	}
+
+	uint64_t align(uint64_t off)
+	{
+		return (off + vkb::texture_format::alignment - 1) &
+		       ~(vkb::texture_format::alignment - 1);
+	}
+
+	bool write_padding(FILE* out, uint64_t& off, uint64_t target)
+	{
+		uint8_t  zeros[vkb::texture_format::alignment] {};
+		uint64_t pad = target - off;
+		off = target;
+		return fwrite(zeros, 1, pad, out) == pad;
+	}
+}
+
+bool bake_texture(char const* in, char const* out)
+{
+	int32_t  w, h, c;
+	uint8_t* pix = stbi_load(in, &w, &h, &c, STBI_rgb_alpha);
+	if (!pix)
+	{
+		fprintf(stderr, "Could not decode %s (%s)\n", in, stbi_failure_reason());
+		return false;
+	}
+
+	std::vector<level> lvls(1);
+	lvls[0].w = w;
+	lvls[0].h = h;
+	lvls[0].pixels.assign(pix, pix + static_cast<uint64_t>(w) * h * 4);
+	stbi_image_free(pix);
+
+	while ((lvls.back().w > 1 || lvls.back().h > 1) &&
+	       lvls.size() < vkb::texture_format::max_levels)
+		lvls.push_back(downsample(lvls.back()));
+
+	vkb::texture_format::header header {.magic = vkb::texture_format::magic,
+	                                    .version = vkb::texture_format::version,
+	                                    .format = VK_FORMAT_R8G8B8A8_SRGB,
+	                                    .w = lvls[0].w,
+	                                    .h = lvls[0].h,
+	                                    .lvl_cnt = static_cast<uint32_t>(lvls.size())};
+
+	std::vector<vkb::texture_format::level> table(lvls.size());
+	uint64_t off = align(sizeof(header) + table.size() * sizeof(table[0]));
+	for (uint64_t i {0}; i < lvls.size(); ++i)
+	{
+		table[i] = {.off = off, .size = lvls[i].pixels.size()};
+		off = align(off + table[i].size);
+	}
+
+	FILE* file = fopen(out, "wb");
+	if (!file)
+	{
+		fprintf(stderr, "Could not open %s\n", out);
+		return false;
+	}
+
+	off = 0;
+	bool res = fwrite(&header, sizeof(header), 1, file) == 1;
+	res = res &&
+	      fwrite(table.data(), sizeof(table[0]), table.size(), file) == table.size();
+	off += sizeof(header) + table.size() * sizeof(table[0]);
+	for (uint64_t i {0}; res && i < lvls.size(); ++i)
+	{
+		res = write_padding(file, off, table[i].off);
+		res = res &&
+		      fwrite(lvls[i].pixels.data(), 1, table[i].size, file) == table[i].size;
+		off += table[i].size;
+	}
+	fclose(file);
+
+	if (!res)
+	{
+		fprintf(stderr, "Could not write %s\n", out);
+		remove(out);
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
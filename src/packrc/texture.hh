@@ -0,0 +1,5 @@
+#pragma once
+
+// Decodes the image in, and writes it to out as a baked texture (see
+// vkb/core/texture_format.hh), in R8G8B8A8_SRGB with its full mip chain.
+bool bake_texture(char const* in, char const* out);
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "compiler.hh"
+#include "reflection.hh"
+
+#include <slang/slang-com-ptr.h>
+#include <slang/slang.h>
+
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace slangrc
+{
+	struct compiler
+	{
+		Slang::ComPtr<slang::IGlobalSession> global_session;
+	};
+
+	namespace
+	{
+		bool print_diagnostics(slang::IBlob* diagnostics)
+		{
+			if (!diagnostics)
+				return false;
+
+			fprintf(stderr, "%s\n", (char const*)diagnostics->getBufferPointer());
+			return true;
+		}
+
+		blob copy_blob(void const* data, uint64_t size)
+		{
+			blob res;
+			res.data = static_cast<uint8_t*>(malloc(size));
+			if (res.data)
+			{
+				memcpy(res.data, data, size);
+				res.size = size;
+			}
+			return res;
+		}
+	}
+
+	compiler* create_compiler()
+	{
+		compiler* comp = new compiler;
+		if (SLANG_FAILED(slang::createGlobalSession(comp->global_session.writeRef())))
+		{
+			delete comp;
+			return nullptr;
+		}
+
+		return comp;
+	}
+
+	void destroy_compiler(compiler* comp)
+	{
+		delete comp;
+	}
+
+	bool compile(compiler* comp, char const* path, output& out, dep_fn on_dep, void* user)
+	{
+		slang::CompilerOptionEntry entries[] = {
+			{.name = slang::CompilerOptionName::VulkanUseEntryPointName,
+			 .value = {.intValue0 = 1}}
+		};
+		slang::SessionDesc desc {};
+		desc.compilerOptionEntries = entries;
+		desc.compilerOptionEntryCount =
+			sizeof(entries) / sizeof(slang::CompilerOptionEntry);
+		slang::TargetDesc targetDesc = {};
+		targetDesc.format = SLANG_SPIRV;
+		targetDesc.profile = comp->global_session->findProfile("spirv_1_6");
+		targetDesc.flags = SLANG_TARGET_FLAG_GENERATE_SPIRV_DIRECTLY;
+		desc.targetCount = 1;
+		desc.targets = &targetDesc;
+
+		Slang::ComPtr<slang::ISession> session;
+		comp->global_session->createSession(desc, session.writeRef());
+		if (!session)
+			return false;
+		Slang::ComPtr<slang::IBlob>   diagnostics;
+		Slang::ComPtr<slang::IModule> mod {
+			session->loadModule(path, diagnostics.writeRef())};
+
+		if (print_diagnostics(diagnostics) || !mod)
+			return false;
+
+		if (on_dep)
+		{
+			for (int32_t i {0}; i < mod->getDependencyFileCount(); ++i)
+			{
+				char const* dep = mod->getDependencyFilePath(i);
+				if (strcmp(dep, path) != 0)
+					on_dep(dep, user);
+			}
+		}
+
+		int32_t entry_points = mod->getDefinedEntryPointCount();
+
+		std::vector<slang::IComponentType*> comps(entry_points + 1);
+		comps[0] = mod;
+		for (int32_t i {0}; i < entry_points; ++i)
+		{
+			slang::IEntryPoint* entry;
+			mod->getDefinedEntryPoint(i, &entry);
+			comps[1 + i] = entry;
+		}
+		Slang::ComPtr<slang::IComponentType> prog;
+		session->createCompositeComponentType(comps.data(), entry_points + 1,
+		                                      prog.writeRef());
+		for (int32_t i {1}; i < entry_points + 1; ++i)
+			comps[i]->release();
+
+		Slang::ComPtr<slang::IComponentType> linkedProgram;
+
+		prog->link(linkedProgram.writeRef(), diagnostics.writeRef());
+		if (print_diagnostics(diagnostics))
+			return false;
+
+		Slang::ComPtr<slang::IBlob> spv;
+		linkedProgram->getTargetCode(0, spv.writeRef(), diagnostics.writeRef());
+		if (print_diagnostics(diagnostics))
+			return false;
+
+		std::vector<uint8_t> reflection;
+		if (!build_reflection(linkedProgram, reflection))
+			return false;
+
+		out.spirv = copy_blob(spv->getBufferPointer(), spv->getBufferSize());
+		out.reflection = copy_blob(reflection.data(), reflection.size());
+		if (!out.spirv.data || !out.reflection.data)
+		{
+			free_output(out);
+			return false;
+		}
+
+		return true;
+	}
+
+	void free_output(output& out)
+	{
+		free(out.spirv.data);
+		free(out.reflection.data);
+		out = {};
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// Shader compiler library, used by the slangrc tool and by the runtime to reload
+// shaders. This header doesn't depend on the standard library, so it can be included
+// from the runtime.
+namespace slangrc
+{
+	// Owns a Slang global session, which isn't thread safe: each thread compiling
+	// shaders needs its own compiler. Each compilation uses its own session.
+	struct compiler;
+
+	compiler* create_compiler();
+	void      destroy_compiler(compiler* comp);
+
+	// Allocated with malloc.
+	struct blob
+	{
+		uint8_t* data {nullptr};
+		uint64_t size {0};
+	};
+
+	struct output
+	{
+		blob spirv;
+		// In the format described in vkb/vk/reflection_format.hh.
+		blob reflection;
+	};
+
+	using dep_fn = void (*)(char const* path, void* user);
+
+	// Compiles the shader at path, reporting every file it depends on except itself
+	// to on_dep. Diagnostics are printed to stderr.
+	bool compile(compiler* comp, char const* path, output& out, dep_fn on_dep = nullptr,
+	             void* user = nullptr);
+	void free_output(output& out);
+}
@@ -1,97 +1,301 @@
-#include <slang/slang-com-ptr.h>
+#include "compiler.hh"
+
+#include <vkb/vk/reflection_format.hh>
+
 #include <slang/slang.h>
 
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
+namespace
 {
-	if (argc < 3)
-		return 1;
-	Slang::ComPtr<slang::IGlobalSession> global_session;
-	slang::createGlobalSession(global_session.writeRef());
-
-	slang::CompilerOptionEntry entries[] = {
-		{.name = slang::CompilerOptionName::VulkanUseEntryPointName,
-	     .value = {.intValue0 = 1}}
-    };
-	slang::SessionDesc desc {};
-	desc.compilerOptionEntries = entries;
-	desc.compilerOptionEntryCount = sizeof(entries) / sizeof(slang::CompilerOptionEntry);
-	slang::TargetDesc targetDesc = {};
-	targetDesc.format = SLANG_SPIRV;
-	targetDesc.profile = global_session->findProfile("spirv_1_6");
-	targetDesc.flags = SLANG_TARGET_FLAG_GENERATE_SPIRV_DIRECTLY;
-	desc.targetCount = 1;
-	desc.targets = &targetDesc;
-
-	Slang::ComPtr<slang::ISession> session;
-	global_session->createSession(desc, session.writeRef());
-	Slang::ComPtr<slang::IBlob>   diagnostics;
-	Slang::ComPtr<slang::IModule> mod {
-		session->loadModule(argv[1], diagnostics.writeRef())};
-
-	if (diagnostics)
-	{
-		fprintf(stderr, "%s\n", (char const*)diagnostics->getBufferPointer());
-		return 1;
-	}
+	// Anything changing the generated code must be part of it, to invalidate stamps.
+	constexpr char const* options_desc {"spirv_1_6;direct;entry_point_names"};
 
-	int32_t entry_points = mod->getDefinedEntryPointCount();
+	struct shader
+	{
+		std::string              in;
+		std::string              out;
+		std::vector<std::string> deps;
+		uint64_t                 hash {0};
+		bool                     dirty {true};
+		bool                     compiled {false};
+	};
 
-	slang::IComponentType** comps = new slang::IComponentType*[entry_points + 1];
-	comps[0] = mod;
-	for (int32_t i {0}; i < entry_points; ++i)
+	uint64_t hash_bytes(uint64_t hash, void const* data, uint64_t size)
 	{
-		slang::IEntryPoint* entry;
-		mod->getDefinedEntryPoint(i, &entry);
-		comps[1 + i] = entry;
+		uint8_t const* bytes = static_cast<uint8_t const*>(data);
+		for (uint64_t i {0}; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3;
+		}
+
+		return hash;
 	}
-	Slang::ComPtr<slang::IComponentType> prog;
-	session->createCompositeComponentType(comps, entry_points + 1, prog.writeRef());
-	for (int32_t i {1}; i < entry_points + 1; ++i)
-		comps[i]->release();
 
-	Slang::ComPtr<slang::IComponentType> linkedProgram;
+	bool hash_file(uint64_t& hash, char const* path)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file)
+			return false;
+
+		uint8_t  buf[64 * 1024];
+		uint64_t read;
+		while ((read = fread(buf, 1, sizeof(buf), file)) > 0)
+			hash = hash_bytes(hash, buf, read);
+		fclose(file);
+
+		return true;
+	}
 
-	prog->link(linkedProgram.writeRef(), diagnostics.writeRef());
-	if (diagnostics)
+	// Hash of the options, the source and all its dependencies, from the last
+	// compilation. Returns 0 if a file is missing.
+	uint64_t hash_shader(shader const& sh)
 	{
-		fprintf(stderr, "%s\n", (char const*)diagnostics->getBufferPointer());
-		return 1;
+		uint64_t hash {0xcbf29ce484222325};
+		hash = hash_bytes(hash, options_desc, strlen(options_desc));
+		char const* build_tag = spGetBuildTagString();
+		hash = hash_bytes(hash, build_tag, strlen(build_tag));
+		uint32_t refl_version = vkb::vk::reflection_format::version;
+		hash = hash_bytes(hash, &refl_version, sizeof(refl_version));
+
+		if (!hash_file(hash, sh.in.c_str()))
+			return 0;
+		for (uint64_t i {0}; i < sh.deps.size(); ++i)
+		{
+			hash = hash_bytes(hash, sh.deps[i].c_str(), sh.deps[i].size());
+			if (!hash_file(hash, sh.deps[i].c_str()))
+				return 0;
+		}
+
+		return hash;
 	}
 
-	slang::ProgramLayout*       layout = prog->getLayout(0);
-	Slang::ComPtr<slang::IBlob> reflect;
-	layout->toJson(reflect.writeRef());
+	bool write_file(char const* path, void const* data, uint64_t size)
+	{
+		FILE* file = fopen(path, "wb");
+		if (!file)
+		{
+			fprintf(stderr, "Could not open %s\n", path);
+			return false;
+		}
 
-	Slang::ComPtr<slang::IBlob> spv;
-	linkedProgram->getTargetCode(0, spv.writeRef(), diagnostics.writeRef());
-	if (diagnostics)
+		bool res = fwrite(data, 1, size, file) == size;
+		fclose(file);
+		return res;
+	}
+
+	// Compiles sh.in into its SPIR-V and binary reflection, and fills its dependencies.
+	bool compile(slangrc::compiler* comp, shader& sh)
 	{
-		fprintf(stderr, "%s\n", (char const*)diagnostics->getBufferPointer());
-		return 1;
+		sh.deps.clear();
+		slangrc::output out;
+		bool            res = slangrc::compile(
+            comp, sh.in.c_str(), out,
+            [](char const* dep, void* user)
+            {
+                static_cast<std::vector<std::string>*>(user)->push_back(dep);
+            },
+            &sh.deps);
+		std::sort(sh.deps.begin(), sh.deps.end());
+		if (!res)
+			return false;
+
+		std::string refl_path = sh.out + ".refl";
+		res = write_file(sh.out.c_str(), out.spirv.data, out.spirv.size) &&
+		      write_file(refl_path.c_str(), out.reflection.data, out.reflection.size);
+		slangrc::free_output(out);
+		return res;
 	}
 
-	FILE* file = fopen(argv[2], "wb");
-	if (file)
+	// Stamp file format, one block per shader:
+	// shader <hash> <in>
+	// dep <path>
+	void read_stamps(char const* path, std::vector<shader>& shaders)
 	{
-		uint64_t s = spv->getBufferSize();
-		fwrite(spv->getBufferPointer(), 1, s, file);
+		FILE* file = fopen(path, "rb");
+		if (!file)
+			return;
+
+		shader* current {nullptr};
+		char    line[4096];
+		while (fgets(line, sizeof(line), file))
+		{
+			uint64_t len = strlen(line);
+			if (len && line[len - 1] == '\n')
+				line[--len] = '\0';
+
+			if (strncmp(line, "shader ", 7) == 0)
+			{
+				char*    path_start;
+				uint64_t hash = strtoull(line + 7, &path_start, 16);
+				current = nullptr;
+				for (uint64_t i {0}; i < shaders.size(); ++i)
+				{
+					if (shaders[i].in == path_start + 1)
+					{
+						current = &shaders[i];
+						current->hash = hash;
+						current->deps.clear();
+						break;
+					}
+				}
+			}
+			else if (strncmp(line, "dep ", 4) == 0 && current)
+				current->deps.push_back(line + 4);
+		}
+
 		fclose(file);
 	}
-	char* jsonFilePath = new char[strlen(argv[2]) + 6];
-	strcpy(jsonFilePath, argv[2]);
-	strcat(jsonFilePath, ".json");
-	file = fopen(jsonFilePath, "wb");
-	if (file)
+
+	bool write_stamps(char const* path, std::vector<shader> const& shaders)
 	{
-		fwrite(reflect->getBufferPointer(), 1, reflect->getBufferSize(), file);
+		FILE* file = fopen(path, "wb");
+		if (!file)
+			return false;
+
+		for (uint64_t i {0}; i < shaders.size(); ++i)
+		{
+			// Failed shaders are left out, to be compiled again on the next run.
+			if (shaders[i].dirty && !shaders[i].compiled)
+				continue;
+
+			fprintf(file, "shader %016llx %s\n",
+			        static_cast<unsigned long long>(shaders[i].hash),
+			        shaders[i].in.c_str());
+			for (uint64_t j {0}; j < shaders[i].deps.size(); ++j)
+				fprintf(file, "dep %s\n", shaders[i].deps[j].c_str());
+		}
+
 		fclose(file);
+		return true;
+	}
+
+	// slangrc --batch <out_dir> <shaders or directories...>
+	// Compiles all shaders in out_dir, skipping the ones unchanged since the last
+	// run. Slang global sessions aren't thread safe, so each worker creates its own
+	// and reuses it for all the shaders it compiles.
+	int batch(int argc, char** argv)
+	{
+		namespace fs = std::filesystem;
+
+		fs::path            out_dir = argv[2];
+		std::vector<shader> shaders;
+		auto                add_shader = [&](fs::path const& in)
+		{
+			shader& sh = shaders.emplace_back();
+			sh.in = in.generic_string();
+			sh.out = (out_dir / in.stem()).generic_string() + ".spv";
+		};
+
+		for (int i {3}; i < argc; ++i)
+		{
+			std::error_code err;
+			if (fs::is_directory(argv[i], err))
+			{
+				std::vector<fs::path> files;
+				for (fs::directory_entry const& entry : fs::directory_iterator(argv[i]))
+					if (entry.is_regular_file() && entry.path().extension() == ".slang")
+						files.push_back(entry.path());
+				std::sort(files.begin(), files.end());
+				for (uint64_t j {0}; j < files.size(); ++j)
+					add_shader(files[j]);
+			}
+			else
+				add_shader(argv[i]);
+		}
+
+		std::error_code err;
+		fs::create_directories(out_dir, err);
+		std::string stamp_path = (out_dir / "slangrc.stamp").generic_string();
+		read_stamps(stamp_path.c_str(), shaders);
+
+		std::vector<shader*> dirty;
+		for (uint64_t i {0}; i < shaders.size(); ++i)
+		{
+			shader& sh = shaders[i];
+			uint64_t hash = sh.hash ? hash_shader(sh) : 0;
+			sh.dirty = !hash || hash != sh.hash || !fs::exists(sh.out, err) ||
+			           !fs::exists(sh.out + ".refl", err);
+			if (sh.dirty)
+				dirty.push_back(&sh);
+		}
+
+		std::atomic<uint64_t> next {0};
+		auto                  work = [&]()
+		{
+			slangrc::compiler* comp {nullptr};
+			for (uint64_t i = next++; i < dirty.size(); i = next++)
+			{
+				if (!comp)
+					comp = slangrc::create_compiler();
+
+				shader& sh = *dirty[i];
+				sh.compiled = comp && compile(comp, sh);
+				if (sh.compiled)
+					sh.hash = hash_shader(sh);
+				else
+					fprintf(stderr, "Failed to compile %s\n", sh.in.c_str());
+			}
+
+			if (comp)
+				slangrc::destroy_compiler(comp);
+		};
+
+		uint64_t worker_cnt = std::thread::hardware_concurrency();
+		worker_cnt = std::min<uint64_t>(worker_cnt ? worker_cnt : 1, dirty.size());
+		std::vector<std::thread> workers;
+		for (uint64_t i {1}; i < worker_cnt; ++i)
+			workers.emplace_back(work);
+		if (worker_cnt)
+			work();
+		for (uint64_t i {0}; i < workers.size(); ++i)
+			workers[i].join();
+
+		int res {0};
+		for (uint64_t i {0}; i < dirty.size(); ++i)
+			if (!dirty[i]->compiled)
+				res = 1;
+
+		if (!write_stamps(stamp_path.c_str(), shaders))
+		{
+			fprintf(stderr, "Could not write %s\n", stamp_path.c_str());
+			res = 1;
+		}
+
+		printf("slangrc: %zu compiled, %zu up-to-date\n", dirty.size(),
+		       shaders.size() - dirty.size());
+		return res;
 	}
-	delete[] jsonFilePath;
-	delete[] comps;
+}
+
+// slangrc <in> <out>
+// slangrc --batch <out_dir> <shaders or directories...>
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+		return 1;
+
+	if (strcmp(argv[1], "--batch") == 0)
+		return batch(argc, argv);
+
+	shader sh;
+	sh.in = argv[1];
+	sh.out = argv[2];
+
+	slangrc::compiler* comp = slangrc::create_compiler();
+	bool               res = comp && compile(comp, sh);
+	if (comp)
+		slangrc::destroy_compiler(comp);
 
-	return 0;
+	return res ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "reflection.hh"
+
+#include <vkb/vk/reflection_format.hh>
+
+#include <vulkan/vulkan_core.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace rf = vkb::vk::reflection_format;
+
+using kind = slang::TypeReflection::Kind;
+using scalar_kind = slang::TypeReflection::ScalarType;
+
+namespace
+{
+	struct writer
+	{
+		std::vector<char>                         strings;
+		std::unordered_map<std::string, uint32_t> interned;
+
+		std::vector<rf::set>          sets;
+		std::vector<rf::binding>      bindings;
+		std::vector<rf::member>       members;
+		std::vector<rf::push_range>   push_ranges;
+		std::vector<rf::entry_point>  entry_points;
+		std::vector<rf::vertex_input> vertex_inputs;
+		std::vector<rf::constant>     constants;
+
+		uint32_t intern(std::string const& str)
+		{
+			auto it = interned.find(str);
+			if (it != interned.end())
+				return it->second;
+
+			uint32_t off = strings.size();
+			strings.insert(strings.end(), str.c_str(), str.c_str() + str.size() + 1);
+			interned.emplace(str, off);
+			return off;
+		}
+	};
+
+	uint32_t stage_flag(SlangStage stage)
+	{
+		switch (stage)
+		{
+			case SLANG_STAGE_VERTEX: return VK_SHADER_STAGE_VERTEX_BIT;
+			case SLANG_STAGE_HULL: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case SLANG_STAGE_DOMAIN: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case SLANG_STAGE_GEOMETRY: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case SLANG_STAGE_FRAGMENT: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case SLANG_STAGE_COMPUTE: return VK_SHADER_STAGE_COMPUTE_BIT;
+			default: return 0;
+		}
+	}
+
+	rf::scalar_type scalar(scalar_kind type)
+	{
+		switch (type)
+		{
+			case scalar_kind::Float32: return rf::scalar_type::float32;
+			case scalar_kind::Int32: return rf::scalar_type::int32;
+			case scalar_kind::UInt32: return rf::scalar_type::uint32;
+			default: return rf::scalar_type::other;
+		}
+	}
+
+	// Only 32 bits scalars and vectors are supported as vertex inputs.
+	uint32_t vertex_format(rf::scalar_type type, uint32_t cols)
+	{
+		static constexpr VkFormat formats[3][4] {
+			{VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT,
+			 VK_FORMAT_R32G32B32A32_SFLOAT},
+			{VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT,
+			 VK_FORMAT_R32G32B32A32_SINT},
+			{VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT,
+			 VK_FORMAT_R32G32B32A32_UINT},
+		};
+
+		if (type == rf::scalar_type::other || cols < 1 || cols > 4)
+			return VK_FORMAT_UNDEFINED;
+
+		return formats[static_cast<uint32_t>(type)][cols - 1];
+	}
+
+	VkDescriptorType resource_type(slang::TypeLayoutReflection* type)
+	{
+		SlangResourceShape  shape = type->getResourceShape();
+		SlangResourceAccess access = type->getResourceAccess();
+		switch (shape & SLANG_RESOURCE_BASE_SHAPE_MASK)
+		{
+			case SLANG_TEXTURE_1D:
+			case SLANG_TEXTURE_2D:
+			case SLANG_TEXTURE_3D:
+			case SLANG_TEXTURE_CUBE:
+				return access == SLANG_RESOURCE_ACCESS_READ
+				           ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+				           : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			case SLANG_STRUCTURED_BUFFER:
+			case SLANG_BYTE_ADDRESS_BUFFER: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			default: return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		}
+	}
+
+	// What read_fields adds.
+	constexpr uint32_t read_members {1};
+	constexpr uint32_t read_bindings {2};
+
+	// Adds the bindings and uniform members of a struct, offsets being relative to
+	// the set. Inside arrays of structs, each binding is an array of count
+	// descriptors, and members are listed per element ("lights[1].color").
+	void read_fields(writer& w, slang::TypeLayoutReflection* type, uint32_t binding_off,
+	                 uint32_t uniform_off, uint32_t count, uint32_t what,
+	                 std::string const& prefix)
+	{
+		for (uint32_t i {0}; i < type->getFieldCount(); ++i)
+		{
+			slang::VariableLayoutReflection* field = type->getFieldByIndex(i);
+			slang::TypeLayoutReflection*     field_type = field->getTypeLayout();
+
+			std::string name = prefix + field->getName();
+			uint32_t    binding {binding_off};
+			binding += field->getOffset(SLANG_PARAMETER_CATEGORY_DESCRIPTOR_TABLE_SLOT);
+			uint32_t offset {uniform_off};
+			offset += field->getOffset(SLANG_PARAMETER_CATEGORY_UNIFORM);
+
+			uint32_t                     field_cnt {count};
+			slang::TypeLayoutReflection* elem_type = field_type;
+			if (field_type->getKind() == kind::Array)
+			{
+				slang::TypeLayoutReflection* arr_elem =
+					field_type->getElementTypeLayout();
+				uint32_t                     arr_cnt = field_type->getElementCount();
+				if (arr_elem->getKind() == kind::Struct)
+				{
+					uint32_t stride =
+						field_type->getElementStride(SLANG_PARAMETER_CATEGORY_UNIFORM);
+					for (uint32_t j {0}; (what & read_members) && j < arr_cnt; ++j)
+					{
+						std::string elem_name = name + "[" + std::to_string(j) + "].";
+						read_fields(w, arr_elem, binding, offset + j * stride, count,
+						            read_members, elem_name);
+					}
+					if (what & read_bindings)
+						read_fields(w, arr_elem, binding, offset, count * arr_cnt,
+						            read_bindings, name + ".");
+					continue;
+				}
+
+				if (field_type->getSize(SLANG_PARAMETER_CATEGORY_UNIFORM) == 0)
+				{
+					field_cnt = count * arr_cnt;
+					elem_type = arr_elem;
+				}
+			}
+
+			VkDescriptorType desc_type {VK_DESCRIPTOR_TYPE_MAX_ENUM};
+			switch (elem_type->getKind())
+			{
+				case kind::Struct:
+					read_fields(w, elem_type, binding, offset, count, what, name + ".");
+					break;
+
+				case kind::Scalar:
+				case kind::Vector:
+				case kind::Matrix:
+				case kind::Array:
+				{
+					if (!(what & read_members))
+						break;
+
+					rf::member member {};
+					member.name = w.intern(name);
+					member.offset = offset;
+					member.size = field_type->getSize(SLANG_PARAMETER_CATEGORY_UNIFORM);
+					member.type = scalar(field_type->getScalarType());
+					member.rows = field_type->getRowCount();
+					member.cols = field_type->getColumnCount();
+					w.members.push_back(member);
+					break;
+				}
+
+				case kind::Resource:
+					desc_type = resource_type(elem_type);
+					break;
+				case kind::SamplerState:
+					desc_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+					break;
+				case kind::ConstantBuffer:
+					desc_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+					break;
+
+				default:
+					fprintf(stderr, "Unsupported field type for %s\n", name.c_str());
+					break;
+			}
+
+			if (desc_type != VK_DESCRIPTOR_TYPE_MAX_ENUM && (what & read_bindings))
+			{
+				rf::binding res {};
+				res.name = w.intern(name);
+				res.binding = binding;
+				res.type = desc_type;
+				res.count = field_cnt;
+				res.stages = VK_SHADER_STAGE_ALL;
+				w.bindings.push_back(res);
+			}
+		}
+	}
+
+	// Only parameter blocks of structs are supported as sets.
+	void read_param(writer& w, slang::VariableLayoutReflection* param)
+	{
+		slang::TypeLayoutReflection* type = param->getTypeLayout();
+		if (param->getCategory() == SLANG_PARAMETER_CATEGORY_SPECIALIZATION_CONSTANT)
+		{
+			rf::constant cst {};
+			cst.name = w.intern(param->getName());
+			cst.id = param->getOffset(SLANG_PARAMETER_CATEGORY_SPECIALIZATION_CONSTANT);
+			cst.type = scalar(type->getScalarType());
+			if (cst.type == rf::scalar_type::other)
+				fprintf(stderr, "Unsupported specialization constant type for %s\n",
+				        param->getName());
+			else
+				w.constants.push_back(cst);
+			return;
+		}
+
+		if (type->getKind() != kind::ParameterBlock)
+			return;
+
+		slang::VariableLayoutReflection* elem = type->getElementVarLayout();
+		if (elem->getTypeLayout()->getKind() != kind::Struct)
+			return;
+
+		rf::set set {};
+		set.name = w.intern(param->getName());
+		set.index =
+			param->getOffset(SLANG_PARAMETER_CATEGORY_SUB_ELEMENT_REGISTER_SPACE);
+		set.uniform_size =
+			elem->getTypeLayout()->getSize(SLANG_PARAMETER_CATEGORY_UNIFORM);
+		set.first_binding = w.bindings.size();
+		set.first_member = w.members.size();
+
+		if (set.uniform_size)
+		{
+			slang::VariableLayoutReflection* container = type->getContainerVarLayout();
+
+			rf::binding uniform {};
+			uniform.name = set.name;
+			uniform.binding =
+				container->getOffset(SLANG_PARAMETER_CATEGORY_DESCRIPTOR_TABLE_SLOT);
+			uniform.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			uniform.count = 1;
+			uniform.stages = VK_SHADER_STAGE_ALL;
+			w.bindings.push_back(uniform);
+		}
+
+		read_fields(w, elem->getTypeLayout(),
+		            elem->getOffset(SLANG_PARAMETER_CATEGORY_DESCRIPTOR_TABLE_SLOT),
+		            elem->getOffset(SLANG_PARAMETER_CATEGORY_UNIFORM), 1,
+		            read_members | read_bindings, "");
+
+		set.binding_cnt = w.bindings.size() - set.first_binding;
+		set.member_cnt = w.members.size() - set.first_member;
+		w.sets.push_back(set);
+	}
+
+	void read_vertex_inputs(writer& w, slang::TypeLayoutReflection* type,
+	                        uint32_t location, std::string const& name)
+	{
+		if (type->getKind() == kind::Struct)
+		{
+			for (uint32_t i {0}; i < type->getFieldCount(); ++i)
+			{
+				slang::VariableLayoutReflection* field = type->getFieldByIndex(i);
+				slang::TypeLayoutReflection*     field_type = field->getTypeLayout();
+				if (field_type->getSize(SLANG_PARAMETER_CATEGORY_VARYING_INPUT))
+				{
+					uint32_t field_location {location};
+					field_location +=
+						field->getOffset(SLANG_PARAMETER_CATEGORY_VARYING_INPUT);
+					read_vertex_inputs(w, field_type, field_location, field->getName());
+				}
+			}
+			return;
+		}
+
+		rf::vertex_input input {};
+		input.name = w.intern(name);
+		input.location = location;
+		input.format =
+			vertex_format(scalar(type->getScalarType()), type->getColumnCount());
+		if (input.format == VK_FORMAT_UNDEFINED)
+			fprintf(stderr, "Unsupported vertex input type for %s\n", name.c_str());
+		w.vertex_inputs.push_back(input);
+	}
+
+	void read_entry_point(writer& w, slang::EntryPointReflection* entry)
+	{
+		rf::entry_point entry_point {};
+		entry_point.name = w.intern(entry->getName());
+		entry_point.stage = stage_flag(entry->getStage());
+		w.entry_points.push_back(entry_point);
+
+		// Uniform parameters of entry points are push constants.
+		rf::push_range range {UINT32_MAX, 0, entry_point.stage};
+		uint32_t       range_end {0};
+		for (uint32_t i {0}; i < entry->getParameterCount(); ++i)
+		{
+			slang::VariableLayoutReflection* param = entry->getParameterByIndex(i);
+			slang::TypeLayoutReflection*     type = param->getTypeLayout();
+
+			uint32_t size = type->getSize(SLANG_PARAMETER_CATEGORY_UNIFORM);
+			if (size)
+			{
+				uint32_t offset = param->getOffset(SLANG_PARAMETER_CATEGORY_UNIFORM);
+				range.offset = std::min(range.offset, offset);
+				range_end = std::max(range_end, offset + size);
+			}
+
+			if (entry->getStage() == SLANG_STAGE_VERTEX &&
+			    type->getSize(SLANG_PARAMETER_CATEGORY_VARYING_INPUT))
+			{
+				read_vertex_inputs(
+					w, type, param->getOffset(SLANG_PARAMETER_CATEGORY_VARYING_INPUT),
+					param->getName());
+			}
+		}
+
+		if (range_end)
+		{
+			range.size = range_end - range.offset;
+			w.push_ranges.push_back(range);
+		}
+	}
+
+	// Adds the entry point stage to the bindings it uses.
+	bool read_binding_usage(writer& w, slang::IComponentType* program,
+	                        uint32_t entry_idx)
+	{
+		slang::IMetadata* metadata {nullptr};
+		if (SLANG_FAILED(program->getEntryPointMetadata(entry_idx, 0, &metadata)))
+			return false;
+
+		for (uint64_t i {0}; i < w.sets.size(); ++i)
+		{
+			rf::set const& set = w.sets[i];
+			for (uint32_t j {0}; j < set.binding_cnt; ++j)
+			{
+				rf::binding& binding = w.bindings[set.first_binding + j];
+				bool used {false};
+				metadata->isParameterLocationUsed(
+					SLANG_PARAMETER_CATEGORY_DESCRIPTOR_TABLE_SLOT, set.index,
+					binding.binding, used);
+				if (used)
+					binding.stages |= w.entry_points[entry_idx].stage;
+			}
+		}
+
+		metadata->release();
+		return true;
+	}
+
+	template <typename T>
+	void write_table(std::vector<uint8_t>& out, rf::table& table,
+	                 std::vector<T> const& vec)
+	{
+		table.off = out.size();
+		table.cnt = vec.size();
+		uint8_t const* data = reinterpret_cast<uint8_t const*>(vec.data());
+		out.insert(out.end(), data, data + vec.size() * sizeof(T));
+	}
+}
+
+namespace slangrc
+{
+	bool build_reflection(slang::IComponentType* program, std::vector<uint8_t>& out)
+	{
+		slang::ProgramLayout* layout = program->getLayout(0);
+		writer                w;
+
+		for (uint32_t i {0}; i < layout->getParameterCount(); ++i)
+			read_param(w, layout->getParameterByIndex(i));
+		std::sort(w.sets.begin(), w.sets.end(), [](rf::set const& a, rf::set const& b)
+		{
+			return a.index < b.index;
+		});
+
+		for (uint32_t i {0}; i < layout->getEntryPointCount(); ++i)
+			read_entry_point(w, layout->getEntryPointByIndex(i));
+
+		// Overlapping ranges are merged, so each pushed byte belongs to a single range
+		// and can be pushed to all its stages at once.
+		std::sort(w.push_ranges.begin(), w.push_ranges.end(),
+		          [](rf::push_range const& a, rf::push_range const& b)
+		{
+			return a.offset < b.offset;
+		});
+		std::vector<rf::push_range> merged;
+		for (uint64_t i {0}; i < w.push_ranges.size(); ++i)
+		{
+			rf::push_range const& range = w.push_ranges[i];
+			if (merged.size() && range.offset < merged.back().offset + merged.back().size)
+			{
+				rf::push_range& last = merged.back();
+				last.size = std::max(last.offset + last.size, range.offset + range.size) -
+				            last.offset;
+				last.stages |= range.stages;
+			}
+			else
+				merged.push_back(range);
+		}
+		w.push_ranges = merged;
+
+		// Without metadata for an entry point, bindings stay visible to all stages.
+		for (uint64_t i {0}; i < w.bindings.size(); ++i)
+			w.bindings[i].stages = 0;
+		bool has_usage {true};
+		for (uint32_t i {0}; has_usage && i < w.entry_points.size(); ++i)
+			has_usage = read_binding_usage(w, program, i);
+		if (!has_usage)
+		{
+			for (uint64_t i {0}; i < w.bindings.size(); ++i)
+				w.bindings[i].stages = VK_SHADER_STAGE_ALL;
+		}
+		std::sort(w.vertex_inputs.begin(), w.vertex_inputs.end(),
+		          [](rf::vertex_input const& a, rf::vertex_input const& b)
+		{
+			return a.location < b.location;
+		});
+
+		rf::header header {};
+		header.magic = rf::magic;
+		header.version = rf::version;
+
+		out.resize(sizeof(header));
+		write_table(out, header.sets, w.sets);
+		write_table(out, header.bindings, w.bindings);
+		write_table(out, header.members, w.members);
+		write_table(out, header.push_ranges, w.push_ranges);
+		write_table(out, header.entry_points, w.entry_points);
+		write_table(out, header.vertex_inputs, w.vertex_inputs);
+		write_table(out, header.constants, w.constants);
+		write_table(out, header.strings, w.strings);
+		memcpy(out.data(), &header, sizeof(header));
+
+		return true;
+	}
+}
\ No newline at end of file
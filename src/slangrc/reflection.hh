@@ -0,0 +1,15 @@
+#pragma once
+
+#include <slang/slang.h>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace slangrc
+{
+	// Builds the binary reflection of a linked program, in the format described in
+	// vkb/vk/reflection_format.hh. Binding stage masks only contain the entry points
+	// actually using them.
+	bool build_reflection(slang::IComponentType* program, std::vector<uint8_t>& out);
+}
\ No newline at end of file
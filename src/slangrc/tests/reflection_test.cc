@@ -0,0 +1,147 @@
+#include "../compiler.hh"
+
+#include <vkb/vk/reflection_format.hh>
+
+#include <vulkan/vulkan_core.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace rf = vkb::vk::reflection_format;
+
+namespace
+{
+	struct reflection
+	{
+		uint8_t const*    data;
+		rf::header const* header;
+
+		template <typename T>
+		T const* table(rf::table const& tab) const
+		{
+			return reinterpret_cast<T const*>(data + tab.off);
+		}
+
+		char const* name(uint32_t off) const
+		{
+			return table<char>(header->strings) + off;
+		}
+
+		rf::member const* find_member(char const* member) const
+		{
+			rf::member const* members = table<rf::member>(header->members);
+			for (uint32_t i {0}; i < header->members.cnt; ++i)
+				if (strcmp(name(members[i].name), member) == 0)
+					return &members[i];
+			return nullptr;
+		}
+
+		rf::binding const* find_binding(char const* binding) const
+		{
+			rf::binding const* bindings = table<rf::binding>(header->bindings);
+			for (uint32_t i {0}; i < header->bindings.cnt; ++i)
+				if (strcmp(name(bindings[i].name), binding) == 0)
+					return &bindings[i];
+			return nullptr;
+		}
+	};
+
+	uint32_t failures {0};
+
+	void check(bool cond, char const* what)
+	{
+		if (!cond)
+		{
+			fprintf(stderr, "Failed: %s\n", what);
+			++failures;
+		}
+	}
+
+	void check_binding(reflection const& refl, char const* name, uint32_t type,
+	                   uint32_t count)
+	{
+		rf::binding const* binding = refl.find_binding(name);
+		check(binding, name);
+		if (binding)
+		{
+			check(binding->type == type, name);
+			check(binding->count == count, name);
+		}
+	}
+}
+
+// slangrc_test <struct_array.slang> <stamp>
+// Checks the reflection of the arrays of structs of the test shader, and writes the
+// stamp file on success.
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: slangrc_test <struct_array.slang> <stamp>\n");
+		return 1;
+	}
+
+	slangrc::compiler* comp = slangrc::create_compiler();
+	slangrc::output    out;
+	if (!comp || !slangrc::compile(comp, argv[1], out))
+	{
+		fprintf(stderr, "Could not compile %s\n", argv[1]);
+		if (comp)
+			slangrc::destroy_compiler(comp);
+		return 1;
+	}
+
+	reflection refl {.data = out.reflection.data,
+	                 .header = reinterpret_cast<rf::header const*>(out.reflection.data)};
+	check(refl.header->magic == rf::magic && refl.header->version == rf::version,
+	      "header");
+
+	// Uniform members of each element, at the array stride.
+	rf::member const* ambient = refl.find_member("ambient");
+	check(ambient && ambient->offset == 0, "ambient");
+
+	char              name[64];
+	rf::member const* first = refl.find_member("lights[0].color");
+	rf::member const* second = refl.find_member("lights[1].color");
+	check(first && second && second->offset > first->offset, "lights stride");
+	for (uint32_t i {0}; first && second && i < 4; ++i)
+	{
+		uint32_t stride = second->offset - first->offset;
+
+		snprintf(name, sizeof(name), "lights[%u].color", i);
+		rf::member const* color = refl.find_member(name);
+		check(color && color->offset == first->offset + i * stride && color->cols == 4,
+		      name);
+
+		snprintf(name, sizeof(name), "lights[%u].dir", i);
+		rf::member const* dir = refl.find_member(name);
+		check(dir && dir->offset == first->offset + i * stride + 16 && dir->cols == 3,
+		      name);
+
+		snprintf(name, sizeof(name), "lights[%u].intensity", i);
+		rf::member const* intensity = refl.find_member(name);
+		check(intensity && intensity->offset == first->offset + i * stride + 28, name);
+	}
+
+	// Resources of the elements are arrays of descriptors.
+	check_binding(refl, "shadows.map", VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2);
+	check_binding(refl, "shadows.sampler", VK_DESCRIPTOR_TYPE_SAMPLER, 2);
+	check_binding(refl, "light_buffers", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3);
+	check_binding(refl, "light_cbs", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2);
+
+	slangrc::free_output(out);
+	slangrc::destroy_compiler(comp);
+
+	if (failures)
+		return 1;
+
+	FILE* stamp = fopen(argv[2], "wb");
+	if (!stamp)
+	{
+		fprintf(stderr, "Could not open %s\n", argv[2]);
+		return 1;
+	}
+	fclose(stamp);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "arena.hh"
+
+#include "../log.hh"
+
+#include <stdlib.h>
+
+namespace vkb
+{
+	namespace
+	{
+		constexpr uint64_t scratch_size {1024 * 1024};
+
+		struct scratch_stack
+		{
+			~scratch_stack()
+			{
+				free(arena.data());
+			}
+
+			linear_arena arena;
+		};
+
+		thread_local scratch_stack scratch_stack_;
+
+		// Reserved on the first scratch of each thread.
+		linear_arena& scratch_arena()
+		{
+			if (!scratch_stack_.arena.data())
+			{
+				void* data = malloc(scratch_size);
+				log::assert(data, "Failed to reserve the scratch stack");
+				scratch_stack_.arena = linear_arena(data, scratch_size);
+			}
+
+			return scratch_stack_.arena;
+		}
+	}
+
+	linear_arena::linear_arena(void* data, uint64_t size)
+	: data_ {static_cast<uint8_t*>(data)}
+	, size_ {size}
+	{}
+
+	void* linear_arena::alloc(uint64_t size, uint64_t align)
+	{
+		uint64_t off = (used_ + align - 1) & ~(align - 1);
+		if (off + size > size_)
+			return nullptr;
+
+		used_ = off + size;
+		if (used_ > peak_)
+			peak_ = used_;
+
+		return data_ + off;
+	}
+
+	uint64_t linear_arena::mark() const
+	{
+		return used_;
+	}
+
+	void linear_arena::rewind(uint64_t mark)
+	{
+		used_ = mark;
+	}
+
+	void linear_arena::reset()
+	{
+		used_ = 0;
+	}
+
+	void* linear_arena::data() const
+	{
+		return data_;
+	}
+
+	uint64_t linear_arena::used() const
+	{
+		return used_;
+	}
+
+	uint64_t linear_arena::peak() const
+	{
+		return peak_;
+	}
+
+	frame_arena* frame_arena::frame_arena_ {nullptr};
+
+	frame_arena& frame_arena::get()
+	{
+		return *frame_arena_;
+	}
+
+	frame_arena::frame_arena(uint64_t frame_size)
+	{
+		frame_arena_ = this;
+
+		data_ = malloc(frame_size * max_frames_in_flight);
+		log::assert(data_, "Failed to reserve the frame arena");
+		for (uint32_t i {0}; i < max_frames_in_flight; ++i)
+			arenas_[i] = linear_arena(static_cast<uint8_t*>(data_) + frame_size * i,
+			                          frame_size);
+	}
+
+	frame_arena::~frame_arena()
+	{
+		frame_arena_ = nullptr;
+
+		free(data_);
+	}
+
+	void frame_arena::begin_frame(uint32_t frame_idx)
+	{
+		log::assert(frame_idx < max_frames_in_flight, "Frame %u not in flight",
+		            frame_idx);
+		frame_idx_ = frame_idx;
+		arenas_[frame_idx_].reset();
+	}
+
+	linear_arena& frame_arena::current()
+	{
+		return arenas_[frame_idx_];
+	}
+
+	void* frame_arena::alloc(uint64_t size, uint64_t align)
+	{
+		void* data = arenas_[frame_idx_].alloc(size, align);
+		log::assert(data, "Frame arena full, %llu bytes requested",
+		            static_cast<unsigned long long>(size));
+		return data;
+	}
+
+	scratch::scratch()
+	: arena_ {scratch_arena()}
+	, mark_ {arena_.mark()}
+	{}
+
+	scratch::~scratch()
+	{
+		arena_.rewind(mark_);
+	}
+
+	void* scratch::alloc(uint64_t size, uint64_t align)
+	{
+		void* data = arena_.alloc(size, align);
+		log::assert(data, "Scratch stack full, %llu bytes requested",
+		            static_cast<unsigned long long>(size));
+		return data;
+	}
+}
\ No newline at end of file
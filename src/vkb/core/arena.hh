@@ -0,0 +1,153 @@
+#pragma once
+
+#include "frames.hh"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace vkb
+{
+	// Bump allocator over a block it doesn't own. Allocations are released all at once
+	// by reset(), or back to a mark by rewind().
+	class linear_arena
+	{
+	public:
+		linear_arena() = default;
+		linear_arena(void* data, uint64_t size);
+
+		// Returns nullptr when the arena is full.
+		void* alloc(uint64_t size, uint64_t align = 16);
+
+		uint64_t mark() const;
+		void     rewind(uint64_t mark);
+		void     reset();
+
+		void*    data() const;
+		uint64_t used() const;
+		// Highest use since the creation.
+		uint64_t peak() const;
+
+	private:
+		uint8_t* data_ {nullptr};
+		uint64_t size_ {0};
+		uint64_t used_ {0};
+		uint64_t peak_ {0};
+	};
+
+	// Allocator adaptor handing out arena memory with the allocate/deallocate pair of
+	// the standard and mincore allocators. mc::vector has no allocator parameter, so
+	// it is used by arrays growing in an arena themselves. Deallocations are no-ops,
+	// the memory returns to the arena when it is reset.
+	template <typename T>
+	class arena_allocator
+	{
+	public:
+		using value_type = T;
+
+		arena_allocator(linear_arena& arena)
+		: arena_ {&arena}
+		{}
+
+		template <typename U>
+		arena_allocator(arena_allocator<U> const& other)
+		: arena_ {other.arena_}
+		{}
+
+		// Returns nullptr when the arena is full.
+		T* allocate(uint64_t cnt)
+		{
+			return static_cast<T*>(arena_->alloc(sizeof(T) * cnt, alignof(T)));
+		}
+
+		void deallocate(T*, uint64_t) {}
+
+		bool operator==(arena_allocator const& other) const
+		{
+			return arena_ == other.arena_;
+		}
+
+	private:
+		template <typename U>
+		friend class arena_allocator;
+
+		linear_arena* arena_;
+	};
+
+	// Transient CPU data of the frames being recorded. Each frame in flight has its
+	// own arena, reset when the frame is recorded again, so nothing is freed in the
+	// frame loop.
+	class frame_arena
+	{
+	public:
+		static frame_arena& get();
+
+		frame_arena(uint64_t frame_size);
+		frame_arena(frame_arena const&) = delete;
+		frame_arena(frame_arena&&) = delete;
+		~frame_arena();
+
+		frame_arena& operator=(frame_arena const&) = delete;
+		frame_arena& operator=(frame_arena&&) = delete;
+
+		// frame_idx is the frame in flight, in [0, max_frames_in_flight), and its
+		// previous submission must have completed.
+		void begin_frame(uint32_t frame_idx);
+
+		linear_arena& current();
+
+		// Zeroed array valid until the frame is begun again, for trivially copyable
+		// types.
+		template <typename T>
+		T* alloc(uint32_t cnt);
+
+	private:
+		static frame_arena* frame_arena_;
+
+		void* alloc(uint64_t size, uint64_t align);
+
+		void*        data_ {nullptr};
+		linear_arena arenas_[max_frames_in_flight];
+		uint32_t     frame_idx_ {0};
+	};
+
+	// Nested temporaries of the calling thread, taken from a stack reserved for each
+	// thread. Allocations are released when the scope ends, scopes must end in the
+	// reverse order of their creation.
+	class scratch
+	{
+	public:
+		scratch();
+		scratch(scratch const&) = delete;
+		scratch(scratch&&) = delete;
+		~scratch();
+
+		scratch& operator=(scratch const&) = delete;
+		scratch& operator=(scratch&&) = delete;
+
+		// Zeroed array valid until the scope ends, for trivially copyable types.
+		template <typename T>
+		T* alloc(uint32_t cnt);
+
+	private:
+		void* alloc(uint64_t size, uint64_t align);
+
+		linear_arena& arena_;
+		uint64_t      mark_ {0};
+	};
+
+	template <typename T>
+	T* frame_arena::alloc(uint32_t cnt)
+	{
+		T* data = static_cast<T*>(alloc(sizeof(T) * cnt, alignof(T)));
+		memset(data, 0, sizeof(T) * cnt);
+		return data;
+	}
+
+	template <typename T>
+	T* scratch::alloc(uint32_t cnt)
+	{
+		T* data = static_cast<T*>(alloc(sizeof(T) * cnt, alignof(T)));
+		memset(data, 0, sizeof(T) * cnt);
+		return data;
+	}
+}
\ No newline at end of file
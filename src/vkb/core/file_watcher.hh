@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string.hh>
+#include <vector.hh>
+
+namespace vkb
+{
+	// Watches the files of a directory, not recursively. Changes are queued by the OS
+	// and collected without blocking by poll().
+	class file_watcher
+	{
+	public:
+		file_watcher(char const* dir);
+		file_watcher(file_watcher const&) = delete;
+		file_watcher(file_watcher&&) = delete;
+		~file_watcher();
+
+		file_watcher& operator=(file_watcher const&) = delete;
+		file_watcher& operator=(file_watcher&&) = delete;
+
+		bool opened() const;
+
+		// Appends the names, relative to the directory, of the files written or moved
+		// in since the last poll. Each name is only appended once.
+		void poll(mc::vector<mc::string>& changed);
+
+	private:
+#ifdef VKB_LINUX
+		int fd_ {-1};
+#elif defined(VKB_WINDOWS)
+		void* impl_ {nullptr};
+#endif
+	};
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "file_watcher.hh"
+
+#include "../log.hh"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace vkb
+{
+	namespace
+	{
+		void add_unique(mc::vector<mc::string>& changed, char const* name)
+		{
+			mc::string_view view {name};
+			for (uint32_t i {0}; i < changed.size(); ++i)
+			{
+				if (changed[i].size() == view.size() &&
+				    memcmp(changed[i].data(), view.data(), view.size()) == 0)
+					return;
+			}
+
+			changed.emplace_back(view);
+		}
+	}
+
+	file_watcher::file_watcher(char const* dir)
+	{
+		fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd_ < 0)
+		{
+			log::error("Failed to create inotify instance (%s)", strerror(errno));
+			return;
+		}
+
+		// Editors either write the file in place, or write a temporary file renamed
+		// over the original one.
+		if (inotify_add_watch(fd_, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		{
+			log::error("Failed to watch %s (%s)", dir, strerror(errno));
+			close(fd_);
+			fd_ = -1;
+		}
+	}
+
+	file_watcher::~file_watcher()
+	{
+		if (fd_ >= 0)
+			close(fd_);
+	}
+
+	bool file_watcher::opened() const
+	{
+		return fd_ >= 0;
+	}
+
+	void file_watcher::poll(mc::vector<mc::string>& changed)
+	{
+		if (fd_ < 0)
+			return;
+
+		alignas(inotify_event) char buf[4096];
+		for (;;)
+		{
+			ssize_t len = read(fd_, buf, sizeof(buf));
+			if (len <= 0)
+				break;
+
+			for (ssize_t off {0}; off < len;)
+			{
+				inotify_event const* event =
+					reinterpret_cast<inotify_event const*>(buf + off);
+				if (event->len && !(event->mask & IN_ISDIR))
+					add_unique(changed, event->name);
+
+				off += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "file_watcher.hh"
+
+#include "../log.hh"
+
+#include <win32/file.h>
+#include <win32/io.h>
+#include <win32/misc.h>
+
+#include <string.h>
+
+namespace vkb
+{
+	namespace
+	{
+		struct watch
+		{
+			HANDLE     dir {nullptr};
+			OVERLAPPED overlapped {};
+			// ReadDirectoryChangesW requires DWORD alignment.
+			alignas(DWORD) uint8_t buf[16 * 1024];
+		};
+
+		bool read_changes(watch& w)
+		{
+			return ReadDirectoryChangesW(
+				w.dir, w.buf, sizeof(w.buf), FALSE,
+				FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr,
+				&w.overlapped, nullptr);
+		}
+
+		void add_unique(mc::vector<mc::string>& changed, mc::string_view name)
+		{
+			for (uint32_t i {0}; i < changed.size(); ++i)
+			{
+				if (changed[i].size() == name.size() &&
+				    memcmp(changed[i].data(), name.data(), name.size()) == 0)
+					return;
+			}
+
+			changed.emplace_back(name);
+		}
+	}
+
+	file_watcher::file_watcher(char const* dir)
+	{
+		watch* w = new watch;
+		w->dir = CreateFileA(dir, FILE_LIST_DIRECTORY,
+		                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		                     nullptr, OPEN_EXISTING,
+		                     FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (w->dir == INVALID_HANDLE_VALUE)
+		{
+			log::error("Failed to open %s (%lu)", dir, GetLastError());
+			delete w;
+			return;
+		}
+
+		w->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+		if (!w->overlapped.hEvent || !read_changes(*w))
+		{
+			log::error("Failed to watch %s (%lu)", dir, GetLastError());
+			if (w->overlapped.hEvent)
+				CloseHandle(w->overlapped.hEvent);
+			CloseHandle(w->dir);
+			delete w;
+			return;
+		}
+
+		impl_ = w;
+	}
+
+	file_watcher::~file_watcher()
+	{
+		watch* w = static_cast<watch*>(impl_);
+		if (!w)
+			return;
+
+		CancelIo(w->dir);
+		DWORD size;
+		GetOverlappedResult(w->dir, &w->overlapped, &size, TRUE);
+		CloseHandle(w->overlapped.hEvent);
+		CloseHandle(w->dir);
+		delete w;
+	}
+
+	bool file_watcher::opened() const
+	{
+		return impl_ != nullptr;
+	}
+
+	void file_watcher::poll(mc::vector<mc::string>& changed)
+	{
+		watch* w = static_cast<watch*>(impl_);
+		if (!w)
+			return;
+
+		DWORD size {0};
+		if (!GetOverlappedResult(w->dir, &w->overlapped, &size, FALSE))
+			return;
+
+		// A size of 0 means the buffer overflowed and the changes were lost.
+		for (DWORD off {0}; size && off < size;)
+		{
+			FILE_NOTIFY_INFORMATION const* info =
+				reinterpret_cast<FILE_NOTIFY_INFORMATION const*>(w->buf + off);
+			if (info->Action == FILE_ACTION_MODIFIED ||
+			    info->Action == FILE_ACTION_ADDED ||
+			    info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+			{
+				// Resource names are ASCII.
+				char     name[MAX_PATH];
+				uint32_t len = info->FileNameLength / sizeof(WCHAR);
+				if (len >= MAX_PATH)
+					len = MAX_PATH - 1;
+				for (uint32_t i {0}; i < len; ++i)
+					name[i] = static_cast<char>(info->FileName[i]);
+
+				add_unique(changed, mc::string_view(name, len));
+			}
+
+			if (!info->NextEntryOffset)
+				break;
+			off += info->NextEntryOffset;
+		}
+
+		ResetEvent(w->overlapped.hEvent);
+		if (!read_changes(*w))
+			log::error("Failed to watch directory (%lu)", GetLastError());
+	}
+}
\ No newline at end of file
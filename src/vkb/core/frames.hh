@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace vkb
+{
+	// Frames recorded while the GPU may still be executing the previous ones. Resources
+	// written every frame are kept in as many copies, one per frame index.
+	constexpr uint8_t max_frames_in_flight {3};
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector.hh>
+
+#include <stdint.h>
+
+namespace vkb
+{
+	// Reference to an element of a handle_pool. The generation tells apart the elements
+	// successively stored in a slot, so a handle to a removed element stays invalid
+	// instead of reaching the one reusing its slot.
+	template <typename T>
+	struct handle
+	{
+		uint32_t idx {UINT32_MAX};
+		uint32_t gen {0};
+
+		// Only tells whether the handle was ever set, not whether its element is alive.
+		bool valid() const
+		{
+			return idx != UINT32_MAX;
+		}
+
+		bool operator==(handle const& other) const
+		{
+			return idx == other.idx && gen == other.gen;
+		}
+
+		bool operator!=(handle const& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	// Elements packed in a dense array, for iteration, and reached by handle in O(1)
+	// through a slot array. Removing an element moves the last one in its place, and
+	// pushes its slot on a free list with its generation incremented.
+	// Pointers to the elements are valid until the next add() or remove(). Tag types
+	// the handles, for pools of pointers to elements owned elsewhere.
+	template <typename T, typename Tag = T>
+	class handle_pool
+	{
+	public:
+		handle<Tag> add(T const& elem)
+		{
+			uint32_t idx = free_;
+			if (idx != UINT32_MAX)
+				free_ = slots_[idx].pos;
+			else
+			{
+				idx = slots_.size();
+				slots_.emplace_back();
+			}
+
+			slots_[idx].pos = elems_.size();
+			elems_.emplace_back(elem);
+			owners_.emplace_back(idx);
+
+			return handle<Tag> {idx, slots_[idx].gen};
+		}
+
+		// Returns false if h is stale.
+		bool remove(handle<Tag> h)
+		{
+			if (!alive(h))
+				return false;
+
+			slot&    s = slots_[h.idx];
+			uint32_t last = elems_.size() - 1;
+			if (s.pos != last)
+			{
+				elems_[s.pos] = static_cast<T&&>(elems_[last]);
+				owners_[s.pos] = owners_[last];
+				slots_[owners_[s.pos]].pos = s.pos;
+			}
+			elems_.pop_back();
+			owners_.pop_back();
+
+			++s.gen;
+			s.pos = free_;
+			free_ = h.idx;
+			return true;
+		}
+
+		bool alive(handle<Tag> h) const
+		{
+			return h.idx < slots_.size() && slots_[h.idx].gen == h.gen;
+		}
+
+		// nullptr if h is stale.
+		T* get(handle<Tag> h)
+		{
+			return alive(h) ? &elems_[slots_[h.idx].pos] : nullptr;
+		}
+
+		T const* get(handle<Tag> h) const
+		{
+			return alive(h) ? &elems_[slots_[h.idx].pos] : nullptr;
+		}
+
+		// Dense access, in no particular order.
+		uint32_t size() const
+		{
+			return elems_.size();
+		}
+
+		T& operator[](uint32_t pos)
+		{
+			return elems_[pos];
+		}
+
+		T const& operator[](uint32_t pos) const
+		{
+			return elems_[pos];
+		}
+
+		handle<Tag> handle_at(uint32_t pos) const
+		{
+			return handle<Tag> {owners_[pos], slots_[owners_[pos]].gen};
+		}
+
+	private:
+		struct slot
+		{
+			uint32_t gen {0};
+			// Position in elems_ while alive, next free slot otherwise.
+			uint32_t pos {UINT32_MAX};
+		};
+
+		mc::vector<T>        elems_;
+		// Slot of each element.
+		mc::vector<uint32_t> owners_;
+		mc::vector<slot>     slots_;
+		uint32_t             free_ {UINT32_MAX};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "heap.hh"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Declared by <new>, which isn't available without the standard library. Matches
+// the types the compiler uses for the implicit declarations of the allocation
+// functions.
+namespace std
+{
+	enum class align_val_t : decltype(sizeof(0))
+	{
+	};
+
+	struct nothrow_t
+	{
+		explicit nothrow_t() = default;
+	};
+}
+
+namespace vkb
+{
+	namespace heap
+	{
+		namespace
+		{
+			uint64_t allocations {0};
+
+			void* counted_alloc(uint64_t size)
+			{
+				__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+				return malloc(size ? size : 1);
+			}
+
+			// malloc has no aligned counterpart on every platform freeing with free(),
+			// so the block is over-allocated, with its start stored right before the
+			// aligned pointer.
+			void* counted_aligned_alloc(uint64_t size, std::align_val_t align)
+			{
+				uint64_t al = static_cast<uint64_t>(align);
+				uint8_t* raw =
+					static_cast<uint8_t*>(counted_alloc(size + al + sizeof(void*)));
+				if (!raw)
+					return nullptr;
+
+				uintptr_t addr = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+				addr = (addr + al - 1) & ~(al - 1);
+				reinterpret_cast<void**>(addr)[-1] = raw;
+				return reinterpret_cast<void*>(addr);
+			}
+
+			void aligned_free(void* ptr)
+			{
+				if (ptr)
+					free(static_cast<void**>(ptr)[-1]);
+			}
+		}
+
+		uint64_t allocation_count()
+		{
+			return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+// Replacements of the global allocation functions, counting the allocations.
+void* operator new(decltype(sizeof(0)) size)
+{
+	return vkb::heap::counted_alloc(size);
+}
+
+void* operator new[](decltype(sizeof(0)) size)
+{
+	return vkb::heap::counted_alloc(size);
+}
+
+void* operator new(decltype(sizeof(0)) size, std::nothrow_t const&) noexcept
+{
+	return vkb::heap::counted_alloc(size);
+}
+
+void* operator new[](decltype(sizeof(0)) size, std::nothrow_t const&) noexcept
+{
+	return vkb::heap::counted_alloc(size);
+}
+
+void* operator new(decltype(sizeof(0)) size, std::align_val_t align)
+{
+	return vkb::heap::counted_aligned_alloc(size, align);
+}
+
+void* operator new[](decltype(sizeof(0)) size, std::align_val_t align)
+{
+	return vkb::heap::counted_aligned_alloc(size, align);
+}
+
+void* operator new(decltype(sizeof(0)) size, std::align_val_t align,
+                   std::nothrow_t const&) noexcept
+{
+	return vkb::heap::counted_aligned_alloc(size, align);
+}
+
+void* operator new[](decltype(sizeof(0)) size, std::align_val_t align,
+                     std::nothrow_t const&) noexcept
+{
+	return vkb::heap::counted_aligned_alloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, decltype(sizeof(0))) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, decltype(sizeof(0))) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, std::nothrow_t const&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	vkb::heap::aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+	vkb::heap::aligned_free(ptr);
+}
+
+void operator delete(void* ptr, decltype(sizeof(0)), std::align_val_t) noexcept
+{
+	vkb::heap::aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, decltype(sizeof(0)), std::align_val_t) noexcept
+{
+	vkb::heap::aligned_free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, std::nothrow_t const&) noexcept
+{
+	vkb::heap::aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, std::nothrow_t const&) noexcept
+{
+	vkb::heap::aligned_free(ptr);
+}
\ No newline at end of file
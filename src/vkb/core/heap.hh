@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace vkb
+{
+	namespace heap
+	{
+		// Calls to the global operator new, in all its forms, since the start, from all
+		// threads. The frame loop is expected to leave it unchanged once warmed up.
+		// Only operator new is counted: malloc calls, from the C libraries (ImGui,
+		// stb, VMA, Slang) or for the arena blocks, aren't.
+		uint64_t allocation_count();
+	}
+}
\ No newline at end of file
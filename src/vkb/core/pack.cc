@@ -0,0 +1,120 @@
+#include "pack.hh"
+#include "pack_format.hh"
+
+#include "../log.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace vkb
+{
+	pack* pack::pack_ {nullptr};
+
+	pack& pack::get()
+	{
+		return *pack_;
+	}
+
+	pack::pack(char const* path)
+	{
+		pack_ = this;
+
+		if (!map(path))
+		{
+			log::warn("Resource pack %s not found, using loose files", path);
+			return;
+		}
+
+		pack_format::header const* header =
+			reinterpret_cast<pack_format::header const*>(data_);
+		if (size_ < sizeof(pack_format::header) || header->magic != pack_format::magic ||
+		    header->version != pack_format::version ||
+		    header->toc_off + header->entry_cnt * sizeof(pack_format::entry) > size_)
+		{
+			log::error("Invalid resource pack %s", path);
+			unmap();
+		}
+	}
+
+	pack::~pack()
+	{
+		pack_ = nullptr;
+
+		if (data_)
+			unmap();
+	}
+
+	bool pack::opened() const
+	{
+		return data_;
+	}
+
+	bool pack::load(mc::string_view path, resource& res) const
+	{
+		res.storage.clear();
+		if (find(path, res))
+			return true;
+
+		return read_file(path, res);
+	}
+
+	bool pack::find(mc::string_view path, resource& res) const
+	{
+		if (!data_)
+			return false;
+
+		pack_format::header const* header =
+			reinterpret_cast<pack_format::header const*>(data_);
+		pack_format::entry const* entries =
+			reinterpret_cast<pack_format::entry const*>(data_ + header->toc_off);
+
+		uint64_t hash = pack_format::hash(path.data(), path.size());
+		uint32_t first {0};
+		uint32_t last {header->entry_cnt};
+		while (first < last)
+		{
+			uint32_t mid = first + (last - first) / 2;
+			if (entries[mid].hash < hash)
+				first = mid + 1;
+			else
+				last = mid;
+		}
+
+		if (first == header->entry_cnt || entries[first].hash != hash)
+			return false;
+
+		// Same hash but another path, which isn't in the pack.
+		pack_format::entry const& e = entries[first];
+		if (e.name_len != path.size() || e.name_off + e.name_len > size_ ||
+		    memcmp(data_ + e.name_off, path.data(), path.size()) != 0)
+			return false;
+
+		// Truncated or corrupt pack, the loose file is read instead.
+		if (e.off > size_ || e.size > size_ - e.off)
+		{
+			log::error("Pack entry %s is out of the pack", path.data());
+			return false;
+		}
+
+		res.data = data_ + e.off;
+		res.size = e.size;
+		return true;
+	}
+
+	bool pack::read_file(mc::string_view path, resource& res) const
+	{
+		FILE* file = fopen(path.data(), "rb");
+		if (!file)
+			return false;
+
+		fseek(file, 0, SEEK_END);
+		res.storage.resize(ftell(file));
+		fseek(file, 0, SEEK_SET);
+		uint64_t read = fread(res.storage.data(), 1, res.storage.size(), file);
+		fclose(file);
+
+		res.data = res.storage.data();
+		res.size = read;
+		return read == res.storage.size();
+	}
+}
\ No newline at end of file
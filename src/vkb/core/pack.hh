@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string_view.hh>
+#include <vector.hh>
+
+#include <stdint.h>
+
+namespace vkb
+{
+	// Read only resource archive, mapped once in memory. Resources missing from the
+	// pack are read from loose files instead, so the pack is optional during
+	// development.
+	class pack
+	{
+	public:
+		// Pack entries point directly into the mapping, loose files are read in
+		// storage.
+		struct resource
+		{
+			uint8_t const*      data {nullptr};
+			uint64_t            size {0};
+			mc::vector<uint8_t> storage;
+		};
+
+		static pack& get();
+
+		pack(char const* path);
+		pack(pack const&) = delete;
+		pack(pack&&) = delete;
+		~pack();
+
+		pack& operator=(pack const&) = delete;
+		pack& operator=(pack&&) = delete;
+
+		bool opened() const;
+
+		bool load(mc::string_view path, resource& res) const;
+
+	private:
+		static pack* pack_;
+
+		bool map(char const* path);
+		void unmap();
+
+		bool find(mc::string_view path, resource& res) const;
+		bool read_file(mc::string_view path, resource& res) const;
+
+		uint8_t const* data_ {nullptr};
+		uint64_t       size_ {0};
+#ifdef VKB_WINDOWS
+		void* file_ {nullptr};
+		void* mapping_ {nullptr};
+#endif
+	};
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "pack.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vkb
+{
+	bool pack::map(char const* path)
+	{
+		int fd = open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping keeps its own reference to the file.
+		close(fd);
+		if (data == MAP_FAILED)
+			return false;
+
+		data_ = static_cast<uint8_t const*>(data);
+		size_ = st.st_size;
+		return true;
+	}
+
+	void pack::unmap()
+	{
+		munmap(const_cast<uint8_t*>(data_), size_);
+		data_ = nullptr;
+		size_ = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "pack.hh"
+
+#include <win32/file.h>
+#include <win32/io.h>
+#include <win32/misc.h>
+
+namespace vkb
+{
+	bool pack::map(char const* path)
+	{
+		file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                    FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE)
+		{
+			file_ = nullptr;
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file_);
+			file_ = nullptr;
+			return false;
+		}
+
+		mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping_)
+		{
+			CloseHandle(file_);
+			file_ = nullptr;
+			return false;
+		}
+
+		void* data = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			CloseHandle(mapping_);
+			CloseHandle(file_);
+			mapping_ = nullptr;
+			file_ = nullptr;
+			return false;
+		}
+
+		data_ = static_cast<uint8_t const*>(data);
+		size_ = size.QuadPart;
+		return true;
+	}
+
+	void pack::unmap()
+	{
+		UnmapViewOfFile(data_);
+		CloseHandle(mapping_);
+		CloseHandle(file_);
+		data_ = nullptr;
+		size_ = 0;
+		mapping_ = nullptr;
+		file_ = nullptr;
+	}
+}
\ No newline at end of file
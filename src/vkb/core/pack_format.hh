@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// Layout of res.pack, shared by packrc and the runtime.
+// The file starts with a header, followed by the entries data, each one aligned on
+// pack_format::alignment, then the table of contents, sorted by hash, and ends with
+// the names of the entries.
+namespace vkb::pack_format
+{
+	constexpr uint32_t magic {0x504b4256}; // "VBKP"
+	constexpr uint32_t version {2};
+	constexpr uint64_t alignment {64};
+
+	struct header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t toc_off;
+		uint32_t entry_cnt;
+		uint32_t pad;
+	};
+
+	struct entry
+	{
+		uint64_t hash;
+		uint64_t off;
+		uint64_t size;
+		// Path the hash was computed from, compared on lookup. Not null terminated.
+		uint64_t name_off;
+		uint64_t name_len;
+	};
+
+	// FNV-1a of the path relative to the executable directory, with '/' separators.
+	inline uint64_t hash(char const* str, uint64_t len)
+	{
+		uint64_t res {0xcbf29ce484222325};
+		for (uint64_t i {0}; i < len; ++i)
+		{
+			res ^= static_cast<uint8_t>(str[i]);
+			res *= 0x100000001b3;
+		}
+
+		return res;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Layout of the baked textures (.vtex), written by packrc and uploaded as is by the
+// runtime. The file starts with a header, followed by the table of levels, finest
+// first, then the levels data, each one aligned on texture_format::alignment. Levels
+// are tightly packed, as expected by vkCmdCopyBufferToImage, so compressed formats
+// are stored the same way.
+namespace vkb::texture_format
+{
+	constexpr uint32_t magic {0x58544256}; // "VBTX"
+	constexpr uint32_t version {1};
+	// Multiple of the texel block size of every format.
+	constexpr uint64_t alignment {16};
+	constexpr uint32_t max_levels {16};
+
+	struct header
+	{
+		uint32_t magic;
+		uint32_t version;
+		// VkFormat.
+		uint32_t format;
+		uint32_t w;
+		uint32_t h;
+		uint32_t lvl_cnt;
+	};
+
+	struct level
+	{
+		// From the start of the file.
+		uint64_t off;
+		uint64_t size;
+	};
+}
\ No newline at end of file
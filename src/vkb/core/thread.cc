@@ -0,0 +1,17 @@
+#include "thread.hh"
+#include "thread_impl.hh"
+
+namespace vkb::thread
+{
+	void run_jobs(jobs& js)
+	{
+		for (;;)
+		{
+			uint32_t idx = __atomic_fetch_add(&js.next, 1, __ATOMIC_RELAXED);
+			if (idx >= js.cnt)
+				break;
+
+			js.fn(idx, js.user);
+		}
+	}
+}
\ No newline at end of file
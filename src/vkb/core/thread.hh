@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace vkb
+{
+	namespace thread
+	{
+		using job = void (*)(uint32_t idx, void* user);
+
+		// Opaque native thread handle.
+		using handle = uint64_t;
+
+		uint32_t hw_concurrency();
+
+		// Runs fn(0, user) on a new thread. Returns false if the thread couldn't be
+		// created. Each started thread must be joined.
+		bool start(handle& thread, job fn, void* user);
+		void join(handle thread);
+
+		// Gives the rest of the time slice to another thread, for waits expected to be
+		// long.
+		void yield();
+
+		// Runs fn for each index in [0, cnt) on up to hw_concurrency() threads, the
+		// calling one included. Returns once every index was processed.
+		void parallel_for(uint32_t cnt, job fn, void* user);
+
+		template <typename F>
+		void parallel_for(uint32_t cnt, F& fn)
+		{
+			parallel_for(
+				cnt,
+				[](uint32_t idx, void* user) { (*static_cast<F*>(user))(idx); },
+				&fn);
+		}
+	}
+}
\ No newline at end of file
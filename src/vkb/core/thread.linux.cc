@@ -0,0 +1,84 @@
+#include "thread.hh"
+#include "thread_impl.hh"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace vkb::thread
+{
+	namespace
+	{
+		constexpr uint32_t max_threads {64};
+
+		void* worker(void* user)
+		{
+			run_jobs(*static_cast<jobs*>(user));
+			return nullptr;
+		}
+
+		void* single(void* user)
+		{
+			jobs* js = static_cast<jobs*>(user);
+			js->fn(0, js->user);
+			delete js;
+			return nullptr;
+		}
+	}
+
+	uint32_t hw_concurrency()
+	{
+		long cnt = sysconf(_SC_NPROCESSORS_ONLN);
+		return cnt > 0 ? static_cast<uint32_t>(cnt) : 1;
+	}
+
+	void parallel_for(uint32_t cnt, job fn, void* user)
+	{
+		jobs js {fn, user, cnt, 0};
+
+		uint32_t thread_cnt = hw_concurrency();
+		if (thread_cnt > cnt)
+			thread_cnt = cnt;
+		if (thread_cnt > max_threads)
+			thread_cnt = max_threads;
+
+		pthread_t threads[max_threads];
+		uint32_t  started {0};
+		for (uint32_t i {1}; i < thread_cnt; ++i)
+		{
+			if (pthread_create(&threads[started], nullptr, worker, &js) == 0)
+				++started;
+		}
+
+		run_jobs(js);
+
+		for (uint32_t i {0}; i < started; ++i)
+			pthread_join(threads[i], nullptr);
+	}
+
+	bool start(handle& thread, job fn, void* user)
+	{
+		static_assert(sizeof(pthread_t) <= sizeof(handle));
+
+		jobs*     js = new jobs {fn, user, 1, 0};
+		pthread_t native;
+		if (pthread_create(&native, nullptr, single, js) != 0)
+		{
+			delete js;
+			return false;
+		}
+
+		thread = static_cast<handle>(native);
+		return true;
+	}
+
+	void join(handle thread)
+	{
+		pthread_join(static_cast<pthread_t>(thread), nullptr);
+	}
+
+	void yield()
+	{
+		sched_yield();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "thread.hh"
+#include "thread_impl.hh"
+
+#include <win32/misc.h>
+#include <win32/sysinfo.h>
+#include <win32/threads.h>
+
+namespace vkb::thread
+{
+	namespace
+	{
+		// WaitForMultipleObjects limit.
+		constexpr uint32_t max_threads {64};
+
+		unsigned long __stdcall worker(void* user)
+		{
+			run_jobs(*static_cast<jobs*>(user));
+			return 0;
+		}
+
+		unsigned long __stdcall single(void* user)
+		{
+			jobs* js = static_cast<jobs*>(user);
+			js->fn(0, js->user);
+			delete js;
+			return 0;
+		}
+	}
+
+	uint32_t hw_concurrency()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+	}
+
+	void parallel_for(uint32_t cnt, job fn, void* user)
+	{
+		jobs js {fn, user, cnt, 0};
+
+		uint32_t thread_cnt = hw_concurrency();
+		if (thread_cnt > cnt)
+			thread_cnt = cnt;
+		if (thread_cnt > max_threads)
+			thread_cnt = max_threads;
+
+		HANDLE   threads[max_threads];
+		uint32_t started {0};
+		for (uint32_t i {1}; i < thread_cnt; ++i)
+		{
+			threads[started] = CreateThread(nullptr, 0, worker, &js, 0, nullptr);
+			if (threads[started])
+				++started;
+		}
+
+		run_jobs(js);
+
+		if (started)
+			WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+		for (uint32_t i {0}; i < started; ++i)
+			CloseHandle(threads[i]);
+	}
+
+	bool start(handle& thread, job fn, void* user)
+	{
+		jobs*  js = new jobs {fn, user, 1, 0};
+		HANDLE native = CreateThread(nullptr, 0, single, js, 0, nullptr);
+		if (!native)
+		{
+			delete js;
+			return false;
+		}
+
+		thread = reinterpret_cast<handle>(native);
+		return true;
+	}
+
+	void join(handle thread)
+	{
+		HANDLE native = reinterpret_cast<HANDLE>(thread);
+		WaitForSingleObject(native, INFINITE);
+		CloseHandle(native);
+	}
+
+	void yield()
+	{
+		SwitchToThread();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "thread.hh"
+
+namespace vkb::thread
+{
+	// Shared between the threads of a parallel_for, each one picking the next index
+	// until none is left.
+	struct jobs
+	{
+		job      fn {nullptr};
+		void*    user {nullptr};
+		uint32_t cnt {0};
+		uint32_t next {0};
+	};
+
+	void run_jobs(jobs& js);
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "cam/orbital.hh"
+#include "core/arena.hh"
+#include "core/pack.hh"
 #include "core/time.hh"
 #include "input/input_system.hh"
 #include "ui/context.hh"
@@ -9,6 +11,7 @@
 #include "vk/material/module.hh"
 #include "vk/material/sky_sphere.hh"
 #include "vk/surface.hh"
+#include "vk/texture_pool.hh"
 #include "win/display.hh"
 #include "win/window.hh"
 
@@ -24,15 +27,40 @@
 #include <Superluminal/PerformanceAPI.h>
 #endif
 
+#ifdef VKB_HOT_RELOAD
+#include "vk/shader_reloader.hh"
+#endif
+
 int main(int argc, char** argv)
 {
-	bool enable_validation = false;
-	if (argc > 1)
-		enable_validation = strcmp(argv[1], "--validate") == 0;
+	bool        enable_validation = false;
+	bool        allow_shader_object = true;
+	bool        depth16 = false;
+	char const* shader_dir {nullptr};
+	for (int i {1}; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--validate") == 0)
+			enable_validation = true;
+		else if (strcmp(argv[i], "--pipelines") == 0)
+			allow_shader_object = false;
+		else if (strcmp(argv[i], "--depth16") == 0)
+			depth16 = true;
+		else if (strcmp(argv[i], "--shader-dir") == 0 && i + 1 < argc)
+			shader_dir = argv[++i];
+	}
 	using namespace vkb;
 
+#ifndef VKB_HOT_RELOAD
+	if (shader_dir)
+		log::warn("Built without shader hot reload, ignoring --shader-dir");
+#endif
+
 	math::init_random();
 
+	pack res_pack("res.pack");
+	// Transient CPU data of each frame in flight.
+	frame_arena frame_mem(1024 * 1024);
+
 	display      disp;
 	input_system is;
 	window       main_window("main_window", &is);
@@ -40,11 +68,21 @@ int main(int argc, char** argv)
 	vk::instance inst(enable_validation);
 	vk::surface  surface(main_window);
 
-	inst.create_device(surface);
+	inst.create_device(surface, allow_shader_object, depth16);
 	surface.create_swapchain();
 
 	vk::context ctx(main_window, surface);
 
+#ifdef VKB_HOT_RELOAD
+	// Recompiles the shaders edited in shader_dir while running.
+	vk::shader_reloader* reloader {nullptr};
+	if (shader_dir)
+	{
+		reloader = new vk::shader_reloader(shader_dir);
+		reloader->add(ctx.get_material());
+	}
+#endif
+
 	cam::orbital cam(is, main_window);
 	ui::context  ui_ctx(main_window, is, ctx);
 
@@ -97,26 +135,40 @@ int main(int argc, char** argv)
 
 	ctx.set_proj(0.1f, 1000.f, 70.f);
 
-	mc::vector<vk::object> objs;
+	mc::vector<vk::object_handle> objs;
 	objs.reserve(100);
 
 	srand(0);
 
-	vk::model   model;
-	vk::texture tex;
-	ctx.init_model(model, verts, idcs);
-	ctx.init_texture(tex, "res/textures/tex.png");
+	vk::model_handle   model = ctx.init_model(verts, idcs);
+	// 2048x2048, with a full chain over the budget, so its finest level is never
+	// resident and the coarser ones are evicted as it gets smaller on screen.
+	ctx.set_stream_budget(16 * 1024 * 1024);
+	vk::texture_handle streamed_tex = ctx.stream_texture("res/textures/streamed.png");
+	// Baked by packrc, uploaded without decoding.
+	vk::texture_handle baked_tex = ctx.init_texture("res/textures/tex.vtex");
+
+	vk::texture_pool       pool(vk::texture_pool::mode::array, 16, 16, 4);
+	vk::texture_pool::slot mod_slot = pool.get_slot(pool.add("res/textures/tex.png"));
 
-	vk::module mod(tex);
+	vk::module mod(pool);
 
 	vk::coordinates coords;
 
+#ifdef VKB_HOT_RELOAD
+	if (reloader)
+	{
+		reloader->add(mod.get_material());
+		reloader->add(coords.get_material());
+	}
+#endif
+
 	// TODO Create a screen space context handling resizing
 	auto [w, h] = surface.get_extent();
 	mat4 coords_proj = mat4::ortho_proj(-50.f, 50.f, 0, w, h, 0);
 	vec2 translate {(75.f * 2 / w), ((h - 75.f) * 2 / h)};
 
-	// vk::object& main_obj = objs.emplace_back();
+	// vk::object main_obj;
 	// main_obj.pos = {0, 0, 0, 1.0f};
 	// main_obj.rot_axis =
 	// 	vkb::vec4(static_cast<float>(rand() % 100), static_cast<float>(rand() % 100),
@@ -125,34 +177,49 @@ int main(int argc, char** argv)
 	// main_obj.scale = {1.5f, 1.5f, 1.5f, 1.f};
 	// main_obj.rot_speed = 1 / 50.f;
 
-	// main_obj.model = &model;
-	// main_obj.tex = &tex;
-	// ctx.init_object(&main_obj);
-
-	vk::object& cam_view_obj = objs.emplace_back();
-	cam_view_obj.pos = {0, 0, 0, 1.0f};
-	cam_view_obj.rot_axis = vkb::vec4(0, 1.f, 0, 1.0f).norm3();
-	cam_view_obj.scale = {0.2f, 0.2f, 0.2f, 1.f};
-	cam_view_obj.rot_speed = 0.f;
-
-	cam_view_obj.model = &model;
-	cam_view_obj.tex = &tex;
-	ctx.init_object(&cam_view_obj);
-
-	mc::vector<mat4> modules;
-	modules.emplace_back(mat4::scale({.5f, .5f, .5f, 1.f}));
-	modules.emplace_back(mat4::scale({.5f, .5f, .5f, 1.f}) *
-	                     mat4::translate({0.f, 0.f, 2.f, 1.f}));
-	modules.emplace_back(mat4::scale({.5f, .5f, .5f, 1.f}) *
-	                     mat4::translate({0.f, 0.f, 4.f, 1.f}));
-	modules.emplace_back(mat4::scale({.5f, .5f, .5f, 1.f}) *
-	                     mat4::translate({0.f, 2.f, 0.f, 1.f}));
-	modules.emplace_back(mat4::scale({.5f, .5f, .5f, 1.f}) *
-	                     mat4::translate({2.f, 0.f, 0.f, 1.f}));
+	// main_obj.model = model;
+	// main_obj.tex = tex;
+	// objs.emplace_back(ctx.init_object(main_obj));
+
+	vk::object cam_view;
+	cam_view.pos = {0, 0, 0, 1.0f};
+	cam_view.rot_axis = vkb::vec4(0, 1.f, 0, 1.0f).norm3();
+	cam_view.scale = {0.2f, 0.2f, 0.2f, 1.f};
+	cam_view.rot_speed = 0.f;
+
+	cam_view.model = model;
+	cam_view.tex = streamed_tex;
+	vk::object_handle cam_view_obj = objs.emplace_back(ctx.init_object(cam_view));
+
+	vk::object baked;
+	baked.pos = {-4.f, 0.f, 0.f, 1.f};
+	baked.rot_axis = vkb::vec4(1.f, 1.f, 0.f, 1.f).norm3();
+	baked.scale = {1.f, 1.f, 1.f, 1.f};
+	baked.rot_speed = 1 / 50.f;
+
+	baked.model = model;
+	baked.tex = baked_tex;
+	objs.emplace_back(ctx.init_object(baked));
+
+	mat4                         mod_scale = mat4::scale({.5f, .5f, .5f, 1.f});
+	mc::vector<vk::module::part> modules;
+	modules.emplace_back(vk::module::part {mod_scale, mod_slot.uv_rect, mod_slot.layer});
+	modules.emplace_back(
+		vk::module::part {mod_scale * mat4::translate({0.f, 0.f, 2.f, 1.f}),
+		                  mod_slot.uv_rect, mod_slot.layer});
+	modules.emplace_back(
+		vk::module::part {mod_scale * mat4::translate({0.f, 0.f, 4.f, 1.f}),
+		                  mod_slot.uv_rect, mod_slot.layer});
+	modules.emplace_back(
+		vk::module::part {mod_scale * mat4::translate({0.f, 2.f, 0.f, 1.f}),
+		                  mod_slot.uv_rect, mod_slot.layer});
+	modules.emplace_back(
+		vk::module::part {mod_scale * mat4::translate({2.f, 0.f, 0.f, 1.f}),
+		                  mod_slot.uv_rect, mod_slot.layer});
 
 	// for (uint32_t i {2}; i < objs.capacity(); i++)
 	// {
-	// 	vk::object& obj = objs.emplace_back();
+	// 	vk::object obj;
 	// 	obj.pos = {static_cast<float>(rand() % 100), static_cast<float>(rand() % 100),
 	// 	           static_cast<float>(rand() % 100), 1.0f};
 	// 	obj.rot_axis =
@@ -161,9 +228,9 @@ int main(int argc, char** argv)
 	// obj.scale = {.5f, .5f, .5f, 1.f}; 	obj.rot_speed = static_cast<float>(rand()
 	// % 100) / 50.f;
 
-	// 	obj.model = &model;
-	// 	obj.tex = &tex;
-	// 	ctx.init_object(&obj);
+	// 	obj.model = model;
+	// 	obj.tex = tex;
+	// 	objs.emplace_back(ctx.init_object(obj));
 	// }
 
 	while (running)
@@ -178,28 +245,27 @@ int main(int argc, char** argv)
 		is.clear_transitions();
 		disp.update();
 		cam.update(dt);
-		cam_view_obj.pos = cam.view_pos();
-
-		for (uint32_t i {0}; i < objs.size(); i++)
-			objs[i].update(dt);
+		ctx.get_object(cam_view_obj)->pos = cam.view_pos();
+		ctx.update_objects(dt);
 
 		if (!main_window.closed() && !main_window.minimized())
 		{
 			ui_ctx.update(dt);
 			if (!ctx.prepare_draw(cam))
 				continue;
-			sky.prepare_draw(ctx.current_command_buffer(), ctx.current_img_idx(), cam,
-			                 ctx.get_proj());
-			mod.prepare_draw(ctx.current_command_buffer(), ctx.current_img_idx(), cam,
-			                 ctx.get_proj());
-			coords.prepare_draw(ctx.current_command_buffer(), ctx.current_img_idx(), cam,
-			                    coords_proj, translate);
+#ifdef VKB_HOT_RELOAD
+			if (reloader)
+				reloader->update();
+#endif
+			sky.prepare_draw(ctx.current_frame(), cam, ctx.get_proj());
+			mod.prepare_draw(cam, ctx.get_proj());
+			coords.prepare_draw(cam, coords_proj, translate);
 
 			ctx.begin_draw();
-			sky.draw(ctx.current_command_buffer(), ctx.current_img_idx());
+			sky.draw(ctx.current_command_buffer(), ctx.current_frame());
 			ctx.draw();
-			mod.draw(ctx.current_command_buffer(), ctx.current_img_idx(), model, modules);
-			coords.draw(ctx.current_command_buffer(), ctx.current_img_idx());
+			mod.draw(ctx.current_command_buffer(), *ctx.get_model(model), modules);
+			coords.draw(ctx.current_command_buffer());
 			ui_ctx.draw();
 			if (ctx.present())
 			{
@@ -218,10 +284,15 @@ int main(int argc, char** argv)
 
 	ctx.wait_completion();
 
-	ctx.destroy_texture(tex);
+#ifdef VKB_HOT_RELOAD
+	delete reloader;
+#endif
+
+	ctx.destroy_texture(streamed_tex);
+	ctx.destroy_texture(baked_tex);
 	ctx.destroy_model(model);
 
 	for (uint32_t i {0}; i < objs.size(); i++)
-		ctx.destroy_object(&objs[i]);
+		ctx.destroy_object(objs[i]);
 	return 0;
 }
\ No newline at end of file
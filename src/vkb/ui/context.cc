@@ -1,8 +1,10 @@
 #include "context.hh"
 
 #include "../cam/free.hh"
+#include "../core/heap.hh"
 #include "../input/input_system.hh"
 #include "../vk/context.hh"
+#include "../vk/instance.hh"
 #include "../win/window.hh"
 
 #include "../math/quat.hh"
@@ -88,6 +90,10 @@ namespace vkb::ui
 		{
 			refresh -= 1.0;
 			disp_fps = fps;
+
+			uint64_t allocs = heap::allocation_count();
+			disp_heap_allocs = static_cast<float>(allocs - heap_allocs) / fps;
+			heap_allocs = allocs;
 			fps = 0;
 		}
 
@@ -105,6 +111,31 @@ namespace vkb::ui
 		{
 			ImGuiIO& io = ImGui::GetIO();
 			ImGui::Text("%u (%.3f ms)", disp_fps, io.DeltaTime * 1000.f);
+
+			vk::render_queue::stats const& stats = vk_.get_draw_stats();
+			ImGui::Text("%u draws, %u binds (%u skipped)", stats.draws, stats.binds,
+			            stats.skipped_binds);
+			ImGui::Text("%u barriers, %u passes culled",
+			            vk_.get_render_graph().barrier_count(),
+			            vk_.get_render_graph().culled_passes());
+			ImGui::Text("%.1f operator new per frame", disp_heap_allocs);
+
+			vk::memory_stats const& mem = vk::instance::get().get_memory_stats();
+			for (uint32_t i {0}; i < mem.heap_count(); ++i)
+			{
+				vk::memory_stats::heap const& h = mem.get_heap(i);
+				if (h.device_local)
+					ImGui::Text("Heap %u: %.1f / %.1f MiB (peak %.1f)", i,
+					            h.usage / (1024.f * 1024.f), h.budget / (1024.f * 1024.f),
+					            h.peak / (1024.f * 1024.f));
+			}
+			for (uint8_t i {0}; i < static_cast<uint8_t>(vk::mem_category::count); ++i)
+			{
+				vk::mem_category               cat = static_cast<vk::mem_category>(i);
+				vk::memory_stats::usage const& u = mem.get_usage(cat);
+				ImGui::Text("  %s: %.1f MiB (peak %.1f)", vk::mem_category_name(cat),
+				            u.bytes / (1024.f * 1024.f), u.peak / (1024.f * 1024.f));
+			}
 			ImGui::End();
 		}
 
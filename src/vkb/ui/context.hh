@@ -34,5 +34,8 @@ namespace vkb::ui
 		[[maybe_unused]] double   refresh {0.0};
 		[[maybe_unused]] uint32_t fps {0};
 		[[maybe_unused]] uint32_t disp_fps {0};
+		// Heap allocation count at the last refresh, and the average per frame since.
+		[[maybe_unused]] uint64_t heap_allocs {0};
+		[[maybe_unused]] float    disp_heap_allocs {0.f};
 	};
 }
\ No newline at end of file
@@ -1,9 +1,9 @@
 #pragma once
 
+#include "../../core/handle.hh"
 #include "../../math/vec2.hh"
 #include "../../math/vec4.hh"
 
-#include "../vma/vma.hh"
 #include <vulkan/vulkan.h>
 
 #include <array.hh>
@@ -22,11 +22,12 @@ namespace vkb::vk
 		static VkVertexInputBindingDescription                 binding_desc();
 		static mc::array<VkVertexInputAttributeDescription, 3> attribute_descs();
 
-		VkBuffer      vertex_buffer_ {nullptr};
-		VmaAllocation vertex_buffer_memory_ {nullptr};
-		VkBuffer      index_buffer_ {nullptr};
-		VmaAllocation index_buffer_memory_ {nullptr};
-
+		// Ranges in the buffers of the geometry pool.
+		uint32_t vertex_off {0};
+		uint32_t vertex_cnt {0};
+		uint32_t first_idx {0};
 		uint32_t idc_size {0};
 	};
+
+	using model_handle = handle<model>;
 }
\ No newline at end of file
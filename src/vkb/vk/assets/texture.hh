@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../../core/handle.hh"
+
 #include "../vma/vma.hh"
 #include <vulkan/vulkan.h>
 
@@ -10,8 +12,15 @@ namespace vkb::vk
 	struct texture
 	{
 		uint32_t    mip_lvl {0};
+		VkFormat    format {VK_FORMAT_R8G8B8A8_SRGB};
 		image       img;
 		VkImageView img_view {nullptr};
 		VkSampler   sampler {nullptr};
+
+		// First level of the full mip chain held by img. Only non zero for streamed
+		// textures, which keep their coarsest levels resident.
+		uint32_t base_lvl {0};
 	};
+
+	using texture_handle = handle<texture>;
 }
\ No newline at end of file
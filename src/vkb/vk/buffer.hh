@@ -9,5 +9,7 @@ namespace vkb::vk
 	{
 		VkBuffer      buffer {nullptr};
 		VmaAllocation memory {nullptr};
+		// Mapped memory of the host accessible intents.
+		void*         data {nullptr};
 	};
 }
\ No newline at end of file
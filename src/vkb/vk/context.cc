@@ -1,7 +1,18 @@
 #include "context.hh"
+#include "deletion_queue.hh"
+#include "descriptor_allocator.hh"
+#include "enum_string_helper.hh"
+#include "geometry_pool.hh"
 #include "instance.hh"
+#include "staging_ring.hh"
+#include "uniform_arena.hh"
 
 #include "../cam/free.hh"
+#include "../core/arena.hh"
+#include "../core/pack.hh"
+#include "../core/texture_format.hh"
+#include "../core/thread.hh"
+#include "../core/time.hh"
 #include "../log.hh"
 #include "../math/trig.hh"
 #include "../win/window.hh"
@@ -11,11 +22,68 @@
 #include <vulkan/vulkan_win32.h>
 #include <win32/misc.h>
 #endif
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace vkb::vk
+{
+	namespace
+	{
+		// Staging slot the current thread decodes into. stb is given the slot on its
+		// first allocation of the exact image size, which is the decoded image for
+		// usual formats. Otherwise the decoded image is copied in the slot.
+		struct decode_target
+		{
+			uint8_t* data {nullptr};
+			uint64_t size {0};
+			bool     given {false};
+		};
+
+		thread_local decode_target decode_dst;
+
+		// Only this path hands out the slot. STBI_REALLOC(NULL, size) goes to plain
+		// realloc in stb_realloc: stb starts its growing buffers that way (the zlib
+		// output of PNGs), and the slot can't grow past the image size.
+		void* stb_malloc(size_t size)
+		{
+			if (decode_dst.data && !decode_dst.given && size == decode_dst.size)
+			{
+				decode_dst.given = true;
+				return decode_dst.data;
+			}
+
+			return malloc(size);
+		}
+
+		void* stb_realloc(void* ptr, size_t size)
+		{
+			if (!ptr || ptr != decode_dst.data)
+				return realloc(ptr, size);
+
+			void* res = malloc(size);
+			if (res)
+				memcpy(res, ptr, size < decode_dst.size ? size : decode_dst.size);
+			decode_dst.given = false;
+			return res;
+		}
+
+		void stb_free(void* ptr)
+		{
+			if (ptr && ptr == decode_dst.data)
+				decode_dst.given = false;
+			else
+				free(ptr);
+		}
+	}
+}
+
+#define STBI_MALLOC(size)       vkb::vk::stb_malloc(size)
+#define STBI_REALLOC(ptr, size) vkb::vk::stb_realloc(ptr, size)
+#define STBI_FREE(ptr)          vkb::vk::stb_free(ptr)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
-#include <yyjson.h>
-
 #ifdef VKB_WINDOWS
 #define _USE_MATH_DEFINES
 #endif
@@ -26,17 +94,177 @@
 namespace vkb::vk
 {
 	namespace
-	{}
+	{
+		struct texture_load
+		{
+			pack::resource file;
+			int32_t        w {0};
+			int32_t        h {0};
+			// Staging bytes: the decoded image, or all the baked levels.
+			uint64_t       size {0};
+			uint64_t       offset {0};
+			bool           loaded {false};
+
+			// Points into file, nullptr for textures decoded by stb.
+			texture_format::header const* baked {nullptr};
+		};
+
+		struct texel_block
+		{
+			uint32_t w {0};
+			uint32_t h {0};
+			uint32_t size {0};
+		};
+
+		// Formats baked textures can be stored in, empty blocks for the others.
+		texel_block block_of(uint32_t format)
+		{
+			switch (format)
+			{
+				case VK_FORMAT_R8G8B8A8_UNORM:
+				case VK_FORMAT_R8G8B8A8_SRGB:
+				case VK_FORMAT_B8G8R8A8_UNORM:
+				case VK_FORMAT_B8G8R8A8_SRGB: return {1, 1, 4};
+				case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+				case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+				case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+				case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+				case VK_FORMAT_BC4_UNORM_BLOCK:
+				case VK_FORMAT_BC4_SNORM_BLOCK: return {4, 4, 8};
+				case VK_FORMAT_BC2_UNORM_BLOCK:
+				case VK_FORMAT_BC2_SRGB_BLOCK:
+				case VK_FORMAT_BC3_UNORM_BLOCK:
+				case VK_FORMAT_BC3_SRGB_BLOCK:
+				case VK_FORMAT_BC5_UNORM_BLOCK:
+				case VK_FORMAT_BC5_SNORM_BLOCK:
+				case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+				case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+				case VK_FORMAT_BC7_UNORM_BLOCK:
+				case VK_FORMAT_BC7_SRGB_BLOCK: return {4, 4, 16};
+				default: return {};
+			}
+		}
+
+		// Tightly packed size of a level, in whole blocks.
+		uint64_t level_size(texture_format::header const& header, texel_block block,
+		                    uint32_t lvl)
+		{
+			uint64_t w = (header.w >> lvl) > 0 ? header.w >> lvl : 1;
+			uint64_t h = (header.h >> lvl) > 0 ? header.h >> lvl : 1;
+			return (w + block.w - 1) / block.w * ((h + block.h - 1) / block.h) *
+			       block.size;
+		}
+
+		texture_format::level const* baked_levels(texture_load const& load)
+		{
+			return reinterpret_cast<texture_format::level const*>(
+				load.file.data + sizeof(texture_format::header));
+		}
+
+		// Baked textures are told apart by their header, whatever their extension.
+		// Returns false for the other files, which are decoded instead.
+		bool read_baked(texture_load& load)
+		{
+			if (load.file.size < sizeof(texture_format::header))
+				return false;
+
+			texture_format::header const* header =
+				reinterpret_cast<texture_format::header const*>(load.file.data);
+			if (header->magic != texture_format::magic)
+				return false;
+
+			// Invalid baked textures are left unloaded.
+			if (header->version != texture_format::version || header->w == 0 ||
+			    header->h == 0 || header->lvl_cnt == 0 ||
+			    header->lvl_cnt > texture_format::max_levels ||
+			    sizeof(texture_format::header) +
+			            header->lvl_cnt * sizeof(texture_format::level) >
+			        load.file.size)
+				return true;
+
+			texel_block block = block_of(header->format);
+			if (!block.size)
+				return true;
+
+			// No level past the 1x1 one.
+			uint32_t max_dim = header->w > header->h ? header->w : header->h;
+			uint32_t full_chain {1};
+			while (max_dim >>= 1)
+				++full_chain;
+			if (header->lvl_cnt > full_chain)
+				return true;
+
+			// Levels are contiguous, so they are staged with a single copy. Their sizes
+			// are checked too, the copies read as much as their extents need.
+			texture_format::level const* lvls = baked_levels(load);
+			for (uint32_t i {0}; i < header->lvl_cnt; ++i)
+			{
+				if (lvls[i].off % texture_format::alignment != 0 ||
+				    lvls[i].size != level_size(*header, block, i) ||
+				    lvls[i].off + lvls[i].size > load.file.size ||
+				    (i > 0 && lvls[i].off < lvls[i - 1].off + lvls[i - 1].size))
+					return true;
+			}
+
+			texture_format::level const& last = lvls[header->lvl_cnt - 1];
+			load.baked = header;
+			load.w = header->w;
+			load.h = header->h;
+			load.size = last.off + last.size - lvls[0].off;
+			load.loaded = true;
+			return true;
+		}
+
+		// offset is the position of the first level in buffer.
+		void copy_baked_levels(VkCommandBuffer cmd, VkBuffer buffer, uint64_t offset,
+		                       texture_load const& load, VkImage image)
+		{
+			texture_format::level const* lvls = baked_levels(load);
+
+			VkBufferImageCopy2 copies[texture_format::max_levels] {};
+			for (uint32_t i {0}; i < load.baked->lvl_cnt; ++i)
+			{
+				VkBufferImageCopy2& copy = copies[i];
+				copy.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+				copy.bufferOffset = offset + lvls[i].off - lvls[0].off;
+				copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				copy.imageSubresource.mipLevel = i;
+				copy.imageSubresource.layerCount = 1;
+				copy.imageExtent.width = (load.w >> i) > 0 ? load.w >> i : 1;
+				copy.imageExtent.height = (load.h >> i) > 0 ? load.h >> i : 1;
+				copy.imageExtent.depth = 1;
+			}
+
+			VkCopyBufferToImageInfo2 info {};
+			info.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2;
+			info.srcBuffer = buffer;
+			info.dstImage = image;
+			info.regionCount = load.baked->lvl_cnt;
+			info.pRegions = copies;
+			info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+			vkCmdCopyBufferToImage2(cmd, &info);
+		}
+
+		// Deferred with a copy of the destroyed model.
+		void free_geometry(void* data)
+		{
+			instance::get().get_geometry_pool().free(*static_cast<model*>(data));
+		}
+	}
 
 	context::context(window const& win, surface& surface)
 	: win_ {win}
 	, surface_ {surface}
 	, mat_ {"res/shaders/default.spv"}
+	, streamer_ {textures_, 256 * 1024 * 1024, 4 * 1024 * 1024}
 	{
 		// auto [w, h] = win_.size();
 		auto [w, h] = surface_.get_extent();
 		proj_ = mat4::persp_proj(near_, far_, w / (float)h, rad(fov_deg_));
 
+		default_mat_ = materials_.add(&mat_);
+
 		created_ = create_desc_set_layout();
 		if (!created_)
 		{
@@ -81,38 +309,22 @@ namespace vkb::vk
 
 		vkDeviceWaitIdle(inst.get_device());
 
-		if (depth_img_view_)
-			vkDestroyImageView(inst.get_device(), depth_img_view_, nullptr);
-		if (depth_img_buf_)
-			vmaFreeMemory(inst.get_allocator(), depth_img_buf_);
-		if (depth_img_)
-			vkDestroyImage(inst.get_device(), depth_img_, nullptr);
-
 		if (desc_pool_)
 			vkDestroyDescriptorPool(inst.get_device(), desc_pool_, nullptr);
 
-		for (uint8_t i {0}; i < context::max_frames_in_flight; ++i)
+		for (uint8_t i {0}; i < max_frames_in_flight; ++i)
 		{
 			if (in_flight_fences_[i])
 				vkDestroyFence(inst.get_device(), in_flight_fences_[i], nullptr);
-			if (draw_end_semaphores_[i])
-				vkDestroySemaphore(inst.get_device(), draw_end_semaphores_[i], nullptr);
 			if (img_avail_semaphores_[i])
 				vkDestroySemaphore(inst.get_device(), img_avail_semaphores_[i], nullptr);
 
-			if (uniform_buffers_[i])
-			{
-				vmaDestroyBuffer(inst.get_allocator(), uniform_buffers_[i],
-				                 uniform_buffers_memory_[i]);
-			}
-
-			if (staging_uniform_buffers_[i])
-			{
-				vmaDestroyBuffer(inst.get_allocator(), staging_uniform_buffers_[i],
-				                 staging_uniform_buffers_memory_[i]);
-			}
+			if (uniform_buffers_[i].buffer)
+				inst.destroy_buffer(uniform_buffers_[i]);
 		}
 
+		for (uint32_t i {0}; i < draw_end_semaphores_.size(); ++i)
+			vkDestroySemaphore(inst.get_device(), draw_end_semaphores_[i], nullptr);
 		for (uint32_t i {0}; i < recycled_semaphores_.size(); ++i)
 			vkDestroySemaphore(inst.get_device(), recycled_semaphores_[i], nullptr);
 
@@ -141,97 +353,150 @@ namespace vkb::vk
 		proj_ = mat4::persp_proj(near_, far_, w / (float)h, rad(fov_deg_));
 	}
 
-	bool context::init_model(model& model, mc::array_view<model::vert> verts,
-	                         mc::array_view<uint16_t> idcs)
+	model_handle context::init_model(mc::array_view<model::vert> verts,
+	                                 mc::array_view<uint16_t>    idcs)
 	{
-		bool init = create_vertex_buffer(model, verts);
-		if (!init)
-		{
-			log::error("Failed to create vertex buffer");
-			return init;
-		}
+		model mod;
+		if (!instance::get().get_geometry_pool().alloc(mod, verts, idcs))
+			return {};
 
-		init = create_index_buffer(model, idcs);
-		if (!init)
-		{
-			log::error("Failed to create index buffer");
-			return init;
-		}
-
-		return init;
+		return models_.add(mod);
 	}
 
-	void context::destroy_model(model& model)
+	void context::destroy_model(model_handle model)
 	{
-		instance& inst = instance::get();
+		vk::model* mod = models_.get(model);
+		if (!mod)
+			return;
 
-		if (model.index_buffer_)
-			vmaDestroyBuffer(inst.get_allocator(), model.index_buffer_,
-			                 model.index_buffer_memory_);
+		// The ranges are reused once the frames drawing the model completed.
+		instance::get().get_deletion_queue().defer(free_geometry, mod, sizeof(*mod));
+		models_.remove(model);
+	}
 
-		if (model.vertex_buffer_)
-			vmaDestroyBuffer(inst.get_allocator(), model.vertex_buffer_,
-			                 model.vertex_buffer_memory_);
+	model const* context::get_model(model_handle model) const
+	{
+		return models_.get(model);
 	}
 
-	bool context::init_texture(texture& tex, mc::string_view path)
+	texture_handle context::init_texture(mc::string_view path)
 	{
-		bool init = create_texture_image(tex, path);
+		texture_handle  tex;
+		mc::string_view paths[] {path};
+		init_textures(paths, &tex);
+		return tex;
+	}
+
+	bool context::init_textures(mc::array_view<mc::string_view> paths,
+	                            texture_handle*                 texs)
+	{
+		if (paths.size() == 0)
+			return true;
+
+		time::stamp start = time::now();
+
+		// Added first, the pointers are stable until the next add.
+		for (uint32_t i {0}; i < paths.size(); ++i)
+			texs[i] = textures_.add({});
+
+		mc::vector<texture*> ptrs;
+		ptrs.resize(paths.size());
+		for (uint32_t i {0}; i < paths.size(); ++i)
+			ptrs[i] = textures_.get(texs[i]);
+
+		bool init = create_texture_images(ptrs.data(), paths);
 		if (!init)
+			log::error("Failed to create texture images");
+
+		for (uint32_t i {0}; init && i < paths.size(); ++i)
 		{
-			log::error("Failed to create texture image");
-			return init;
+			init = create_texture_image_view(*ptrs[i]);
+			if (!init)
+			{
+				log::error("Failed to create texture image view");
+				break;
+			}
+
+			init = create_texture_sampler(*ptrs[i]);
+			if (!init)
+				log::error("Failed to create texture sampler");
 		}
 
-		init = create_texture_image_view(tex);
 		if (!init)
 		{
-			log::error("Failed to create texture image view");
+			for (uint32_t i {0}; i < paths.size(); ++i)
+			{
+				destroy_texture(texs[i]);
+				texs[i] = {};
+			}
 			return init;
 		}
 
-		init = create_texture_sampler(tex);
-		if (!init)
+		log::debug("Loaded %u textures in %.2fms", static_cast<uint32_t>(paths.size()),
+		           time::elapsed_ms(start, time::now()));
+
+		return init;
+	}
+
+	texture_handle context::stream_texture(mc::string_view path)
+	{
+		texture_handle tex = textures_.add({});
+		if (!streamer_.add(tex, path))
 		{
-			log::error("Failed to create texture sampler");
-			return init;
+			log::error("Failed to stream texture %s", path.data());
+			textures_.remove(tex);
+			return {};
 		}
 
-		return init;
+		return tex;
 	}
 
-	void context::destroy_texture(texture& tex)
+	void context::destroy_texture(texture_handle tex)
 	{
-		instance& inst = instance::get();
+		texture* t = textures_.get(tex);
+		if (!t)
+			return;
 
-		if (tex.sampler)
-			vkDestroySampler(inst.get_device(), tex.sampler, nullptr);
-		if (tex.img_view)
-			vkDestroyImageView(inst.get_device(), tex.img_view, nullptr);
-		if (tex.img.image && tex.img.memory)
-			vmaDestroyImage(inst.get_allocator(), tex.img.image, tex.img.memory);
+		if (!streamer_.remove(tex))
+			instance::get().get_deletion_queue().destroy(t->img, t->img_view);
+
+		textures_.remove(tex);
 	}
 
-	bool context::init_object(object* obj)
+	void context::set_stream_budget(uint64_t budget)
 	{
-		bool init = create_descriptor_sets(obj);
-		if (!init)
-		{
-			log::error("Failed to create descriptor sets");
-			return init;
-		}
+		streamer_.set_budget(budget);
+	}
 
-		if (init)
-			objs_.emplace_back(obj);
+	material_handle context::register_material(material& mat)
+	{
+		return materials_.add(&mat);
+	}
 
-		return init;
+	void context::unregister_material(material_handle mat)
+	{
+		materials_.remove(mat);
 	}
 
-	void context::destroy_object(object* obj)
+	object_handle context::init_object(object const& obj)
 	{
-		instance& inst = instance::get();
+		return objects_.add(obj);
+	}
+
+	void context::destroy_object(object_handle obj)
+	{
+		objects_.remove(obj);
+	}
+
+	object* context::get_object(object_handle obj)
+	{
+		return objects_.get(obj);
+	}
 
-		vkFreeDescriptorSets(inst.get_device(), desc_pool_, 2, obj->desc_sets_);
+	void context::update_objects(double dt)
+	{
+		for (uint32_t i {0}; i < objects_.size(); ++i)
+			objects_[i].update(dt);
 	}
 
 	bool context::prepare_draw(cam::base& cam)
@@ -263,26 +528,49 @@ namespace vkb::vk
 		// 	return false;
 		// }
 
-		vkWaitForFences(inst.get_device(), 1, &in_flight_fences_[img_idx_], VK_TRUE,
+		// Per frame resources are indexed by cur_frame_, the swapchain can have more
+		// images than frames in flight.
+		vkWaitForFences(inst.get_device(), 1, &in_flight_fences_[cur_frame_], VK_TRUE,
 		                UINT64_MAX);
-		vkResetFences(inst.get_device(), 1, &in_flight_fences_[img_idx_]);
+		vkResetFences(inst.get_device(), 1, &in_flight_fences_[cur_frame_]);
 
-		vkResetCommandBuffer(command_buffers_[img_idx_], 0);
+		vkResetCommandBuffer(command_buffers_[cur_frame_], 0);
+		inst.get_deletion_queue().collect();
+		inst.get_uniform_arena().begin_frame(cur_frame_);
+		inst.get_descriptor_allocator().begin_frame(cur_frame_);
+		frame_arena::get().begin_frame(cur_frame_);
+		inst.get_memory_stats().update();
 
-		VkSemaphore old_semaphore = img_avail_semaphores_[img_idx_];
+		VkSemaphore old_semaphore = img_avail_semaphores_[cur_frame_];
 		if (old_semaphore)
 			recycled_semaphores_.emplace_back(old_semaphore);
-		img_avail_semaphores_[img_idx_] = new_img_avail_semaphore;
+		img_avail_semaphores_[cur_frame_] = new_img_avail_semaphore;
 
 		VkCommandBufferBeginInfo begin_info {};
 		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		begin_info.flags = 0;
 		begin_info.pInheritanceInfo = nullptr;
 
-		res = vkBeginCommandBuffer(command_buffers_[img_idx_], &begin_info);
+		res = vkBeginCommandBuffer(command_buffers_[cur_frame_], &begin_info);
 		if (res != VK_SUCCESS)
 			return false;
 
+		// Bounding sphere projected on screen, good enough to pick a level.
+		float focal = surface_.get_extent().height / (2.f * tanf(rad(fov_deg_) / 2.f));
+		view_ = cam.view_mat();
+		for (uint32_t i {0}; i < objects_.size(); ++i)
+		{
+			object const& obj = objects_[i];
+			vec4          pos = obj.pos * view_;
+			float         dist = sqrtf(pos.dot3(pos));
+			float         radius = obj.scale.x > obj.scale.y ? obj.scale.x : obj.scale.y;
+			radius = radius > obj.scale.z ? radius : obj.scale.z;
+			if (dist > near_)
+				streamer_.set_screen_size(obj.tex, 2.f * radius * focal / dist);
+		}
+
+		streamer_.update();
+
 		struct
 		{
 			alignas(16) mat4 view;
@@ -292,134 +580,122 @@ namespace vkb::vk
 		ubo.view = cam.view_mat();
 		ubo.proj = proj_;
 
-		void* buff_mem;
-		vmaMapMemory(inst.get_allocator(), staging_uniform_buffers_memory_[img_idx_],
-		             &buff_mem);
-		memcpy(buff_mem, &ubo, sizeof(ubo));
-		vmaUnmapMemory(inst.get_allocator(), staging_uniform_buffers_memory_[img_idx_]);
-
-		VkBufferCopy2 region {};
-		region.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
-		region.size = sizeof(ubo);
-		VkCopyBufferInfo2 copy {};
-		copy.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
-		copy.srcBuffer = staging_uniform_buffers_[img_idx_];
-		copy.dstBuffer = uniform_buffers_[img_idx_];
-		copy.regionCount = 1;
-		copy.pRegions = &region;
-
-		vkCmdCopyBuffer2(command_buffers_[img_idx_], &copy);
-
-		VkBufferMemoryBarrier barrier {};
-		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-		barrier.buffer = uniform_buffers_[img_idx_];
-		barrier.size = sizeof(ubo);
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		vkCmdPipelineBarrier(command_buffers_[img_idx_], VK_PIPELINE_STAGE_TRANSFER_BIT,
-		                     VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 1,
-		                     &barrier, 0, nullptr);
-
-		inst.transition_image_layout(
-			command_buffers_[img_idx_], surface_.get_images()[img_idx_],
-			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			0,                                            // srcAccessMask
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,         // dstAccessMask
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,            // srcStage
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT // dstStage
-		);
+		// Mapped, and made visible to the device by the frame submission.
+		memcpy(uniform_buffers_[cur_frame_].data, &ubo, sizeof(ubo));
 
 		return true;
 	}
 
 	void context::begin_draw()
 	{
-		VkRenderingAttachmentInfo color_attachment {};
-		color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-		color_attachment.imageView = surface_.get_image_views()[img_idx_];
-		color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-
-		VkRenderingAttachmentInfo depth_attachment {};
-		depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-		depth_attachment.clearValue.depthStencil = {1.f, 0};
-		depth_attachment.imageView = surface_.get_depth_stencil_view();
-		depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-		VkRenderingInfo render_info {};
-		render_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-		render_info.layerCount = 1;
-		render_info.colorAttachmentCount = 1;
-		render_info.pColorAttachments = &color_attachment;
-		render_info.pDepthAttachment = &depth_attachment;
-		render_info.renderArea = {
-			{0, 0},
-            surface_.get_extent()
-        };
-
-		vkCmdBeginRendering(command_buffers_[img_idx_], &render_info);
-
-		VkViewport viewport {};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = surface_.get_extent().width;
-		viewport.height = surface_.get_extent().height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewportWithCount(command_buffers_[img_idx_], 1, &viewport);
-
-		VkRect2D scissor {};
-		scissor.offset = {0, 0};
-		scissor.extent = surface_.get_extent();
-		vkCmdSetScissorWithCount(command_buffers_[img_idx_], 1, &scissor);
+		// The swapchain image content is discarded, the scene covers it.
+		graph_.reset();
+		render_graph::resource color = graph_.import_image(
+			surface_.get_images()[img_idx_], surface_.get_image_views()[img_idx_],
+			{surface_.get_format().format, surface_.get_extent()},
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		// Only lives during the scene pass, the graph gives it lazily allocated memory
+		// where available.
+		render_graph::image_desc depth_desc;
+		depth_desc.format = instance::get().get_depth_format();
+		depth_desc.extent = surface_.get_extent();
+		depth_desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		render_graph::resource depth = graph_.create_image(depth_desc);
+
+		VkClearValue depth_clear {};
+		depth_clear.depthStencil = {1.f, 0};
+
+		scene_pass_ = graph_.add_pass("scene");
+		graph_.attach(scene_pass_, color, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+		graph_.attach(scene_pass_, depth, VK_ATTACHMENT_LOAD_OP_CLEAR, depth_clear);
+		graph_.compile();
+
+		graph_.begin_execute(command_buffers_[cur_frame_]);
+		graph_.begin_pass(scene_pass_);
 	}
 
 	void context::draw()
 	{
-		vkCmdBindPipeline(command_buffers_[img_idx_], VK_PIPELINE_BIND_POINT_GRAPHICS,
-		                  mat_.get_pipeline());
+		// Objects with the same texture share their set, so their draws are recorded
+		// without binding it again.
+		frame_sets_ = frame_arena::get().alloc<frame_set>(objects_.size());
+		frame_set_cnt_ = 0;
+
+		// Objects are iterated densely, their handles are resolved once per draw.
+		// Material and model slots are small indices, used as they are in the keys.
+		geometry_pool& pool = instance::get().get_geometry_pool();
+		for (uint32_t i {0}; i < objects_.size(); ++i)
+		{
+			object const&    obj = objects_[i];
+			material_handle  mat = obj.mat.valid() ? obj.mat : default_mat_;
+			material* const* m = materials_.get(mat);
+			model const*     mod = models_.get(obj.model);
+			if (!m || !mod)
+				continue;
+
+			render_queue::draw d;
+			d.mat = *m;
+			d.set = frame_descriptor_set(obj.tex);
+			if (!d.set)
+				continue;
+			d.vertices = pool.get_vertex_buffer();
+			d.indices = pool.get_index_buffer();
+			d.first_idx = mod->first_idx;
+			d.vertex_off = mod->vertex_off;
+			d.idx_cnt = mod->idc_size;
+			d.push = &obj.trs;
+			d.push_size = sizeof(mat4);
+
+			vec4     pos = obj.pos * view_;
+			float    depth = sqrtf(pos.dot3(pos)) / far_;
+			uint64_t key = render_queue::make_key(
+				0, mat.idx, render_queue::handle_id(d.set), obj.model.idx, depth);
+			queue_.submit(key, d);
+		}
 
-		for (uint32_t i {0}; i < objs_.size(); ++i)
-			record_command_buffer(command_buffers_[img_idx_], objs_[i]);
+		queue_.flush(command_buffers_[cur_frame_]);
 	}
 
 	bool context::present()
 	{
 		instance& inst = instance::get();
 
-		vkCmdEndRendering(command_buffers_[img_idx_]);
-
-		inst.transition_image_layout(
-			command_buffers_[img_idx_], surface_.get_images()[img_idx_],
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,          // srcAccessMask
-			0,                                             // dstAccessMask
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, // srcStage
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT           // dstStage
-		);
+		graph_.end_pass();
+		graph_.end_execute();
 
-		vkEndCommandBuffer(command_buffers_[img_idx_]);
+		vkEndCommandBuffer(command_buffers_[cur_frame_]);
 		VkSubmitInfo submit_info {};
 		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSemaphore          sem_wait[] {img_avail_semaphores_[img_idx_]};
+		VkSemaphore          sem_wait[] {img_avail_semaphores_[cur_frame_]};
 		VkPipelineStageFlags stages_wait[] {
 			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 		submit_info.waitSemaphoreCount = 1;
 		submit_info.pWaitSemaphores = sem_wait;
 		submit_info.pWaitDstStageMask = stages_wait;
 		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &command_buffers_[img_idx_];
+		submit_info.pCommandBuffers = &command_buffers_[cur_frame_];
+
+		// The timeline tells the deletion queue which frames completed.
+		deletion_queue& deletions = inst.get_deletion_queue();
 
-		VkSemaphore sem_signal[] {draw_end_semaphores_[img_idx_]};
-		submit_info.signalSemaphoreCount = 1;
+		VkSemaphore sem_signal[] {draw_end_semaphores_[img_idx_],
+		                          deletions.get_timeline()};
+		uint64_t    signal_values[] {0, deletions.frame_value()};
+		submit_info.signalSemaphoreCount = 2;
 		submit_info.pSignalSemaphores = sem_signal;
 
+		VkTimelineSemaphoreSubmitInfo timeline_info {};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.signalSemaphoreValueCount = 2;
+		timeline_info.pSignalSemaphoreValues = signal_values;
+		submit_info.pNext = &timeline_info;
+
 		vkQueueSubmit(inst.get_graphics_queue(), 1, &submit_info,
-		              in_flight_fences_[img_idx_]);
+		              in_flight_fences_[cur_frame_]);
+		deletions.end_frame();
 
 		VkPresentInfoKHR present_info {};
 		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -440,7 +716,7 @@ namespace vkb::vk
 		if (need_swapchain_update)
 			recreate_swapchain();
 
-		cur_frame_ = (cur_frame_ + 1) % context::max_frames_in_flight;
+		cur_frame_ = (cur_frame_ + 1) % max_frames_in_flight;
 
 		return need_swapchain_update;
 	}
@@ -462,24 +738,24 @@ namespace vkb::vk
 		rendering_info.colorAttachmentCount = 1;
 		surface_format_ = surface_.get_format().format;
 		rendering_info.pColorAttachmentFormats = &surface_format_;
-		rendering_info.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+		rendering_info.depthAttachmentFormat = inst.get_depth_format();
 
 		init_info.PipelineInfoMain.PipelineRenderingCreateInfo = rendering_info;
 		init_info.PipelineInfoMain.Subpass = 0;
-		init_info.MinImageCount = context::max_frames_in_flight;
-		init_info.ImageCount = context::max_frames_in_flight;
+		init_info.MinImageCount = max_frames_in_flight;
+		init_info.ImageCount = max_frames_in_flight;
 		init_info.PipelineInfoMain.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 		init_info.Allocator = nullptr;
 	}
 
 	VkCommandBuffer context::current_command_buffer()
 	{
-		return command_buffers_[img_idx_];
+		return command_buffers_[cur_frame_];
 	}
 
-	uint32_t context::current_img_idx()
+	uint32_t context::current_frame()
 	{
-		return img_idx_;
+		return cur_frame_;
 	}
 
 	void context::wait_completion()
@@ -493,6 +769,21 @@ namespace vkb::vk
 		return proj_;
 	}
 
+	material& context::get_material()
+	{
+		return mat_;
+	}
+
+	render_queue::stats const& context::get_draw_stats() const
+	{
+		return queue_.get_stats();
+	}
+
+	render_graph const& context::get_render_graph() const
+	{
+		return graph_;
+	}
+
 	bool context::create_image_view(VkImage& img, VkFormat format,
 	                                VkImageAspectFlags flags, uint32_t mip_lvl,
 	                                VkImageView& img_view)
@@ -565,59 +856,183 @@ namespace vkb::vk
 			return nullptr;
 	}
 
-	bool context::create_texture_image(texture& tex, mc::string_view path)
+	bool context::create_texture_images(texture* const*                 texs,
+	                                    mc::array_view<mc::string_view> paths)
 	{
 		instance& inst = instance::get();
 
-		int32_t  w, h, c;
-		uint8_t* pix = stbi_load(path.data(), &w, &h, &c, STBI_rgb_alpha);
-		if (!pix)
+		time::stamp start = time::now();
+
+		mc::vector<texture_load> loads;
+		loads.resize(paths.size());
+
+		// Headers only, to size the staging buffer before decoding.
+		auto read_info = [&](uint32_t i)
+		{
+			texture_load& load = loads[i];
+			if (!pack::get().load(paths[i], load.file))
+				return;
+
+			if (read_baked(load))
+				return;
+
+			int32_t c;
+			load.loaded = stbi_info_from_memory(load.file.data, load.file.size, &load.w,
+			                                    &load.h, &c);
+			load.size = static_cast<uint64_t>(load.w) * load.h * 4;
+		};
+		thread::parallel_for(paths.size(), read_info);
+
+		uint64_t size {0};
+		uint32_t baked_cnt {0};
+		for (uint32_t i {0}; i < loads.size(); ++i)
+		{
+			if (!loads[i].loaded)
+			{
+				log::error("Failed to read texture %s", paths[i].data());
+				return false;
+			}
+
+			if (loads[i].baked)
+			{
+				VkFormat           format = static_cast<VkFormat>(loads[i].baked->format);
+				VkFormatProperties props;
+				vkGetPhysicalDeviceFormatProperties(inst.get_physical_device(), format,
+				                                    &props);
+				if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+				{
+					log::error("Unsupported format %s for texture %s",
+					           string_VkFormat(format), paths[i].data());
+					return false;
+				}
+				++baked_cnt;
+			}
+
+			// Keeps the levels of baked textures aligned on their texel blocks.
+			uint64_t align = texture_format::alignment;
+			size = (size + align - 1) & ~(align - 1);
+			loads[i].offset = size;
+			size += loads[i].size;
+		}
+
+		// Released with the next submission of the ring, even if decoding fails.
+		staging_ring&        ring = inst.get_staging_ring();
+		staging_ring::region staging = ring.reserve(size, texture_format::alignment);
+
+		auto decode = [&](uint32_t i)
+		{
+			texture_load& load = loads[i];
+			uint8_t*      slot = staging.data + load.offset;
+
+			// Baked levels are copied straight from the pack mapping.
+			if (load.baked)
+			{
+				texture_format::level const* lvls = baked_levels(load);
+				memcpy(slot, load.file.data + lvls[0].off, load.size);
+				return;
+			}
+
+			load.loaded = false;
+			decode_dst = {slot, load.size, false};
+			int32_t  w, h, c;
+			uint8_t* pix = stbi_load_from_memory(load.file.data, load.file.size, &w, &h,
+			                                     &c, STBI_rgb_alpha);
+			decode_dst = {};
+
+			if (!pix || w != load.w || h != load.h)
+			{
+				if (pix != slot)
+					stbi_image_free(pix);
+				return;
+			}
+
+			if (pix != slot)
+			{
+				memcpy(slot, pix, load.size);
+				stbi_image_free(pix);
+			}
+			load.loaded = true;
+		};
+		thread::parallel_for(paths.size(), decode);
+
+		bool res {true};
+		for (uint32_t i {0}; i < loads.size(); ++i)
+		{
+			if (!loads[i].loaded)
+			{
+				log::error("Failed to decode texture %s", paths[i].data());
+				res = false;
+			}
+		}
+
+		if (!res)
 			return false;
 
-		tex.mip_lvl = floor(log2(w > h ? w : h));
-		uint64_t size = w * h * 4;
+		VkCommandBuffer cmd = ring.begin_commands();
 
-		VkBuffer      staging_buf;
-		VmaAllocation staging_buf_mem;
-		create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-		                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-		              staging_buf, staging_buf_mem);
+		for (uint32_t i {0}; i < paths.size(); ++i)
+		{
+			texture&            tex = *texs[i];
+			texture_load const& load = loads[i];
 
-		void* data;
-		vmaMapMemory(inst.get_allocator(), staging_buf_mem, &data);
-		memcpy(data, pix, size);
-		vmaUnmapMemory(inst.get_allocator(), staging_buf_mem);
+			VkImageUsageFlags usage =
+				VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			if (load.baked)
+			{
+				tex.mip_lvl = load.baked->lvl_cnt;
+				tex.format = static_cast<VkFormat>(load.baked->format);
+			}
+			else
+			{
+				tex.mip_lvl = floor(log2(load.w > load.h ? load.w : load.h));
+				tex.format = VK_FORMAT_R8G8B8A8_SRGB;
+				usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			}
 
-		stbi_image_free(pix);
+			tex.img = inst.create_image(load.w, load.h, tex.mip_lvl, tex.format,
+			                            VK_IMAGE_TILING_OPTIMAL, usage,
+			                            mem_intent::gpu_static, mem_category::textures);
 
-		tex.img = inst.create_image(
-			w, h, tex.mip_lvl, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-				VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			inst.transition_image_layout(
+				cmd, tex.img.image, VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_IMAGE_ASPECT_COLOR_BIT, tex.mip_lvl);
 
-		VkCommandBuffer cmd = inst.begin_commands();
+			if (load.baked)
+			{
+				copy_baked_levels(cmd, staging.buffer, staging.offset + load.offset, load,
+				                  tex.img.image);
+				inst.transition_image_layout(
+					cmd, tex.img.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					VK_IMAGE_ASPECT_COLOR_BIT, tex.mip_lvl);
+				continue;
+			}
 
-		inst.transition_image_layout(
-			cmd, tex.img.image, VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT, tex.mip_lvl);
+			copy_buffer_to_image(cmd, staging.buffer, staging.offset + load.offset,
+			                     tex.img.image, load.w, load.h);
+			generate_mips(cmd, tex.img.image, VK_FORMAT_R8G8B8A8_SRGB, load.w, load.h,
+			              tex.mip_lvl);
+		}
 
-		inst.end_commands(cmd);
-		copy_buffer_to_image(staging_buf, tex.img.image, w, h);
-		generate_mips(tex.img.image, VK_FORMAT_R8G8B8A8_SRGB, w, h, tex.mip_lvl);
+		ring.submit(cmd);
 
-		vmaDestroyBuffer(inst.get_allocator(), staging_buf, staging_buf_mem);
+		// Read, decode or copy, and record: the CPU side of the upload.
+		double ms = time::elapsed_ms(start, time::now());
+		double mib = size / (1024. * 1024.);
+		log::debug("Staged %.2f MiB of textures (%u baked) in %.2fms, %.1f MiB/s", mib,
+		           baked_cnt, ms, ms > 0. ? mib / (ms / 1000.) : 0.);
 
 		return true;
 	}
 
 	bool context::create_texture_image_view(texture& tex)
 	{
-		return create_image_view(tex.img.image, VK_FORMAT_R8G8B8A8_SRGB,
-		                         VK_IMAGE_ASPECT_COLOR_BIT, tex.mip_lvl, tex.img_view);
+		return create_image_view(tex.img.image, tex.format, VK_IMAGE_ASPECT_COLOR_BIT,
+		                         tex.mip_lvl, tex.img_view);
 	}
 
 	bool context::create_texture_sampler(texture& tex)
@@ -632,34 +1047,31 @@ namespace vkb::vk
 		sampler.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 		sampler.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 		sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		// The view already limits the levels, leaving maxLod unclamped lets textures
+		// with different mip counts share the sampler.
 		sampler.minLod = 0.f;
-		sampler.maxLod = tex.mip_lvl;
+		sampler.maxLod = VK_LOD_CLAMP_NONE;
 		sampler.mipLodBias = 0.f;
 
-		VkPhysicalDeviceProperties props {};
-		vkGetPhysicalDeviceProperties(inst.get_physical_device(), &props);
 		sampler.anisotropyEnable = VK_TRUE;
-		sampler.maxAnisotropy = props.limits.maxSamplerAnisotropy;
+		sampler.maxAnisotropy = inst.get_device_properties().limits.maxSamplerAnisotropy;
 
 		sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
 		sampler.unnormalizedCoordinates = VK_FALSE;
 		sampler.compareEnable = VK_FALSE;
 		sampler.compareOp = VK_COMPARE_OP_ALWAYS;
-		sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
-		VkResult res =
-			vkCreateSampler(inst.get_device(), &sampler, nullptr, &tex.sampler);
-		return res == VK_SUCCESS;
+		tex.sampler = inst.get_sampler(sampler);
+		return tex.sampler;
 	}
 
-	void context::copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t w,
+	void context::copy_buffer_to_image(VkCommandBuffer cmd, VkBuffer buffer,
+	                                   uint64_t offset, VkImage image, uint32_t w,
 	                                   uint32_t h)
 	{
-		instance&       inst = instance::get();
-		VkCommandBuffer cmd = inst.begin_commands();
-
 		VkBufferImageCopy2 copy {};
 		copy.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+		copy.bufferOffset = offset;
 		copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		copy.imageSubresource.layerCount = 1;
 		copy.imageExtent.width = w;
@@ -675,22 +1087,17 @@ namespace vkb::vk
 		info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 
 		vkCmdCopyBufferToImage2(cmd, &info);
-
-		inst.end_commands(cmd);
 	}
 
-	void context::generate_mips(VkImage img, VkFormat format, uint32_t w, uint32_t h,
-	                            uint32_t mip_lvl)
+	void context::generate_mips(VkCommandBuffer cmd, VkImage img, VkFormat format,
+	                            uint32_t w, uint32_t h, uint32_t mip_lvl)
 	{
-		instance& inst = instance::get();
-
 		VkFormatProperties props;
 		vkGetPhysicalDeviceFormatProperties(instance::get().get_physical_device(), format,
 		                                    &props);
 		if (!(props.optimalTilingFeatures &
 		      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
 			return;
-		VkCommandBuffer cmd = inst.begin_commands();
 
 		VkImageMemoryBarrier barrier {};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -760,150 +1167,28 @@ namespace vkb::vk
 		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
 		                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
 		                     nullptr, 1, &barrier);
-
-		inst.end_commands(cmd);
-	}
-
-	bool context::create_vertex_buffer(model& model, mc::array_view<model::vert> verts)
-	{
-		instance& inst = instance::get();
-
-		uint64_t buf_size {sizeof(model::vert) * verts.size()};
-
-		VkBuffer      staging_buf {nullptr};
-		VmaAllocation staging_buf_memory {nullptr};
-
-		bool res = create_buffer(buf_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-		                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		                         staging_buf, staging_buf_memory);
-		if (!res)
-			return false;
-
-		void* buff_mem;
-		vmaMapMemory(inst.get_allocator(), staging_buf_memory, &buff_mem);
-		memcpy(buff_mem, verts.data(), buf_size);
-		vmaUnmapMemory(inst.get_allocator(), staging_buf_memory);
-
-		res = create_buffer(buf_size,
-		                    VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-		                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, model.vertex_buffer_,
-		                    model.vertex_buffer_memory_);
-
-		copy_buffer(staging_buf, model.vertex_buffer_, buf_size);
-		vmaDestroyBuffer(inst.get_allocator(), staging_buf, staging_buf_memory);
-
-		return res;
-	}
-
-	bool context::create_index_buffer(model& model, mc::array_view<uint16_t> idcs)
-	{
-		instance& inst = instance::get();
-
-		uint64_t buf_size {sizeof(uint16_t) * idcs.size()};
-
-		VkBuffer      staging_buf {nullptr};
-		VmaAllocation staging_buf_memory {nullptr};
-
-		bool res = create_buffer(buf_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-		                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		                         staging_buf, staging_buf_memory);
-		if (!res)
-			return false;
-
-		void* buff_mem;
-		vmaMapMemory(inst.get_allocator(), staging_buf_memory, &buff_mem);
-		memcpy(buff_mem, idcs.data(), buf_size);
-		vmaUnmapMemory(inst.get_allocator(), staging_buf_memory);
-
-		res = create_buffer(
-			buf_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, model.index_buffer_,
-			model.index_buffer_memory_);
-
-		copy_buffer(staging_buf, model.index_buffer_, buf_size);
-
-		vmaDestroyBuffer(inst.get_allocator(), staging_buf, staging_buf_memory);
-
-		model.idc_size = idcs.size();
-
-		return res;
 	}
 
 	bool context::create_uniform_buffers()
 	{
 		uint64_t buf_size = 2 * sizeof(mat4);
 
-		for (uint32_t i {0}; i < context::max_frames_in_flight; ++i)
+		for (uint32_t i {0}; i < max_frames_in_flight; ++i)
 		{
-			create_buffer(buf_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-			                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			              staging_uniform_buffers_[i],
-			              staging_uniform_buffers_memory_[i]);
-			create_buffer(buf_size,
-			              VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-			                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uniform_buffers_[i],
-			              uniform_buffers_memory_[i]);
+			uniform_buffers_[i] = instance::get().create_buffer(
+				buf_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, mem_intent::dynamic_upload,
+				mem_category::uniforms);
 		}
 
 		return true;
 	}
 
-	bool context::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage,
-	                            [[maybe_unused]] VkMemoryPropertyFlags props,
-	                            VkBuffer& buf, VmaAllocation& buf_mem)
-	{
-		instance& inst = instance::get();
-
-		VkBufferCreateInfo create_info {};
-		create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		create_info.size = size;
-		create_info.usage = usage;
-		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VmaAllocationCreateInfo                 alloc_info {};
-		VkPhysicalDeviceMemoryProperties const* mem_props;
-		vmaGetMemoryProperties(inst.get_allocator(), &mem_props);
-		for (uint32_t i {0}; i < mem_props->memoryTypeCount; ++i)
-			if ((mem_props->memoryTypes[i].propertyFlags & props) == props)
-				alloc_info.memoryTypeBits = 1 << i;
-		VkResult res =
-			vmaCreateBuffer(reinterpret_cast<VmaAllocator>(inst.get_allocator()),
-		                    &create_info, &alloc_info, &buf, &buf_mem, nullptr);
-
-		return res == VK_SUCCESS;
-	}
-
-	void context::copy_buffer(VkBuffer src, VkBuffer dst, uint64_t size)
-	{
-		instance&       inst = instance::get();
-		VkCommandBuffer cmd = inst.begin_commands();
-
-		VkBufferCopy2 region {};
-		region.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
-		region.size = size;
-		VkCopyBufferInfo2 copy {};
-		copy.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
-		copy.srcBuffer = src;
-		copy.dstBuffer = dst;
-		copy.regionCount = 1;
-		copy.pRegions = &region;
-
-		vkCmdCopyBuffer2(cmd, &copy);
-
-		inst.end_commands(cmd);
-	}
-
 	void context::create_command_buffers()
 	{
 		mc::vector<VkCommandBuffer> cmds =
-			instance::get().allocate_commands(context::max_frames_in_flight);
+			instance::get().allocate_commands(max_frames_in_flight);
 
-		for (uint32_t i {0}; i < context::max_frames_in_flight; ++i)
+		for (uint32_t i {0}; i < max_frames_in_flight; ++i)
 			command_buffers_[i] = cmds[i];
 	}
 
@@ -918,118 +1203,115 @@ namespace vkb::vk
 		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 		fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-		for (uint8_t i {0}; i < context::max_frames_in_flight; ++i)
+		for (uint8_t i {0}; i < max_frames_in_flight; ++i)
 		{
 			VkResult res1 = vkCreateSemaphore(inst.get_device(), &sem_info, nullptr,
 			                                  &img_avail_semaphores_[i]);
-			VkResult res2 = vkCreateSemaphore(inst.get_device(), &sem_info, nullptr,
-			                                  &draw_end_semaphores_[i]);
-			VkResult res3 = vkCreateFence(inst.get_device(), &fence_info, nullptr,
+			VkResult res2 = vkCreateFence(inst.get_device(), &fence_info, nullptr,
 			                              &in_flight_fences_[i]);
 
-			if (res1 != VK_SUCCESS && res2 != VK_SUCCESS && res3 != VK_SUCCESS)
+			if (res1 != VK_SUCCESS && res2 != VK_SUCCESS)
+				return false;
+		}
+		return create_draw_end_semaphores();
+	}
+
+	bool context::create_draw_end_semaphores()
+	{
+		instance& inst = instance::get();
+
+		VkSemaphoreCreateInfo sem_info {};
+		sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		// Only the missing ones, they are kept when the swapchain is recreated.
+		uint32_t cnt = surface_.get_images().size();
+		while (draw_end_semaphores_.size() < cnt)
+		{
+			VkSemaphore sem {nullptr};
+			if (vkCreateSemaphore(inst.get_device(), &sem_info, nullptr, &sem) !=
+			    VK_SUCCESS)
 				return false;
+			draw_end_semaphores_.emplace_back(sem);
 		}
 		return true;
 	}
 
 	bool context::create_descriptor_pool()
 	{
-		// TODO nvidia not coherent with spec. This will surely cause issues
-		VkDescriptorPoolSize pool_sizes[] = {
-			{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          10001},
-			{VK_DESCRIPTOR_TYPE_SAMPLER,                10001},
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         10001},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1    }
-        };
+		// Only used by ImGui, which frees its sets. Object sets are allocated per frame
+		// from the descriptor allocator.
+		VkDescriptorPoolSize pool_size {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 16};
 		VkDescriptorPoolCreateInfo pool_info {};
 		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-		pool_info.maxSets = context::max_frames_in_flight * 10001;
-		pool_info.pPoolSizes = pool_sizes;
-		pool_info.poolSizeCount = 4;
+		pool_info.maxSets = 16;
+		pool_info.pPoolSizes = &pool_size;
+		pool_info.poolSizeCount = 1;
 		VkResult res = vkCreateDescriptorPool(instance::get().get_device(), &pool_info,
 		                                      nullptr, &desc_pool_);
 
 		return res == VK_SUCCESS;
 	}
 
-	bool context::create_descriptor_sets(object* obj)
+	VkDescriptorSet context::frame_descriptor_set(texture_handle handle)
 	{
-		instance& inst = instance::get();
-
-		VkDescriptorSetLayout layouts[context::max_frames_in_flight] {
-			mat_.get_descriptor_set_layout(), mat_.get_descriptor_set_layout(),
-			mat_.get_descriptor_set_layout()};
-		VkDescriptorSetAllocateInfo alloc_info {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		alloc_info.descriptorPool = desc_pool_;
-		alloc_info.descriptorSetCount = context::max_frames_in_flight;
-		alloc_info.pSetLayouts = layouts;
-
-		VkResult res =
-			vkAllocateDescriptorSets(inst.get_device(), &alloc_info, obj->desc_sets_);
-		if (res != VK_SUCCESS)
-			return false;
-
-		for (uint32_t i {0}; i < context::max_frames_in_flight; ++i)
+		for (uint32_t i {0}; i < frame_set_cnt_; ++i)
 		{
-			VkDescriptorBufferInfo buf_info {};
-			buf_info.buffer = uniform_buffers_[i];
-			buf_info.offset = 0;
-			buf_info.range = 2 * sizeof(mat4);
-
-			VkDescriptorImageInfo img_info {};
-			img_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			img_info.imageView = obj->tex->img_view;
-			img_info.sampler = obj->tex->sampler;
-
-			VkWriteDescriptorSet write[3];
-			memset(write, 0, 3 * sizeof(VkWriteDescriptorSet));
-			write[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write[0].dstSet = obj->desc_sets_[i];
-			write[0].dstBinding = 0;
-			write[0].dstArrayElement = 0;
-			write[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			write[0].descriptorCount = 1;
-			write[0].pBufferInfo = &buf_info;
-
-			write[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write[1].dstSet = obj->desc_sets_[i];
-			write[1].dstBinding = 1;
-			write[1].dstArrayElement = 0;
-			write[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-			write[1].descriptorCount = 1;
-			write[1].pImageInfo = &img_info;
-
-			write[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write[2].dstSet = obj->desc_sets_[i];
-			write[2].dstBinding = 2;
-			write[2].dstArrayElement = 0;
-			write[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-			write[2].descriptorCount = 1;
-			write[2].pImageInfo = &img_info;
-
-			vkUpdateDescriptorSets(inst.get_device(), 3, write, 0, nullptr);
+			if (frame_sets_[i].tex == handle)
+				return frame_sets_[i].set;
 		}
 
-		return true;
-	}
+		texture const* tex = textures_.get(handle);
+		if (!tex || !tex->img_view)
+			return nullptr;
 
-	void context::record_command_buffer(VkCommandBuffer cmd, object* obj)
-	{
-		vkCmdPushConstants(cmd, mat_.get_pipeline_layout(), VK_SHADER_STAGE_VERTEX_BIT, 0,
-		                   sizeof(mat4), &obj->trs);
-
-		VkBuffer     buffs[] {obj->model->vertex_buffer_};
-		VkDeviceSize offsets[] {0};
-		vkCmdBindVertexBuffers(cmd, 0, 1, buffs, offsets);
-		vkCmdBindIndexBuffer(cmd, obj->model->index_buffer_, 0, VK_INDEX_TYPE_UINT16);
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-		                        mat_.get_pipeline_layout(), 0, 1,
-		                        &obj->desc_sets_[img_idx_], 0, nullptr);
-
-		vkCmdDrawIndexed(cmd, obj->model->idc_size, 1, 0, 0, 0);
+		instance&       inst = instance::get();
+		VkDescriptorSet set = inst.get_descriptor_allocator().allocate_transient(
+			mat_.get_descriptor_set_layout(0));
+		if (!set)
+			return nullptr;
+
+		VkDescriptorBufferInfo buf_info {};
+		buf_info.buffer = uniform_buffers_[cur_frame_].buffer;
+		buf_info.offset = 0;
+		buf_info.range = 2 * sizeof(mat4);
+
+		VkDescriptorImageInfo img_info {};
+		img_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		img_info.imageView = tex->img_view;
+		img_info.sampler = tex->sampler;
+
+		VkWriteDescriptorSet write[3];
+		memset(write, 0, 3 * sizeof(VkWriteDescriptorSet));
+		write[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write[0].dstSet = set;
+		write[0].dstBinding = 0;
+		write[0].dstArrayElement = 0;
+		// Uniform blocks of materials have dynamic offsets, always 0 here.
+		write[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write[0].descriptorCount = 1;
+		write[0].pBufferInfo = &buf_info;
+
+		write[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write[1].dstSet = set;
+		write[1].dstBinding = 1;
+		write[1].dstArrayElement = 0;
+		write[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		write[1].descriptorCount = 1;
+		write[1].pImageInfo = &img_info;
+
+		write[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write[2].dstSet = set;
+		write[2].dstBinding = 2;
+		write[2].dstArrayElement = 0;
+		write[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+		write[2].descriptorCount = 1;
+		write[2].pImageInfo = &img_info;
+
+		vkUpdateDescriptorSets(inst.get_device(), 3, write, 0, nullptr);
+
+		frame_sets_[frame_set_cnt_++] = frame_set {handle, set};
+		return set;
 	}
 
 	void context::recreate_swapchain()
@@ -1038,6 +1320,7 @@ namespace vkb::vk
 
 		surface_.destroy_swapchain();
 		surface_.create_swapchain();
+		create_draw_end_semaphores();
 
 		auto [w, h] = surface_.get_extent();
 		proj_ = mat4::persp_proj(near_, far_, w / (float)h, rad(fov_deg_));
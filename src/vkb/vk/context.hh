@@ -1,10 +1,15 @@
 #pragma once
 
+#include "../core/frames.hh"
 #include "../math/mat4.hh"
 #include "object.hh"
 
+#include "buffer.hh"
 #include "material.hh"
+#include "render_graph.hh"
+#include "render_queue.hh"
 #include "surface.hh"
+#include "texture_streamer.hh"
 
 #include <array_view.hh>
 #include <string_view.hh>
@@ -46,15 +51,38 @@ namespace vkb::vk
 
 		void set_proj(float near, float far, float fov_deg);
 
-		bool init_model(model& model, mc::array_view<model::vert> verts,
-		                mc::array_view<uint16_t> idcs);
-		void destroy_model(model& model);
-
-		bool init_texture(texture& tex, mc::string_view path);
-		void destroy_texture(texture& tex);
-
-		bool init_object(object* obj);
-		void destroy_object(object* obj);
+		// Resources are referenced by handle, the returned handles are invalid on
+		// failure. Pointers from the getters are valid until the next init or destroy
+		// of the same kind, and are nullptr for stale handles.
+		// Destroying doesn't wait for the device: the handle is stale right away, and
+		// the GPU objects go through the deletion queue of the instance.
+		model_handle init_model(mc::array_view<model::vert> verts,
+		                        mc::array_view<uint16_t>    idcs);
+		void         destroy_model(model_handle model);
+		model const* get_model(model_handle model) const;
+
+		texture_handle init_texture(mc::string_view path);
+
+		// Decodes the images concurrently and uploads them in a single submission.
+		// texs receives one handle per path.
+		bool init_textures(mc::array_view<mc::string_view> paths, texture_handle* texs);
+
+		// Texture whose finer levels are streamed depending on its size on screen.
+		texture_handle stream_texture(mc::string_view path);
+		void           destroy_texture(texture_handle tex);
+		// GPU memory the resident levels of the streamed textures are kept under.
+		void           set_stream_budget(uint64_t budget);
+
+		// Materials stay owned by the caller, and must be unregistered before being
+		// destroyed. Drawing objects, they must use the descriptor set layout of the
+		// context material.
+		material_handle register_material(material& mat);
+		void            unregister_material(material_handle mat);
+
+		object_handle init_object(object const& obj);
+		void          destroy_object(object_handle obj);
+		object*       get_object(object_handle obj);
+		void          update_objects(double dt);
 
 		bool prepare_draw(cam::base& cam);
 		void begin_draw();
@@ -64,16 +92,23 @@ namespace vkb::vk
 		void fill_init_info(ImGui_ImplVulkan_InitInfo& init_info);
 
 		VkCommandBuffer current_command_buffer();
-		uint32_t        current_img_idx();
+		// Index of the frame in flight being recorded, in [0, max_frames_in_flight).
+		uint32_t        current_frame();
 
 		void wait_completion();
 
 		mat4 get_proj();
 
+		material& get_material();
+
+		// Of the last recorded frame.
+		render_queue::stats const& get_draw_stats() const;
+		render_graph const&        get_render_graph() const;
+
 	private:
-		constexpr static uint8_t max_frames_in_flight {3};
-		uint8_t                  cur_frame_ {0};
-		uint32_t                 img_idx_ {0};
+		// Indexes the per frame resources, img_idx_ the swapchain images.
+		uint8_t  cur_frame_ {0};
+		uint32_t img_idx_ {0};
 
 		bool create_image_view(VkImage& img, VkFormat format, VkImageAspectFlags flags,
 		                       uint32_t mip_lvl, VkImageView& img_view);
@@ -84,27 +119,26 @@ namespace vkb::vk
 
 		VkShaderModule create_shader(uint8_t* spirv, uint32_t spirv_size);
 
-		bool create_texture_image(texture& tex, mc::string_view path);
+		// One texture per path.
+		bool create_texture_images(texture* const*                 texs,
+		                           mc::array_view<mc::string_view> paths);
 		bool create_texture_image_view(texture& tex);
 		bool create_texture_sampler(texture& tex);
-		void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t w, uint32_t h);
-		void generate_mips(VkImage img, VkFormat format, uint32_t w, uint32_t h,
-		                   uint32_t mip_lvl);
-		bool create_vertex_buffer(model& model, mc::array_view<model::vert> verts);
-		bool create_index_buffer(model& model, mc::array_view<uint16_t> idcs);
+		void copy_buffer_to_image(VkCommandBuffer cmd, VkBuffer buffer, uint64_t offset,
+		                          VkImage image, uint32_t w, uint32_t h);
+		void generate_mips(VkCommandBuffer cmd, VkImage img, VkFormat format, uint32_t w,
+		                   uint32_t h, uint32_t mip_lvl);
 		bool create_uniform_buffers();
-		bool create_buffer(VkDeviceSize size, VkBufferUsageFlags usage,
-		                   VkMemoryPropertyFlags props, VkBuffer& buf,
-		                   VmaAllocation& buf_mem);
-		void copy_buffer(VkBuffer src, VkBuffer dst, uint64_t size);
 
 		void create_command_buffers();
 		bool create_sync_objects();
+		// One per swapchain image, signaled by the frame rendering it and waited by
+		// its presentation.
+		bool create_draw_end_semaphores();
 
 		bool create_descriptor_pool();
-		bool create_descriptor_sets(object* obj);
-
-		void record_command_buffer(VkCommandBuffer cmd, object* obj);
+		// Set of the objects using tex for the current frame, written on first use.
+		VkDescriptorSet frame_descriptor_set(texture_handle tex);
 
 		void recreate_swapchain();
 
@@ -122,31 +156,45 @@ namespace vkb::vk
 		// VkPipeline            graphics_pipe_ {nullptr};
 		VkPipelineCache pipe_cache_ {VK_NULL_HANDLE};
 
-		VkCommandBuffer command_buffers_[context::max_frames_in_flight] {nullptr};
+		VkCommandBuffer command_buffers_[max_frames_in_flight] {nullptr};
 
 		mc::vector<VkSemaphore> recycled_semaphores_;
-		VkSemaphore img_avail_semaphores_[context::max_frames_in_flight] {nullptr};
-		VkSemaphore draw_end_semaphores_[context::max_frames_in_flight] {nullptr};
-		VkFence     in_flight_fences_[context::max_frames_in_flight] {nullptr};
+		VkSemaphore img_avail_semaphores_[max_frames_in_flight] {nullptr};
+		VkFence     in_flight_fences_[max_frames_in_flight] {nullptr};
+		mc::vector<VkSemaphore> draw_end_semaphores_;
 
 		VkDescriptorPool desc_pool_ {VK_NULL_HANDLE};
 
-		VkBuffer      staging_uniform_buffers_[context::max_frames_in_flight] {nullptr};
-		VmaAllocation staging_uniform_buffers_memory_[context::max_frames_in_flight] {
-			nullptr};
-		VkBuffer      uniform_buffers_[context::max_frames_in_flight] {nullptr};
-		VmaAllocation uniform_buffers_memory_[context::max_frames_in_flight] {nullptr};
+		buffer uniform_buffers_[max_frames_in_flight];
 
+		mat4  view_;
 		mat4  proj_;
 		float near_ {0.1f};
 		float far_ {100.f};
 		float fov_deg_ {70.f};
 
-		mc::vector<object*> objs_;
-
-		VkFormat      depth_fmt_;
-		VkImage       depth_img_ {nullptr};
-		VmaAllocation depth_img_buf_ {nullptr};
-		VkImageView   depth_img_view_ {nullptr};
+		struct frame_set
+		{
+			texture_handle  tex;
+			VkDescriptorSet set {nullptr};
+		};
+
+		handle_pool<model>               models_;
+		handle_pool<texture>             textures_;
+		handle_pool<material*, material> materials_;
+		handle_pool<object>              objects_;
+		material_handle                  default_mat_;
+
+		// From the frame arena, one per distinct texture drawn.
+		frame_set*   frame_sets_ {nullptr};
+		uint32_t     frame_set_cnt_ {0};
+		render_queue queue_;
+
+		texture_streamer streamer_;
+
+		// Declared again by every begin_draw(), the scene pass is recorded between
+		// begin_draw() and present().
+		render_graph graph_;
+		uint32_t     scene_pass_ {0};
 	};
 }
\ No newline at end of file
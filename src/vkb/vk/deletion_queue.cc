@@ -0,0 +1,128 @@
+#include "deletion_queue.hh"
+
+#include "../log.hh"
+#include "enum_string_helper.hh"
+#include "instance.hh"
+
+#include <string.h>
+
+namespace vkb::vk
+{
+	deletion_queue::deletion_queue()
+	{
+		VkSemaphoreTypeCreateInfo type_info {};
+		type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_info.initialValue = 0;
+		VkSemaphoreCreateInfo sem_info {};
+		sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		sem_info.pNext = &type_info;
+		VkResult res = vkCreateSemaphore(instance::get().get_device(), &sem_info,
+		                                 nullptr, &timeline_);
+		log::assert(res == VK_SUCCESS, "Failed to create frame semaphore (%s)",
+		            string_VkResult(res));
+	}
+
+	deletion_queue::~deletion_queue()
+	{
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+			release(entries_[i]);
+
+		vkDestroySemaphore(instance::get().get_device(), timeline_, nullptr);
+	}
+
+	void deletion_queue::destroy(image const& img, VkImageView view)
+	{
+		entry& e = entries_.emplace_back();
+		e.value = value_;
+		e.img = img;
+		e.view = view;
+	}
+
+	void deletion_queue::destroy(buffer const& buf)
+	{
+		entry& e = entries_.emplace_back();
+		e.value = value_;
+		e.buf = buf;
+	}
+
+	void deletion_queue::free(VmaAllocation alloc)
+	{
+		entry& e = entries_.emplace_back();
+		e.value = value_;
+		e.alloc = alloc;
+	}
+
+	void deletion_queue::defer(callback fn, void const* data, uint32_t size)
+	{
+		log::assert(size <= max_data_size, "Deferred data too large (%u bytes)", size);
+
+		entry& e = entries_.emplace_back();
+		e.value = value_;
+		e.fn = fn;
+		memcpy(e.data, data, size);
+	}
+
+	VkSemaphore deletion_queue::get_timeline() const
+	{
+		return timeline_;
+	}
+
+	uint64_t deletion_queue::frame_value() const
+	{
+		return value_;
+	}
+
+	void deletion_queue::end_frame()
+	{
+		++value_;
+	}
+
+	void deletion_queue::collect()
+	{
+		if (entries_.empty())
+			return;
+
+		uint64_t completed {0};
+		vkGetSemaphoreCounterValue(instance::get().get_device(), timeline_, &completed);
+
+		uint32_t i {0};
+		while (i < entries_.size())
+		{
+			if (entries_[i].value <= completed)
+			{
+				release(entries_[i]);
+				entries_[i] = entries_.back();
+				entries_.pop_back();
+			}
+			else
+				++i;
+		}
+	}
+
+	uint32_t deletion_queue::size() const
+	{
+		return entries_.size();
+	}
+
+	void deletion_queue::release(entry& e)
+	{
+		instance& inst = instance::get();
+
+		if (e.view)
+			vkDestroyImageView(inst.get_device(), e.view, nullptr);
+		if (e.img.image && e.img.memory)
+			inst.destroy_image(e.img);
+		else if (e.img.image)
+			vkDestroyImage(inst.get_device(), e.img.image, nullptr);
+		if (e.buf.buffer && e.buf.memory)
+			inst.destroy_buffer(e.buf);
+		if (e.alloc)
+		{
+			inst.get_memory_stats().on_free(e.alloc);
+			vmaFreeMemory(inst.get_allocator(), e.alloc);
+		}
+		if (e.fn)
+			e.fn(e.data);
+	}
+}
\ No newline at end of file
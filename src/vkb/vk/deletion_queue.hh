@@ -0,0 +1,76 @@
+#pragma once
+
+#include "buffer.hh"
+#include "image.hh"
+
+#include <vector.hh>
+
+#include "vma/vma.hh"
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Objects destroyed once the GPU completed the frames which may use them. Each frame
+	// submission signals the next value of a timeline semaphore, objects are tagged
+	// with the value of the frame being recorded, and destroyed by collect() when the
+	// semaphore reached it. Nothing waits for the device.
+	class deletion_queue
+	{
+	public:
+		// Called with the copy of the data given to defer().
+		using callback = void (*)(void* data);
+
+		constexpr static uint32_t max_data_size {32};
+
+		deletion_queue();
+		deletion_queue(deletion_queue const&) = delete;
+		deletion_queue(deletion_queue&&) = delete;
+		// The device must be idle, everything left is destroyed.
+		~deletion_queue();
+
+		deletion_queue& operator=(deletion_queue const&) = delete;
+		deletion_queue& operator=(deletion_queue&&) = delete;
+
+		// view may be nullptr, as well as img.image. Without img.memory, the image is
+		// bound to memory freed separately.
+		void destroy(image const& img, VkImageView view = nullptr);
+		void destroy(buffer const& buf);
+		// Memory allocated outside of the images and buffers of the instance.
+		void free(VmaAllocation alloc);
+		// For the other objects. data is copied, and must be trivially copyable.
+		void defer(callback fn, void const* data, uint32_t size);
+
+		// Signaled by the submission of the frame being recorded.
+		VkSemaphore get_timeline() const;
+		uint64_t    frame_value() const;
+		// Called once the frame is submitted, the next objects are tagged with the next
+		// frame.
+		void end_frame();
+
+		// Destroys the objects of the completed frames.
+		void collect();
+
+		// Objects waiting for their frame.
+		uint32_t size() const;
+
+	private:
+		struct entry
+		{
+			uint64_t      value {0};
+			image         img;
+			VkImageView   view {nullptr};
+			buffer        buf;
+			VmaAllocation alloc {nullptr};
+			callback      fn {nullptr};
+			alignas(8) uint8_t data[max_data_size];
+		};
+
+		static void release(entry& e);
+
+		VkSemaphore       timeline_ {nullptr};
+		uint64_t          value_ {1};
+		mc::vector<entry> entries_;
+	};
+}
\ No newline at end of file
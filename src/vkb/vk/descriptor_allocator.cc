@@ -0,0 +1,187 @@
+#include "descriptor_allocator.hh"
+
+#include "../log.hh"
+#include "enum_string_helper.hh"
+#include "instance.hh"
+
+namespace vkb::vk
+{
+	namespace
+	{
+		constexpr uint32_t sets_per_pool {64};
+
+		// Roughly what a set of the current shaders holds: a uniform block and a few
+		// textures.
+		constexpr VkDescriptorPoolSize pool_sizes[] {
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, sets_per_pool    },
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         sets_per_pool / 4},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         sets_per_pool / 4},
+			{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          sets_per_pool * 2},
+			{VK_DESCRIPTOR_TYPE_SAMPLER,                sets_per_pool * 2},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, sets_per_pool    },
+			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          sets_per_pool / 4},
+		};
+
+		// Frames a transient pool stays unused before being destroyed, so the pool
+		// count follows the workload without thrashing.
+		constexpr uint32_t idle_frames_before_trim {256};
+
+		bool pool_full(VkResult res)
+		{
+			return res == VK_ERROR_OUT_OF_POOL_MEMORY || res == VK_ERROR_FRAGMENTED_POOL;
+		}
+	}
+
+	descriptor_allocator::~descriptor_allocator()
+	{
+		instance& inst = instance::get();
+
+		for (uint32_t i {0}; i < pools_.size(); ++i)
+			vkDestroyDescriptorPool(inst.get_device(), pools_[i], nullptr);
+
+		for (uint32_t i {0}; i < max_frames_in_flight; ++i)
+		{
+			for (uint32_t j {0}; j < frames_[i].pools.size(); ++j)
+				vkDestroyDescriptorPool(inst.get_device(), frames_[i].pools[j], nullptr);
+		}
+	}
+
+	VkDescriptorSet descriptor_allocator::allocate(VkDescriptorSetLayout layout)
+	{
+		for (uint32_t i {0}; i < free_sets_.size(); ++i)
+		{
+			if (free_sets_[i].layout == layout)
+			{
+				VkDescriptorSet set = free_sets_[i].set;
+				free_sets_[i] = free_sets_.back();
+				free_sets_.pop_back();
+				return set;
+			}
+		}
+
+		// Only the last pool may have room left.
+		VkDescriptorSet set {nullptr};
+		VkResult        res = VK_ERROR_OUT_OF_POOL_MEMORY;
+		if (!pools_.empty())
+			res = allocate_from(pools_.back(), layout, set);
+
+		if (pool_full(res))
+		{
+			VkDescriptorPool pool = create_pool();
+			if (!pool)
+				return nullptr;
+
+			pools_.emplace_back(pool);
+			res = allocate_from(pool, layout, set);
+		}
+
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to allocate descriptor set (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		return set;
+	}
+
+	void descriptor_allocator::free(VkDescriptorSetLayout layout, VkDescriptorSet set)
+	{
+		free_sets_.emplace_back(free_set {layout, set});
+	}
+
+	void descriptor_allocator::begin_frame(uint32_t frame_idx)
+	{
+		instance& inst = instance::get();
+
+		log::assert(frame_idx < max_frames_in_flight, "Frame %u not in flight",
+		            frame_idx);
+		frame_idx_ = frame_idx;
+		frame_pools& frame = frames_[frame_idx_];
+
+		for (uint32_t i {0}; i < frame.used; ++i)
+			vkResetDescriptorPool(inst.get_device(), frame.pools[i], 0);
+
+		if (frame.pools.size() > frame.used && frame.pools.size() > 1)
+		{
+			if (++frame.idle >= idle_frames_before_trim)
+			{
+				vkDestroyDescriptorPool(inst.get_device(), frame.pools.back(), nullptr);
+				frame.pools.pop_back();
+				frame.idle = 0;
+			}
+		}
+		else
+			frame.idle = 0;
+
+		frame.used = 0;
+	}
+
+	VkDescriptorSet descriptor_allocator::allocate_transient(VkDescriptorSetLayout layout)
+	{
+		frame_pools& frame = frames_[frame_idx_];
+
+		// Pools before the current one are full.
+		VkDescriptorSet set {nullptr};
+		VkResult        res = VK_ERROR_OUT_OF_POOL_MEMORY;
+		for (uint32_t i {frame.used ? frame.used - 1 : 0}; i < frame.pools.size(); ++i)
+		{
+			res = allocate_from(frame.pools[i], layout, set);
+			if (!pool_full(res))
+			{
+				frame.used = i + 1;
+				break;
+			}
+		}
+
+		if (pool_full(res))
+		{
+			VkDescriptorPool pool = create_pool();
+			if (!pool)
+				return nullptr;
+
+			frame.pools.emplace_back(pool);
+			frame.used = frame.pools.size();
+			res = allocate_from(pool, layout, set);
+		}
+
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to allocate descriptor set (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		return set;
+	}
+
+	VkDescriptorPool descriptor_allocator::create_pool()
+	{
+		VkDescriptorPoolCreateInfo pool_info {};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.maxSets = sets_per_pool;
+		pool_info.pPoolSizes = pool_sizes;
+		pool_info.poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]);
+
+		VkDescriptorPool pool {nullptr};
+		VkResult res = vkCreateDescriptorPool(instance::get().get_device(), &pool_info,
+		                                      nullptr, &pool);
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to create descriptor pool (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		return pool;
+	}
+
+	VkResult descriptor_allocator::allocate_from(VkDescriptorPool      pool,
+	                                             VkDescriptorSetLayout layout,
+	                                             VkDescriptorSet&      set)
+	{
+		VkDescriptorSetAllocateInfo alloc_info {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = pool;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &layout;
+		return vkAllocateDescriptorSets(instance::get().get_device(), &alloc_info, &set);
+	}
+}
\ No newline at end of file
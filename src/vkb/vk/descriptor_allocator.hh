@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../core/frames.hh"
+
+#include <vector.hh>
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Descriptor sets of any layout, with two lifetimes. Persistent sets are allocated
+	// from a growing list of pools, and recycled for the next allocation with the same
+	// layout once freed. Transient sets live for a frame: each frame has its own pools,
+	// reset at once when the frame is recorded again. Neither needs
+	// VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, so the pools don't fragment.
+	class descriptor_allocator
+	{
+	public:
+		descriptor_allocator() = default;
+		descriptor_allocator(descriptor_allocator const&) = delete;
+		descriptor_allocator(descriptor_allocator&&) = delete;
+		~descriptor_allocator();
+
+		descriptor_allocator& operator=(descriptor_allocator const&) = delete;
+		descriptor_allocator& operator=(descriptor_allocator&&) = delete;
+
+		// Returns nullptr on failure.
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+		// The set must not be used by a frame in flight anymore.
+		void free(VkDescriptorSetLayout layout, VkDescriptorSet set);
+
+		// Resets the transient pools of the frame. frame_idx is the frame in flight, in
+		// [0, max_frames_in_flight), and its previous submission must have completed.
+		void begin_frame(uint32_t frame_idx);
+		// Valid until the frame is begun again. Returns nullptr on failure.
+		VkDescriptorSet allocate_transient(VkDescriptorSetLayout layout);
+
+	private:
+		struct free_set
+		{
+			VkDescriptorSetLayout layout {nullptr};
+			VkDescriptorSet       set {nullptr};
+		};
+
+		struct frame_pools
+		{
+			mc::vector<VkDescriptorPool> pools;
+			// Pools allocated from since the last reset.
+			uint32_t used {0};
+			// Resets since more pools than used were needed.
+			uint32_t idle {0};
+		};
+
+		static VkDescriptorPool create_pool();
+		static VkResult         allocate_from(VkDescriptorPool      pool,
+		                                      VkDescriptorSetLayout layout,
+		                                      VkDescriptorSet&      set);
+
+		mc::vector<VkDescriptorPool> pools_;
+		mc::vector<free_set>         free_sets_;
+
+		frame_pools frames_[max_frames_in_flight];
+		uint32_t    frame_idx_ {0};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "geometry_pool.hh"
+
+#include "../log.hh"
+#include "instance.hh"
+#include "staging_ring.hh"
+
+#include <string.h>
+
+namespace vkb::vk
+{
+	geometry_pool::geometry_pool(uint32_t vert_cap, uint32_t idx_cap)
+	{
+		instance& inst = instance::get();
+
+		vertices_ = inst.create_buffer(sizeof(model::vert) * vert_cap,
+		                               VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		                               mem_intent::gpu_static, mem_category::geometry);
+		indices_ = inst.create_buffer(sizeof(uint16_t) * idx_cap,
+		                              VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+		                                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		                              mem_intent::gpu_static, mem_category::geometry);
+
+		free_verts_.emplace_back(range {0, vert_cap});
+		free_idcs_.emplace_back(range {0, idx_cap});
+	}
+
+	geometry_pool::~geometry_pool()
+	{
+		instance& inst = instance::get();
+
+		inst.destroy_buffer(indices_);
+		inst.destroy_buffer(vertices_);
+	}
+
+	bool geometry_pool::alloc(model& model, mc::array_view<model::vert> verts,
+	                          mc::array_view<uint16_t> idcs)
+	{
+		instance& inst = instance::get();
+
+		uint32_t vert_cnt = verts.size();
+		uint32_t idx_cnt = idcs.size();
+
+		uint32_t vertex_off = alloc_range(free_verts_, vert_cnt);
+		if (vertex_off == UINT32_MAX)
+		{
+			log::error("Geometry pool full, can't allocate %u vertices", vert_cnt);
+			return false;
+		}
+
+		uint32_t first_idx = alloc_range(free_idcs_, idx_cnt);
+		if (first_idx == UINT32_MAX)
+		{
+			log::error("Geometry pool full, can't allocate %u indices", idx_cnt);
+			free_range(free_verts_, range {vertex_off, vert_cnt});
+			return false;
+		}
+
+		uint64_t verts_size {sizeof(model::vert) * vert_cnt};
+		uint64_t idcs_size {sizeof(uint16_t) * idx_cnt};
+
+		staging_ring&        ring = inst.get_staging_ring();
+		staging_ring::region staging = ring.reserve(verts_size + idcs_size);
+		memcpy(staging.data, verts.data(), verts_size);
+		memcpy(staging.data + verts_size, idcs.data(), idcs_size);
+
+		VkCommandBuffer cmd = ring.begin_commands();
+
+		VkBufferCopy2 region {};
+		region.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
+		region.srcOffset = staging.offset;
+		region.dstOffset = sizeof(model::vert) * vertex_off;
+		region.size = verts_size;
+		VkCopyBufferInfo2 copy {};
+		copy.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
+		copy.srcBuffer = staging.buffer;
+		copy.dstBuffer = vertices_.buffer;
+		copy.regionCount = 1;
+		copy.pRegions = &region;
+		vkCmdCopyBuffer2(cmd, &copy);
+
+		region.srcOffset = staging.offset + verts_size;
+		region.dstOffset = sizeof(uint16_t) * first_idx;
+		region.size = idcs_size;
+		copy.dstBuffer = indices_.buffer;
+		vkCmdCopyBuffer2(cmd, &copy);
+
+		ring.submit(cmd);
+
+		model.vertex_off = vertex_off;
+		model.vertex_cnt = vert_cnt;
+		model.first_idx = first_idx;
+		model.idc_size = idx_cnt;
+
+		return true;
+	}
+
+	void geometry_pool::free(model& model)
+	{
+		if (model.vertex_cnt)
+			free_range(free_verts_, range {model.vertex_off, model.vertex_cnt});
+		if (model.idc_size)
+			free_range(free_idcs_, range {model.first_idx, model.idc_size});
+
+		model.vertex_cnt = 0;
+		model.idc_size = 0;
+	}
+
+	void geometry_pool::bind(VkCommandBuffer cmd)
+	{
+		VkDeviceSize offset {0};
+		vkCmdBindVertexBuffers(cmd, 0, 1, &vertices_.buffer, &offset);
+		vkCmdBindIndexBuffer(cmd, indices_.buffer, 0, VK_INDEX_TYPE_UINT16);
+	}
+
+	VkBuffer geometry_pool::get_vertex_buffer() const
+	{
+		return vertices_.buffer;
+	}
+
+	VkBuffer geometry_pool::get_index_buffer() const
+	{
+		return indices_.buffer;
+	}
+
+	uint32_t geometry_pool::alloc_range(mc::vector<range>& free_ranges, uint32_t cnt)
+	{
+		for (uint32_t i {0}; i < free_ranges.size(); ++i)
+		{
+			range& r = free_ranges[i];
+			if (r.cnt < cnt)
+				continue;
+
+			uint32_t off = r.off;
+			r.off += cnt;
+			r.cnt -= cnt;
+			if (!r.cnt)
+			{
+				for (uint32_t j {i + 1}; j < free_ranges.size(); ++j)
+					free_ranges[j - 1] = free_ranges[j];
+				free_ranges.pop_back();
+			}
+
+			return off;
+		}
+
+		return UINT32_MAX;
+	}
+
+	void geometry_pool::free_range(mc::vector<range>& free_ranges, range r)
+	{
+		uint32_t i {0};
+		while (i < free_ranges.size() && free_ranges[i].off < r.off)
+			++i;
+
+		bool merge_prev =
+			i > 0 && free_ranges[i - 1].off + free_ranges[i - 1].cnt == r.off;
+		bool merge_next = i < free_ranges.size() && r.off + r.cnt == free_ranges[i].off;
+
+		if (merge_prev && merge_next)
+		{
+			free_ranges[i - 1].cnt += r.cnt + free_ranges[i].cnt;
+			for (uint32_t j {i + 1}; j < free_ranges.size(); ++j)
+				free_ranges[j - 1] = free_ranges[j];
+			free_ranges.pop_back();
+		}
+		else if (merge_prev)
+			free_ranges[i - 1].cnt += r.cnt;
+		else if (merge_next)
+		{
+			free_ranges[i].off = r.off;
+			free_ranges[i].cnt += r.cnt;
+		}
+		else
+		{
+			free_ranges.emplace_back(r);
+			for (uint32_t j = free_ranges.size() - 1; j > i; --j)
+				free_ranges[j] = free_ranges[j - 1];
+			free_ranges[i] = r;
+		}
+	}
+}
\ No newline at end of file
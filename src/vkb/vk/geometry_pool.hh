@@ -0,0 +1,61 @@
+#pragma once
+
+#include "assets/model.hh"
+#include "buffer.hh"
+
+#include <array_view.hh>
+#include <vector.hh>
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Vertices and indices of all the models, in one vertex buffer and one index
+	// buffer. Models are ranges of these buffers, allocated first fit from lists of
+	// free ranges, so every mesh draws with the same binds.
+	class geometry_pool
+	{
+	public:
+		// Capacities in vertices and indices.
+		geometry_pool(uint32_t vert_cap, uint32_t idx_cap);
+		geometry_pool(geometry_pool const&) = delete;
+		geometry_pool(geometry_pool&&) = delete;
+		~geometry_pool();
+
+		geometry_pool& operator=(geometry_pool const&) = delete;
+		geometry_pool& operator=(geometry_pool&&) = delete;
+
+		// Allocates the ranges of the model and uploads its geometry. Returns false
+		// if the pool is full.
+		bool alloc(model& model, mc::array_view<model::vert> verts,
+		           mc::array_view<uint16_t> idcs);
+		// The model must not be used by a frame in flight anymore.
+		void free(model& model);
+
+		// Binds both buffers, indices are 16 bits.
+		void bind(VkCommandBuffer cmd);
+
+		VkBuffer get_vertex_buffer() const;
+		VkBuffer get_index_buffer() const;
+
+	private:
+		struct range
+		{
+			uint32_t off {0};
+			uint32_t cnt {0};
+		};
+
+		// Free ranges are sorted by offset. Returns UINT32_MAX if none is large enough.
+		static uint32_t alloc_range(mc::vector<range>& free_ranges, uint32_t cnt);
+		// Merges the range with its free neighbours.
+		static void     free_range(mc::vector<range>& free_ranges, range r);
+
+		buffer vertices_;
+		buffer indices_;
+
+		mc::vector<range> free_verts_;
+		mc::vector<range> free_idcs_;
+	};
+}
\ No newline at end of file
@@ -1,17 +1,37 @@
 #include "instance.hh"
 
+#include "../core/pack.hh"
 #include "../log.hh"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <string_view.hh>
 #include <vector.hh>
 
+#include "deletion_queue.hh"
+#include "descriptor_allocator.hh"
 #include "enum_string_helper.hh"
+#include "geometry_pool.hh"
+#include "pipeline_library.hh"
+#include "staging_ring.hh"
 #include "surface.hh"
+#include "uniform_arena.hh"
 
 namespace vkb::vk
 {
 	namespace
 	{
+		constexpr char const* pipeline_cache_path {"pipeline_cache.bin"};
+		// Uniform data of all the material instances drawn in a frame.
+		constexpr uint64_t uniform_arena_frame_size {256 * 1024};
+		// 10 MiB of vertices and 2 MiB of indices.
+		constexpr uint32_t geometry_pool_vertex_cap {256 * 1024};
+		constexpr uint32_t geometry_pool_index_cap {1024 * 1024};
+		// Larger uploads use a dedicated staging buffer.
+		constexpr uint64_t staging_ring_size {32 * 1024 * 1024};
+		// Host visible part of the device memory without resizable BAR.
+		constexpr uint64_t bar_window_size {256 * 1024 * 1024};
+
 		void callback_print(VkDebugUtilsMessageSeverityFlagBitsEXT message_level,
 		                    char const*                            format, ...)
 		{
@@ -36,6 +56,38 @@ namespace vkb::vk
 			}
 			va_end(args);
 		}
+
+		bool has_extension(VkPhysicalDevice device, char const* name)
+		{
+			uint32_t ext_cnt {0};
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &ext_cnt, nullptr);
+			mc::vector<VkExtensionProperties> exts(ext_cnt);
+			vkEnumerateDeviceExtensionProperties(device, nullptr, &ext_cnt, exts.data());
+
+			for (uint32_t i {0}; i < exts.size(); ++i)
+			{
+				if (strcmp(name, exts[i].extensionName) == 0)
+					return true;
+			}
+
+			return false;
+		}
+
+		bool same_sampler(VkSamplerCreateInfo const& lhs, VkSamplerCreateInfo const& rhs)
+		{
+			return lhs.flags == rhs.flags && lhs.magFilter == rhs.magFilter &&
+			       lhs.minFilter == rhs.minFilter && lhs.mipmapMode == rhs.mipmapMode &&
+			       lhs.addressModeU == rhs.addressModeU &&
+			       lhs.addressModeV == rhs.addressModeV &&
+			       lhs.addressModeW == rhs.addressModeW &&
+			       lhs.mipLodBias == rhs.mipLodBias &&
+			       lhs.anisotropyEnable == rhs.anisotropyEnable &&
+			       lhs.maxAnisotropy == rhs.maxAnisotropy &&
+			       lhs.compareEnable == rhs.compareEnable &&
+			       lhs.compareOp == rhs.compareOp && lhs.minLod == rhs.minLod &&
+			       lhs.maxLod == rhs.maxLod && lhs.borderColor == rhs.borderColor &&
+			       lhs.unnormalizedCoordinates == rhs.unnormalizedCoordinates;
+		}
 	}
 
 	instance* instance::instance_ {nullptr};
@@ -58,13 +110,34 @@ namespace vkb::vk
 
 	instance::~instance()
 	{
-		instance_ = nullptr;
+		// The frames completed, the objects they left are destroyed.
+		delete deletion_queue_;
+		// Waits for the uploads in flight.
+		delete staging_ring_;
 
 		// if (transient_command_pool_)
 		// 	vkDestroyCommandPool(device_, transient_command_pool_, nullptr);
 		if (command_pool_)
 			vkDestroyCommandPool(device_, command_pool_, nullptr);
 
+		for (uint32_t i {0}; i < samplers_.size(); ++i)
+			vkDestroySampler(device_, samplers_[i].sampler, nullptr);
+
+		delete pipeline_library_;
+		delete uniform_arena_;
+		delete descriptor_allocator_;
+		delete geometry_pool_;
+
+		if (pipeline_cache_)
+		{
+			save_pipeline_cache();
+			vkDestroyPipelineCache(device_, pipeline_cache_, nullptr);
+		}
+
+		if (memory_stats_)
+			memory_stats_->log_report();
+		delete memory_stats_;
+
 		if (allocator_)
 			vmaDestroyAllocator(allocator_);
 
@@ -79,21 +152,41 @@ namespace vkb::vk
 
 		if (inst_)
 			vkDestroyInstance(inst_, nullptr);
+
+		// Services destroyed above still use the instance.
+		instance_ = nullptr;
 	}
 
-	void instance::create_device(surface const& surface)
+	void instance::create_device(surface const& surface, bool allow_shader_object,
+	                             bool low_depth_precision)
 	{
 		bool created = select_physical_device(surface);
 		log::assert(created, "Failed to find suitable physical device");
 
-		created = create_logical_device();
+		created = create_logical_device(allow_shader_object);
 		log::assert(created, "Failed to create logical device");
 
 		created = create_allocator();
 		log::assert(created, "Failed to create allocator");
 
+		created = select_depth_format(low_depth_precision);
+		log::assert(created, "Failed to find a depth format");
+
 		created = create_command_pools();
 		log::assert(created, "Failed to create command pools");
+
+		if (!create_pipeline_cache())
+			log::warn("Failed to create pipeline cache");
+
+		if (has_pipeline_library_)
+			pipeline_library_ = new pipeline_library(pipeline_library_fast_link_);
+
+		deletion_queue_ = new deletion_queue;
+		staging_ring_ = new staging_ring(staging_ring_size);
+		descriptor_allocator_ = new descriptor_allocator;
+		uniform_arena_ = new uniform_arena(uniform_arena_frame_size);
+		geometry_pool_ =
+			new geometry_pool(geometry_pool_vertex_cap, geometry_pool_index_cap);
 	}
 
 	VkInstance instance::get_instance()
@@ -116,6 +209,26 @@ namespace vkb::vk
 		return phys_device_;
 	}
 
+	VkPhysicalDeviceProperties const& instance::get_device_properties() const
+	{
+		return phys_props_;
+	}
+
+	bool instance::direct_upload() const
+	{
+		return uma_ || rebar_;
+	}
+
+	bool instance::has_lazy_memory() const
+	{
+		return has_lazy_memory_;
+	}
+
+	VkFormat instance::get_depth_format() const
+	{
+		return depth_format_;
+	}
+
 	VmaAllocator instance::get_allocator()
 	{
 		return allocator_;
@@ -152,8 +265,8 @@ namespace vkb::vk
 
 	image instance::create_image(uint32_t w, uint32_t h, uint32_t mip_lvl,
 	                             VkFormat format, VkImageTiling tiling,
-	                             VkImageUsageFlags                      usage,
-	                             [[maybe_unused]] VkMemoryPropertyFlags props)
+	                             VkImageUsageFlags usage, mem_intent intent,
+	                             mem_category cat, uint32_t layer_cnt)
 	{
 		VkImageCreateInfo img_info {};
 		img_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -162,7 +275,7 @@ namespace vkb::vk
 		img_info.extent.height = h;
 		img_info.extent.depth = 1;
 		img_info.mipLevels = 1;
-		img_info.arrayLayers = 1;
+		img_info.arrayLayers = layer_cnt;
 		img_info.format = format;
 		img_info.tiling = tiling;
 		img_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -171,31 +284,32 @@ namespace vkb::vk
 		img_info.samples = VK_SAMPLE_COUNT_1_BIT;
 		img_info.mipLevels = mip_lvl;
 
-		VmaAllocationCreateInfo alloc_info {};
-
-		VkPhysicalDeviceMemoryProperties const* mem_props;
-		vmaGetMemoryProperties(allocator_, &mem_props);
-		for (uint32_t i {0}; i < mem_props->memoryTypeCount; ++i)
-			if ((mem_props->memoryTypes[i].propertyFlags & props) == props)
-			{
-				alloc_info.memoryTypeBits = 1 << i;
-				break;
-			}
+		VmaAllocationCreateInfo alloc_info =
+			placement(intent, true, usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
 
 		image    result {};
 		VkResult res = vmaCreateImage(allocator_, &img_info, &alloc_info, &result.image,
 		                              &result.memory, nullptr);
 		log::assert(res == VK_SUCCESS, "Failed to create image");
+		memory_stats_->on_alloc(result.memory, cat);
 
 		return result;
 	}
 
+	void instance::destroy_image(image const& img)
+	{
+		if (img.memory)
+			memory_stats_->on_free(img.memory);
+		vmaDestroyImage(allocator_, img.image, img.memory);
+	}
+
 	VkImageView instance::create_image_view(VkImage img, VkFormat format,
-	                                        VkImageAspectFlags flags, uint32_t mip_lvl)
+	                                        VkImageAspectFlags flags, uint32_t mip_lvl,
+	                                        VkImageViewType type, uint32_t layer_cnt)
 	{
 		VkImageViewCreateInfo create_info {};
 		create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		create_info.viewType = type;
 		create_info.image = img;
 		create_info.format = format;
 		create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -206,7 +320,7 @@ namespace vkb::vk
 		create_info.subresourceRange.baseMipLevel = 0;
 		create_info.subresourceRange.levelCount = 1;
 		create_info.subresourceRange.baseArrayLayer = 0;
-		create_info.subresourceRange.layerCount = 1;
+		create_info.subresourceRange.layerCount = layer_cnt;
 		create_info.subresourceRange.levelCount = mip_lvl;
 
 		VkImageView img_view {nullptr};
@@ -221,7 +335,8 @@ namespace vkb::vk
 		VkCommandBuffer cmd, VkImage img, VkImageLayout old_layout,
 		VkImageLayout new_layout, VkAccessFlags src_access_mask,
 		VkAccessFlags dst_access_mask, VkPipelineStageFlags src_stage,
-		VkPipelineStageFlags dst_stage, VkImageAspectFlags aspect, uint32_t mip_lvl)
+		VkPipelineStageFlags dst_stage, VkImageAspectFlags aspect, uint32_t mip_lvl,
+		uint32_t layer_cnt)
 	{
 		// TODO VK_KHR_synchronization2
 		VkImageMemoryBarrier barrier {};
@@ -235,7 +350,7 @@ namespace vkb::vk
 		barrier.subresourceRange.baseMipLevel = 0;
 		barrier.subresourceRange.levelCount = mip_lvl;
 		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.layerCount = layer_cnt;
 		barrier.srcAccessMask = src_access_mask;
 		barrier.dstAccessMask = dst_access_mask;
 
@@ -243,8 +358,108 @@ namespace vkb::vk
 		                     &barrier);
 	}
 
+	VkSampler instance::get_sampler(VkSamplerCreateInfo const& info)
+	{
+		log::assert(!info.pNext, "Cached samplers can't have extension structures");
+
+		for (uint32_t i {0}; i < samplers_.size(); ++i)
+			if (same_sampler(samplers_[i].info, info))
+				return samplers_[i].sampler;
+
+		VkSampler sampler {nullptr};
+		VkResult  res = vkCreateSampler(device_, &info, nullptr, &sampler);
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to create sampler (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		cached_sampler& cached = samplers_.emplace_back();
+		cached.info = info;
+		cached.sampler = sampler;
+
+		return sampler;
+	}
+
+	VkShaderModule instance::create_shader(mc::string_view path)
+	{
+		pack::resource spirv;
+		if (!pack::get().load(path, spirv))
+		{
+			log::error("Invalid shader path: %s", path.data());
+			return nullptr;
+		}
+
+		// Pack entries and loose files storage are both aligned enough for SPIR-V
+		// words.
+		return create_shader(spirv.data, spirv.size);
+	}
+
+	VkShaderModule instance::create_shader(uint8_t const* spirv, uint64_t size)
+	{
+		VkShaderModuleCreateInfo create_info {};
+		create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		create_info.codeSize = size;
+		create_info.pCode = reinterpret_cast<uint32_t const*>(spirv);
+
+		VkShaderModule shader {nullptr};
+		VkResult res = vkCreateShaderModule(device_, &create_info, nullptr, &shader);
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to create shader module (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		return shader;
+	}
+
+	instance::shader_object_fns const* instance::get_shader_object() const
+	{
+		return shader_object_ ? &shader_object_fns_ : nullptr;
+	}
+
+	pipeline_library* instance::get_pipeline_library()
+	{
+		return pipeline_library_;
+	}
+
+	descriptor_allocator& instance::get_descriptor_allocator()
+	{
+		return *descriptor_allocator_;
+	}
+
+	uniform_arena& instance::get_uniform_arena()
+	{
+		return *uniform_arena_;
+	}
+
+	geometry_pool& instance::get_geometry_pool()
+	{
+		return *geometry_pool_;
+	}
+
+	staging_ring& instance::get_staging_ring()
+	{
+		return *staging_ring_;
+	}
+
+	memory_stats& instance::get_memory_stats()
+	{
+		return *memory_stats_;
+	}
+
+	deletion_queue& instance::get_deletion_queue()
+	{
+		return *deletion_queue_;
+	}
+
+	VkPipelineCache instance::get_pipeline_cache()
+	{
+		return pipeline_cache_;
+	}
+
 	buffer instance::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage,
-	                               VkMemoryPropertyFlags props)
+	                               mem_intent intent, mem_category cat)
 	{
 		VkBufferCreateInfo create_info {};
 		create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -252,26 +467,25 @@ namespace vkb::vk
 		create_info.usage = usage;
 		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		VmaAllocationCreateInfo                 alloc_info {};
-		VkPhysicalDeviceMemoryProperties const* mem_props;
-		vmaGetMemoryProperties(allocator_, &mem_props);
-		for (uint32_t i {0}; i < mem_props->memoryTypeCount; ++i)
-			if ((mem_props->memoryTypes[i].propertyFlags & props) == props)
-			{
-				alloc_info.memoryTypeBits = 1 << i;
-				break;
-			}
+		// Only copied from, the buffer is a staging source.
+		bool                    device_read = usage & ~VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		VmaAllocationCreateInfo alloc_info = placement(intent, device_read, false);
 
-		buffer   result {};
+		buffer            result {};
+		VmaAllocationInfo info {};
 		VkResult res = vmaCreateBuffer(allocator_, &create_info, &alloc_info,
-		                               &result.buffer, &result.memory, nullptr);
+		                               &result.buffer, &result.memory, &info);
 		log::assert(res == VK_SUCCESS, "Failed to create buffer (%s)",
 		            string_VkResult(res));
+		memory_stats_->on_alloc(result.memory, cat);
+		result.data = info.pMappedData;
 		return result;
 	}
 
 	void instance::destroy_buffer(buffer const& buf)
 	{
+		if (buf.memory)
+			memory_stats_->on_free(buf.memory);
 		vmaDestroyBuffer(allocator_, buf.buffer, buf.memory);
 	}
 
@@ -578,6 +792,7 @@ namespace vkb::vk
 			return false;
 
 		phys_device_ = devices[selected];
+		phys_props_ = props.properties;
 		log::info("Selected device: %s - %s", props.properties.deviceName,
 		          props2.driverInfo);
 		return true;
@@ -607,7 +822,7 @@ namespace vkb::vk
 		return res;
 	}
 
-	bool instance::create_logical_device()
+	bool instance::create_logical_device(bool allow_shader_object)
 	{
 		[[maybe_unused]] mc::vector<int>    test {0, 1, 2, 3};
 		mc::vector<VkDeviceQueueCreateInfo> queues;
@@ -637,28 +852,124 @@ namespace vkb::vk
 		feats.samplerAnisotropy = VK_TRUE;
 		feats.wideLines = VK_TRUE;
 
+		// Uploads are tracked with a timeline semaphore.
+		VkPhysicalDeviceVulkan12Features vulkan12_feats {};
+		vulkan12_feats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12_feats.timelineSemaphore = true;
+
 		VkPhysicalDeviceVulkan13Features vulkan13_feats {};
 		vulkan13_feats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
 		vulkan13_feats.dynamicRendering = true;
+		vulkan13_feats.synchronization2 = true;
+		vulkan12_feats.pNext = &vulkan13_feats;
+
+		char const* exts[4] {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+		uint32_t    ext_cnt {1};
+		void**      feats_chain = &vulkan13_feats.pNext;
+
+		VkPhysicalDeviceShaderObjectFeaturesEXT shader_object_feats {};
+		shader_object_feats.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+		if (allow_shader_object &&
+		    has_extension(phys_device_, VK_EXT_SHADER_OBJECT_EXTENSION_NAME))
+		{
+			VkPhysicalDeviceFeatures2 supported {};
+			supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supported.pNext = &shader_object_feats;
+			vkGetPhysicalDeviceFeatures2(phys_device_, &supported);
+
+			shader_object_ = shader_object_feats.shaderObject;
+			if (shader_object_)
+			{
+				exts[ext_cnt++] = VK_EXT_SHADER_OBJECT_EXTENSION_NAME;
+				*feats_chain = &shader_object_feats;
+				feats_chain = &shader_object_feats.pNext;
+			}
+		}
+
+		// Pipelines are split in parts linked together, with shared vertex input and
+		// fragment output parts.
+		VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT library_feats {};
+		library_feats.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+		VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT library_props {};
+		library_props.sType =
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+		if (!shader_object_ &&
+		    has_extension(phys_device_, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+		{
+			VkPhysicalDeviceFeatures2 supported {};
+			supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			supported.pNext = &library_feats;
+			vkGetPhysicalDeviceFeatures2(phys_device_, &supported);
+
+			if (library_feats.graphicsPipelineLibrary)
+			{
+				VkPhysicalDeviceProperties2 props {};
+				props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+				props.pNext = &library_props;
+				vkGetPhysicalDeviceProperties2(phys_device_, &props);
+
+				has_pipeline_library_ = true;
+				pipeline_library_fast_link_ =
+					library_props.graphicsPipelineLibraryFastLinking;
+				exts[ext_cnt++] = VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME;
+				exts[ext_cnt++] = VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME;
+				*feats_chain = &library_feats;
+				feats_chain = &library_feats.pNext;
+			}
+		}
+
+		// Lets VMA query the real budget of the heaps instead of estimating it.
+		has_memory_budget_ =
+			has_extension(phys_device_, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		if (has_memory_budget_)
+			exts[ext_cnt++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
 
 		VkDeviceCreateInfo create_info {};
 		create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-		create_info.pNext = &vulkan13_feats;
+		create_info.pNext = &vulkan12_feats;
 		create_info.queueCreateInfoCount = queues.size();
 		create_info.pQueueCreateInfos = queues.data();
 		create_info.pEnabledFeatures = &feats;
-
-		char const* required_exts[] {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-		create_info.enabledExtensionCount = 1;
-		create_info.ppEnabledExtensionNames = required_exts;
+		create_info.enabledExtensionCount = ext_cnt;
+		create_info.ppEnabledExtensionNames = exts;
 
 		VkResult res = vkCreateDevice(phys_device_, &create_info, nullptr, &device_);
+		if (res == VK_SUCCESS && shader_object_)
+			shader_object_ = load_shader_object();
+		log::info("Drawing materials with %s",
+		          shader_object_          ? "shader objects"
+		          : has_pipeline_library_ ? "pipeline libraries"
+		                                  : "pipelines");
 
 		vkGetDeviceQueue(device_, queue_indices_.graphics, 0, &graphics_queue_);
 		vkGetDeviceQueue(device_, queue_indices_.present, 0, &present_queue_);
 		return res == VK_SUCCESS;
 	}
 
+	bool instance::load_shader_object()
+	{
+		shader_object_fns& fns = shader_object_fns_;
+		auto load = [&]<typename T>(T& fn, char const* name)
+		{
+			fn = reinterpret_cast<T>(vkGetDeviceProcAddr(device_, name));
+			return fn != nullptr;
+		};
+
+		return load(fns.create_shaders, "vkCreateShadersEXT") &&
+		       load(fns.destroy_shader, "vkDestroyShaderEXT") &&
+		       load(fns.cmd_bind_shaders, "vkCmdBindShadersEXT") &&
+		       load(fns.cmd_set_vertex_input, "vkCmdSetVertexInputEXT") &&
+		       load(fns.cmd_set_polygon_mode, "vkCmdSetPolygonModeEXT") &&
+		       load(fns.cmd_set_rasterization_samples,
+		            "vkCmdSetRasterizationSamplesEXT") &&
+		       load(fns.cmd_set_sample_mask, "vkCmdSetSampleMaskEXT") &&
+		       load(fns.cmd_set_alpha_to_coverage, "vkCmdSetAlphaToCoverageEnableEXT") &&
+		       load(fns.cmd_set_color_blend_enable, "vkCmdSetColorBlendEnableEXT") &&
+		       load(fns.cmd_set_color_write_mask, "vkCmdSetColorWriteMaskEXT");
+	}
+
 	bool instance::create_allocator()
 	{
 		VmaAllocatorCreateInfo create_info {};
@@ -666,10 +977,113 @@ namespace vkb::vk
 		create_info.device = device_;
 		create_info.instance = inst_;
 		create_info.vulkanApiVersion = VK_API_VERSION_1_4;
+		if (has_memory_budget_)
+			create_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
 
 		VkResult res = vmaCreateAllocator(&create_info, &allocator_);
+		if (res != VK_SUCCESS)
+			return false;
 
-		return res == VK_SUCCESS;
+		detect_memory_architecture();
+		memory_stats_ = new memory_stats(allocator_, has_memory_budget_);
+		return true;
+	}
+
+	void instance::detect_memory_architecture()
+	{
+		VkPhysicalDeviceMemoryProperties const* mem_props;
+		vmaGetMemoryProperties(allocator_, &mem_props);
+
+		constexpr VkMemoryPropertyFlags bar_flags =
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+		uma_ = phys_props_.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+		for (uint32_t i {0}; i < mem_props->memoryTypeCount; ++i)
+		{
+			VkMemoryType const& type = mem_props->memoryTypes[i];
+			if (type.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+				has_lazy_memory_ = true;
+			if ((type.propertyFlags & bar_flags) == bar_flags &&
+			    mem_props->memoryHeaps[type.heapIndex].size > bar_window_size)
+				rebar_ = true;
+		}
+
+		log::info("Device memory: %s%s",
+		          uma_     ? "unified"
+		          : rebar_ ? "resizable BAR"
+		                   : "discrete",
+		          has_lazy_memory_ ? ", lazily allocated" : "");
+	}
+
+	bool instance::select_depth_format(bool low_precision)
+	{
+		// D16 halves the bandwidth of depth testing, but its precision only suits
+		// short depth ranges. Formats without stencil, none of the passes use it.
+		VkFormat formats[] {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32,
+		                    VK_FORMAT_D16_UNORM};
+		if (low_precision)
+		{
+			formats[0] = VK_FORMAT_D16_UNORM;
+			formats[2] = VK_FORMAT_D32_SFLOAT;
+		}
+
+		depth_format_ =
+			find_supported_format(formats, VK_IMAGE_TILING_OPTIMAL,
+		                          VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+		if (depth_format_ == VK_FORMAT_UNDEFINED)
+			return false;
+
+		log::info("Depth format: %s", string_VkFormat(depth_format_));
+		return true;
+	}
+
+	VmaAllocationCreateInfo instance::placement(mem_intent intent, bool device_read,
+	                                            bool transient_image) const
+	{
+		VmaAllocationCreateInfo info {};
+		switch (intent)
+		{
+			case mem_intent::gpu_static:
+				info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+				break;
+
+			case mem_intent::dynamic_upload:
+				info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+				             VMA_ALLOCATION_CREATE_MAPPED_BIT;
+				info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				// Staging sources stay in system memory, device local memory is kept for
+				// the data read by shaders.
+				if (device_read && direct_upload())
+				{
+					info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+					info.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				}
+				else
+					info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+				break;
+
+			case mem_intent::readback:
+				info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+				info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+				             VMA_ALLOCATION_CREATE_MAPPED_BIT;
+				info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+				                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				info.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+				break;
+
+			case mem_intent::transient_attachment:
+				if (transient_image && has_lazy_memory_)
+					info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+				else
+				{
+					info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+					info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+				}
+				break;
+		}
+
+		return info;
 	}
 
 	bool instance::create_command_pools()
@@ -687,4 +1101,68 @@ namespace vkb::vk
 
 		return res == VK_SUCCESS;
 	}
+
+	bool instance::create_pipeline_cache()
+	{
+		// The driver validates the header, and ignores the data if it was saved by
+		// another device or driver version.
+		uint8_t* data {nullptr};
+		uint64_t size {0};
+		if (FILE* file = fopen(pipeline_cache_path, "rb"))
+		{
+			fseek(file, 0, SEEK_END);
+			long file_size = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			if (file_size > 0)
+			{
+				data = static_cast<uint8_t*>(malloc(file_size));
+				if (data && fread(data, 1, file_size, file) ==
+				                static_cast<size_t>(file_size))
+					size = file_size;
+			}
+			fclose(file);
+		}
+
+		VkPipelineCacheCreateInfo create_info {};
+		create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		create_info.initialDataSize = size;
+		create_info.pInitialData = data;
+
+		VkResult res =
+			vkCreatePipelineCache(device_, &create_info, nullptr, &pipeline_cache_);
+		if (res != VK_SUCCESS && size)
+		{
+			// Corrupted data, start over with an empty cache.
+			create_info.initialDataSize = 0;
+			create_info.pInitialData = nullptr;
+			res = vkCreatePipelineCache(device_, &create_info, nullptr,
+			                            &pipeline_cache_);
+		}
+		free(data);
+
+		return res == VK_SUCCESS;
+	}
+
+	void instance::save_pipeline_cache()
+	{
+		size_t   size {0};
+		VkResult res = vkGetPipelineCacheData(device_, pipeline_cache_, &size, nullptr);
+		if (res != VK_SUCCESS || !size)
+			return;
+
+		uint8_t* data = static_cast<uint8_t*>(malloc(size));
+		res = vkGetPipelineCacheData(device_, pipeline_cache_, &size, data);
+		if (res == VK_SUCCESS || res == VK_INCOMPLETE)
+		{
+			FILE* file = fopen(pipeline_cache_path, "wb");
+			if (file)
+			{
+				fwrite(data, 1, size, file);
+				fclose(file);
+			}
+			else
+				log::warn("Could not write %s", pipeline_cache_path);
+		}
+		free(data);
+	}
 } // namespace vkb::vk
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array_view.hh>
+#include <string_view.hh>
 #include <vector.hh>
 
 #include "vma/vma.hh"
@@ -8,10 +9,18 @@
 
 #include "buffer.hh"
 #include "image.hh"
+#include "memory_intent.hh"
+#include "memory_stats.hh"
 
 namespace vkb::vk
 {
+	class deletion_queue;
+	class descriptor_allocator;
+	class geometry_pool;
+	class staging_ring;
+	class pipeline_library;
 	class surface;
+	class uniform_arena;
 
 	class instance
 	{
@@ -22,6 +31,22 @@ namespace vkb::vk
 			uint32_t present = UINT32_MAX;
 		};
 
+		// VK_EXT_shader_object entry points. The extension also provides the extended
+		// dynamic state 3 commands needed to draw without pipelines.
+		struct shader_object_fns
+		{
+			PFN_vkCreateShadersEXT               create_shaders {nullptr};
+			PFN_vkDestroyShaderEXT               destroy_shader {nullptr};
+			PFN_vkCmdBindShadersEXT              cmd_bind_shaders {nullptr};
+			PFN_vkCmdSetVertexInputEXT           cmd_set_vertex_input {nullptr};
+			PFN_vkCmdSetPolygonModeEXT           cmd_set_polygon_mode {nullptr};
+			PFN_vkCmdSetRasterizationSamplesEXT  cmd_set_rasterization_samples {nullptr};
+			PFN_vkCmdSetSampleMaskEXT            cmd_set_sample_mask {nullptr};
+			PFN_vkCmdSetAlphaToCoverageEnableEXT cmd_set_alpha_to_coverage {nullptr};
+			PFN_vkCmdSetColorBlendEnableEXT      cmd_set_color_blend_enable {nullptr};
+			PFN_vkCmdSetColorWriteMaskEXT        cmd_set_color_write_mask {nullptr};
+		};
+
 		static instance& get();
 
 		instance(bool enable_validation);
@@ -32,7 +57,10 @@ namespace vkb::vk
 		instance& operator=(instance const&) = delete;
 		instance& operator=(instance&&) = delete;
 
-		void create_device(surface const& surface);
+		// Shader objects are used when supported, unless allow_shader_object is false.
+		// low_depth_precision prefers a 16 bits depth format, for short depth ranges.
+		void create_device(surface const& surface, bool allow_shader_object = true,
+		                   bool low_depth_precision = false);
 
 		VkInstance get_instance();
 
@@ -41,8 +69,36 @@ namespace vkb::vk
 		VkDevice         get_device();
 		VkPhysicalDevice get_physical_device();
 
+		// Cached when the physical device is selected.
+		VkPhysicalDeviceProperties const& get_device_properties() const;
+		// Whether the host can write device local memory directly, on integrated GPUs
+		// or with resizable BAR.
+		bool direct_upload() const;
+		// Whether a memory type is only committed when used, on tile based GPUs.
+		bool has_lazy_memory() const;
+		// Of all the depth attachments, negotiated when the device is created.
+		VkFormat get_depth_format() const;
+
 		VmaAllocator get_allocator();
 
+		// nullptr if shader objects aren't used, materials then fall back to pipelines.
+		shader_object_fns const* get_shader_object() const;
+		// nullptr if VK_EXT_graphics_pipeline_library isn't supported, or shader
+		// objects are used instead.
+		pipeline_library* get_pipeline_library();
+
+		// Shared by all the material instances and per frame descriptor sets.
+		descriptor_allocator& get_descriptor_allocator();
+		uniform_arena&        get_uniform_arena();
+		// Holds the geometry of all the models.
+		geometry_pool& get_geometry_pool();
+		// Upload memory of the loaders.
+		staging_ring& get_staging_ring();
+		// Device memory used by the allocations of the instance, by category.
+		memory_stats& get_memory_stats();
+		// Destroys objects once the frames using them completed.
+		deletion_queue& get_deletion_queue();
+
 		VkQueue get_graphics_queue();
 		VkQueue get_present_queue();
 
@@ -51,20 +107,38 @@ namespace vkb::vk
 
 		image create_image(uint32_t w, uint32_t h, uint32_t mip_lvl, VkFormat format,
 		                   VkImageTiling tiling, VkImageUsageFlags usage,
-		                   VkMemoryPropertyFlags props);
+		                   mem_intent intent, mem_category cat, uint32_t layer_cnt = 1);
+		void  destroy_image(image const& img);
 
 		VkImageView create_image_view(VkImage img, VkFormat format,
-		                              VkImageAspectFlags flags, uint32_t mip_lvl);
+		                              VkImageAspectFlags flags, uint32_t mip_lvl,
+		                              VkImageViewType type = VK_IMAGE_VIEW_TYPE_2D,
+		                              uint32_t        layer_cnt = 1);
 
 		void transition_image_layout(
 			VkCommandBuffer cmd, VkImage img, VkImageLayout old_layout,
 			VkImageLayout new_layout, VkAccessFlags src_access_mask,
 			VkAccessFlags dst_access_mask, VkPipelineStageFlags src_stage,
 			VkPipelineStageFlags dst_stage,
-			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, uint32_t mip_lvl = 1);
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, uint32_t mip_lvl = 1,
+			uint32_t layer_cnt = 1);
+
+		// Samplers are shared between all users with the same state, and destroyed
+		// with the instance. They can be used as immutable samplers.
+		VkSampler get_sampler(VkSamplerCreateInfo const& info);
+
+		// Reads the SPIR-V from the resource pack, or from the loose file. Returns
+		// nullptr on failure.
+		VkShaderModule create_shader(mc::string_view path);
+		VkShaderModule create_shader(uint8_t const* spirv, uint64_t size);
+
+		// Shared by all pipelines, saved to pipeline_cache.bin on destruction so the next
+		// runs can reuse it. Can be used from any thread.
+		VkPipelineCache get_pipeline_cache();
 
+		// Host accessible intents return the buffer mapped, and coherent.
 		buffer create_buffer(VkDeviceSize size, VkBufferUsageFlags usage,
-		                     VkMemoryPropertyFlags props);
+		                     mem_intent intent, mem_category cat);
 		void   destroy_buffer(buffer const& buf);
 
 		VkCommandBuffer begin_commands();
@@ -74,6 +148,12 @@ namespace vkb::vk
 		void                        free_commands(mc::array_view<VkCommandBuffer> cmds);
 
 	private:
+		struct cached_sampler
+		{
+			VkSamplerCreateInfo info {};
+			VkSampler           sampler {nullptr};
+		};
+
 		static instance* instance_;
 
 		static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(
@@ -88,24 +168,56 @@ namespace vkb::vk
 
 		queue_indices find_queue_indices(VkPhysicalDevice device, surface const& surface);
 
-		bool create_logical_device();
+		bool create_logical_device(bool allow_shader_object);
+		bool load_shader_object();
 		bool create_allocator();
+		void detect_memory_architecture();
+		bool select_depth_format(bool low_precision);
+		VmaAllocationCreateInfo placement(mem_intent intent, bool device_read,
+		                                  bool transient_image) const;
 
 		bool create_command_pools();
+		bool create_pipeline_cache();
+		void save_pipeline_cache();
 
 		VkInstance               inst_ {nullptr};
 		VkDebugUtilsMessengerEXT debug_messenger_ {nullptr};
 
 		queue_indices queue_indices_;
 
-		VkPhysicalDevice phys_device_ {nullptr};
-		VkDevice         device_ {nullptr};
+		VkPhysicalDevice           phys_device_ {nullptr};
+		VkPhysicalDeviceProperties phys_props_ {};
+		VkDevice                   device_ {nullptr};
+
+		mc::vector<cached_sampler> samplers_;
 
-		VmaAllocator allocator_ {nullptr};
+		VmaAllocator  allocator_ {nullptr};
+		bool          has_memory_budget_ {false};
+		memory_stats* memory_stats_ {nullptr};
+		// Found when the allocator is created.
+		bool uma_ {false};
+		bool rebar_ {false};
+		bool has_lazy_memory_ {false};
+
+		VkFormat depth_format_ {VK_FORMAT_UNDEFINED};
+
+		bool              shader_object_ {false};
+		shader_object_fns shader_object_fns_;
+		bool              has_pipeline_library_ {false};
+		bool              pipeline_library_fast_link_ {false};
+		pipeline_library* pipeline_library_ {nullptr};
+
+		descriptor_allocator* descriptor_allocator_ {nullptr};
+		uniform_arena*        uniform_arena_ {nullptr};
+		geometry_pool*        geometry_pool_ {nullptr};
+		staging_ring*         staging_ring_ {nullptr};
+		deletion_queue*       deletion_queue_ {nullptr};
 
 		VkQueue graphics_queue_ {nullptr};
 		VkQueue present_queue_ {nullptr};
 
+		VkPipelineCache pipeline_cache_ {nullptr};
+
 		VkCommandPool command_pool_ {nullptr};
 		// VkCommandPool transient_command_pool_ {nullptr};
 	};
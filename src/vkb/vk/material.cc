@@ -1,292 +1,86 @@
 #include "material.hh"
 
+#include "../core/arena.hh"
+#include "../core/pack.hh"
 #include "../log.hh"
-#include "../math/mat4.hh"
 #include "assets/model.hh"
 #include "enum_string_helper.hh"
 #include "instance.hh"
 
-#include <array.hh>
+#include <stddef.h>
 #include <stdlib.h>
-#include <yyjson.h>
+#include <string.h>
 
 namespace vkb::vk
 {
 	namespace
 	{
-		void read_struct(yyjson_val* j_fields, property_layout& obj)
+		uint32_t format_size(VkFormat format)
 		{
-			yyjson_arr_iter j_fields_iter;
-			yyjson_arr_iter_init(j_fields, &j_fields_iter);
-			yyjson_val* j_field;
-
-			while ((j_field = yyjson_arr_iter_next(&j_fields_iter)))
+			switch (format)
 			{
-				mc::string  name(yyjson_get_str(yyjson_obj_get(j_field, "name")));
-				yyjson_val* j_binding = yyjson_obj_get(j_field, "binding");
-				j_field = yyjson_obj_get(j_field, "type");
-				char const* type_str = yyjson_get_str(yyjson_obj_get(j_field, "kind"));
-				if (strcmp(type_str, "struct") == 0)
-				{
-					property_layout child_obj {property_layout::type::object};
-					child_obj.name = static_cast<mc::string&&>(name);
-					read_struct(yyjson_obj_get(j_field, "fields"), child_obj);
-					obj.object.props.emplace_back(
-						static_cast<property_layout&&>(child_obj));
-				}
-				else if (strcmp(type_str, "matrix") == 0)
-				{
-					yyjson_val* j_mat_type = yyjson_obj_get(j_field, "elementType");
-					if (yyjson_get_uint(yyjson_obj_get(j_field, "rowCount")) == 4 &&
-					    yyjson_get_uint(yyjson_obj_get(j_field, "columnCount")) == 4 &&
-					    strcmp(yyjson_get_str(yyjson_obj_get(j_mat_type, "kind")),
-					           "scalar") == 0 &&
-					    strcmp(yyjson_get_str(yyjson_obj_get(j_mat_type, "scalarType")),
-					           "float32") == 0)
-					{
-						property_layout child_mat {property_layout::type::simple};
-						child_mat.name = static_cast<mc::string&&>(name);
-						child_mat.simple.type = property_layout::simple_type::float44;
-						obj.object.props.emplace_back(
-							static_cast<property_layout&&>(child_mat));
-					}
-				}
-				else if (strcmp(type_str, "resource") == 0)
-				{
-					property_layout child_res {property_layout::type::resource};
-					child_res.name = static_cast<mc::string&&>(name);
-
-					char const* res_type_str =
-						yyjson_get_str(yyjson_obj_get(j_field, "baseShape"));
-					if (strcmp(res_type_str, "texture2D") == 0)
-						child_res.resource.type =
-							property_layout::resource_type::texture2D;
-
-					yyjson_val* j_resource_result = yyjson_obj_get(j_field, "resultType");
-					yyjson_val* j_type = yyjson_obj_get(j_resource_result, "elementType");
-					if (yyjson_get_uint(
-							yyjson_obj_get(j_resource_result, "elementCount")) == 4 &&
-					    strcmp(yyjson_get_str(yyjson_obj_get(j_type, "kind")),
-					           "scalar") == 0 &&
-					    strcmp(yyjson_get_str(yyjson_obj_get(j_type, "scalarType")),
-					           "float32") == 0)
-					{
-						child_res.resource.format =
-							property_layout::resource_format::float4;
-					}
-
-					child_res.resource.binding =
-						yyjson_get_uint(yyjson_obj_get(j_binding, "index"));
-					obj.object.props.emplace_back(
-						static_cast<property_layout&&>(child_res));
-				}
-				else if (strcmp(type_str, "samplerState") == 0)
-				{
-					property_layout child_sampler {property_layout::type::sampler};
-					child_sampler.sampler.binding =
-						yyjson_get_uint(yyjson_obj_get(j_binding, "index"));
-					obj.object.props.emplace_back(
-						static_cast<property_layout&&>(child_sampler));
-				}
-				else
-				{
-					// TODO
-				}
+				case VK_FORMAT_R32_SFLOAT:
+				case VK_FORMAT_R32_SINT:
+				case VK_FORMAT_R32_UINT: return 4;
+				case VK_FORMAT_R32G32_SFLOAT:
+				case VK_FORMAT_R32G32_SINT:
+				case VK_FORMAT_R32G32_UINT: return 8;
+				case VK_FORMAT_R32G32B32_SFLOAT:
+				case VK_FORMAT_R32G32B32_SINT:
+				case VK_FORMAT_R32G32B32_UINT: return 12;
+				case VK_FORMAT_R32G32B32A32_SFLOAT:
+				case VK_FORMAT_R32G32B32A32_SINT:
+				case VK_FORMAT_R32G32B32A32_UINT: return 16;
+				default: return 0;
 			}
 		}
 
-		void read_param(yyjson_val* j_param, mc::vector<set_layout>& sets)
+		// The line width is dynamic, it doesn't need its own pipeline.
+		bool same_baked_state(material::state const& lhs, material::state const& rhs)
 		{
-			yyjson_val* j_binding = yyjson_obj_get(j_param, "binding");
-			if (strcmp(yyjson_get_str(yyjson_obj_get(j_binding, "kind")),
-			           "subElementRegisterSpace") != 0)
-				return;
-
-			uint32_t index = yyjson_get_uint(yyjson_obj_get(j_binding, "index"));
-			if (sets.size() < index)
-				sets.resize(index);
-
-			yyjson_val* type = yyjson_obj_get(j_param, "type");
-
-			// TODO support more sets kind. Currently only supporting ParameterBlock
-			// containing struct.
-			if (strcmp(yyjson_get_str(yyjson_obj_get(type, "kind")), "parameterBlock") !=
-			    0)
-				return;
-
-			yyjson_val* j_layout =
-				yyjson_obj_get(yyjson_obj_get(type, "elementVarLayout"), "type");
-			if (strcmp(yyjson_get_str(yyjson_obj_get(j_layout, "kind")), "struct") != 0)
-				return;
-
-			property_layout obj {property_layout::type::object};
-			obj.name = yyjson_get_str(yyjson_obj_get(j_param, "name"));
-
-			yyjson_val* j_bindings =
-				yyjson_obj_get(yyjson_obj_get(type, "elementVarLayout"), "bindings");
-
-			uint32_t binding_off {0};
-			// TODO Can uniform data be split im multiple parts without attributes ?
-			uint32_t uniform_off {0};
-			uint32_t uniform_size {0};
-
-			yyjson_arr_iter elem_bindings_iter;
-			yyjson_val*     j_elem_binding;
-			yyjson_arr_iter_init(j_bindings, &elem_bindings_iter);
-			while ((j_elem_binding = yyjson_arr_iter_next(&elem_bindings_iter)))
-			{
-				if (strcmp(yyjson_get_str(yyjson_obj_get(j_elem_binding, "kind")),
-				           "descriptorTableSlot") == 0)
-				{
-					binding_off =
-						yyjson_get_uint(yyjson_obj_get(j_elem_binding, "index"));
-				}
-				else if (strcmp(yyjson_get_str(yyjson_obj_get(j_elem_binding, "kind")),
-				                "uniform") == 0)
-				{
-					uniform_off =
-						yyjson_get_uint(yyjson_obj_get(j_elem_binding, "offset"));
-					uniform_size =
-						yyjson_get_uint(yyjson_obj_get(j_elem_binding, "size"));
-				}
-			}
-
-			read_struct(yyjson_obj_get(j_layout, "fields"), obj);
-
-			sets.emplace_back(static_cast<property_layout&&>(obj), uniform_off,
-			                  uniform_size, binding_off);
+			return memcmp(&lhs, &rhs, offsetof(material::state, line_width)) == 0;
 		}
 
-		void read_entry_point(yyjson_val*                     j_entry_point,
-		                      mc::vector<entry_point_layout>& entry_points)
-		{
-			entry_point_layout entry_layout;
-			entry_layout.name = yyjson_get_str(yyjson_obj_get(j_entry_point, "name"));
-
-			char const* stage_str =
-				yyjson_get_str(yyjson_obj_get(j_entry_point, "stage"));
-
-			for (uint32_t i {0}; i < mc::to_underlying(shader_stage::count); ++i)
-			{
-				if (shader_stage_names[i] == stage_str)
-				{
-					entry_layout.stage = static_cast<shader_stage>(i);
-					break;
-				}
-			}
-
-			if (entry_layout.stage == shader_stage::count)
-				log::error("Unknown shader stage '%s'", stage_str);
-
-			entry_points.emplace_back(static_cast<entry_point_layout&&>(entry_layout));
-		}
-
-		void fill_bindings(property_layout& obj, uint32_t binding_off,
-		                   mc::vector<VkDescriptorSetLayoutBinding>& bindings)
-		{
-			for (uint32_t i {0}; i < obj.object.props.size(); ++i)
-			{
-				property_layout& prop = obj.object.props[i];
-
-				switch (prop.type)
-				{
-					case property_layout::type::simple: break;
-					case property_layout::type::resource:
-					{
-						VkDescriptorSetLayoutBinding binding {};
-						binding.descriptorCount = 1;
-						binding.binding = binding_off + prop.resource.binding;
-						// TODO find a way to be more precise ?
-						binding.stageFlags = VK_SHADER_STAGE_ALL;
-						switch (prop.resource.type)
-						{
-							case property_layout::resource_type::texture2D:
-							{
-								binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-								break;
-							}
-
-							default:
-								log::assert(false, "Resource type not handled");
-								break;
-						}
-
-						bindings.emplace_back(binding);
-
-						break;
-					}
-
-					case property_layout::type::sampler:
-					{
-						VkDescriptorSetLayoutBinding binding {};
-						binding.descriptorCount = 1;
-						binding.binding = binding_off + prop.sampler.binding;
-						// TODO find a way to be more precise ?
-						binding.stageFlags = VK_SHADER_STAGE_ALL;
-						binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-
-						bindings.emplace_back(binding);
-						break;
-					}
-
-					case property_layout::type::object:
-					{
-						fill_bindings(prop, binding_off, bindings);
-						break;
-					}
-
-					default: log::assert(false, "Property type not handled"); break;
-				}
-			}
-		}
+		// The vertex input offsets are derived from the reflected formats, in locations
+		// order, which requires model::vert to be tightly packed.
+		static_assert(offsetof(model::vert, pos) == 0);
+		static_assert(offsetof(model::vert, col) == 16);
+		static_assert(offsetof(model::vert, uv) == 32);
 	}
 
 	material::material(mc::string_view shader)
 	: path_ {shader}
 	{
-		FILE* file = fopen(path_.data(), "rb");
-		log::assert(file != nullptr, "Invalid shader path: %s", path_.data());
-		if (file)
-			fclose(file);
-
 		mc::string reflect_path;
 		reflect_path.reserve(path_.size() + 5);
 		reflect_path += path_;
-		reflect_path += ".json";
+		reflect_path += ".refl";
 
-		yyjson_read_err err;
-		yyjson_doc*     doc = yyjson_read_file(reflect_path.data(), 0, nullptr, &err);
-		if (!doc)
+		if (!pack::get().load(reflect_path, reflect_))
 		{
-			log::error("Failed to read shader reflection: %s at %ju", err.msg, err.pos);
+			log::error("Invalid shader reflection path: %s", reflect_path.data());
 			return;
 		}
 
-		yyjson_val* j_root = yyjson_doc_get_root(doc);
-
-		yyjson_val* j_params = yyjson_obj_get(j_root, "parameters");
-		layout_.sets.reserve(yyjson_arr_size(j_params));
-		yyjson_arr_iter j_params_iter;
-		yyjson_arr_iter_init(j_params, &j_params_iter);
-		yyjson_val* j_param;
-		while ((j_param = yyjson_arr_iter_next(&j_params_iter)))
-			read_param(j_param, layout_.sets);
+		if (!layout_.load(reflect_.data, reflect_.size))
+		{
+			log::error("Failed to read shader reflection %s", reflect_path.data());
+			return;
+		}
 
-		yyjson_val* j_entry_points = yyjson_obj_get(j_root, "entryPoints");
-		layout_.entry_points.reserve(yyjson_arr_size(j_entry_points));
-		yyjson_arr_iter j_entry_points_iter;
-		yyjson_arr_iter_init(j_entry_points, &j_entry_points_iter);
-		yyjson_val* j_entry_point;
-		while ((j_entry_point = yyjson_arr_iter_next(&j_entry_points_iter)))
-			read_entry_point(j_entry_point, layout_.entry_points);
+		log::assert(layout_.constant_count() <= 64,
+		            "Too many specialization constants in %s", path_.data());
+		constants_.resize(layout_.constant_count());
 	}
 
 	material::~material()
 	{
 		instance& inst = instance::get();
 
-		if (pipe_)
-			vkDestroyPipeline(inst.get_device(), pipe_, nullptr);
+		for (uint32_t i {0}; i < variants_.size(); ++i)
+			destroy_variant(variants_[i]);
+		if (shader_)
+			vkDestroyShaderModule(inst.get_device(), shader_, nullptr);
 		if (pipe_layout_)
 			vkDestroyPipelineLayout(inst.get_device(), pipe_layout_, nullptr);
 
@@ -297,31 +91,93 @@ namespace vkb::vk
 		}
 	}
 
+	bool material::set_immutable_sampler(mc::string_view name, VkSampler sampler)
+	{
+		log::assert(!pipe_layout_, "Immutable sampler %s set after the layouts of %s",
+		            name.data(), path_.data());
+
+		for (uint32_t i {0}; i < layout_.set_count(); ++i)
+		{
+			reflection_format::set const& set = layout_.get_set(i);
+			for (uint32_t j {0}; j < set.binding_cnt; ++j)
+			{
+				reflection_format::binding const& binding =
+					layout_.get_binding(set.first_binding + j);
+				if (!(name == layout_.get_name(binding.name)) ||
+				    descriptor_type(layout_, i, j) != VK_DESCRIPTOR_TYPE_SAMPLER)
+					continue;
+
+				// An array would need one sampler per element.
+				if (binding.count != 1)
+				{
+					log::error("Sampler array %s can't be immutable", name.data());
+					return false;
+				}
+
+				immutable_sampler& immutable = immutable_samplers_.emplace_back();
+				immutable.set = i;
+				immutable.binding = j;
+				immutable.sampler = sampler;
+				return true;
+			}
+		}
+
+		log::error("Unknown sampler %s in %s", name.data(), path_.data());
+		return false;
+	}
+
+	bool material::has_immutable_sampler(uint32_t set, uint32_t binding) const
+	{
+		for (uint32_t i {0}; i < immutable_samplers_.size(); ++i)
+		{
+			if (immutable_samplers_[i].set == set &&
+			    immutable_samplers_[i].binding == binding)
+				return true;
+		}
+		return false;
+	}
+
 	bool material::create_pipeline_state()
 	{
 		instance& inst = instance::get();
 
-		desc_set_layouts_.resize(layout_.sets.size());
-		mc::vector<VkDescriptorSetLayoutBinding> bindings;
-		for (uint32_t i {0}; i < layout_.sets.size(); ++i)
+		desc_set_layouts_.resize(layout_.set_count());
+		for (uint32_t i {0}; i < layout_.set_count(); ++i)
 		{
-			bindings.clear();
-			fill_bindings(layout_.sets[i].obj, layout_.sets[i].binding_off, bindings);
-			if (layout_.sets[i].uniform_size)
+			reflection_format::set const& set = layout_.get_set(i);
+			if (set.index != i)
+			{
+				log::error("Descriptor set %s isn't contiguous",
+				           layout_.get_name(set.name));
+				return false;
+			}
+
+			scratch                       tmp;
+			VkDescriptorSetLayoutBinding* bindings =
+				tmp.alloc<VkDescriptorSetLayoutBinding>(set.binding_cnt);
+			for (uint32_t j {0}; j < set.binding_cnt; ++j)
 			{
-				VkDescriptorSetLayoutBinding binding {};
-				binding.binding = 0;
-				binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-				binding.descriptorCount = 1;
-				binding.stageFlags = VK_SHADER_STAGE_ALL;
+				reflection_format::binding const& refl_binding =
+					layout_.get_binding(set.first_binding + j);
+
+				bindings[j].binding = refl_binding.binding;
+				bindings[j].descriptorType = descriptor_type(layout_, i, j);
+				bindings[j].descriptorCount = refl_binding.count;
+				bindings[j].stageFlags = refl_binding.stages;
+				bindings[j].pImmutableSamplers = nullptr;
+			}
 
-				bindings.emplace_back(binding);
+			for (uint32_t j {0}; j < immutable_samplers_.size(); ++j)
+			{
+				immutable_sampler const& immutable = immutable_samplers_[j];
+				if (immutable.set == i)
+					bindings[immutable.binding].pImmutableSamplers = &immutable.sampler;
 			}
 
 			VkDescriptorSetLayoutCreateInfo create_info {};
 			create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-			create_info.bindingCount = bindings.size();
-			create_info.pBindings = bindings.data();
+			create_info.bindingCount = set.binding_cnt;
+			create_info.pBindings = bindings;
 
 			VkResult res = vkCreateDescriptorSetLayout(inst.get_device(), &create_info,
 			                                           nullptr, &desc_set_layouts_[i]);
@@ -334,18 +190,21 @@ namespace vkb::vk
 			}
 		}
 
-		// TODO either hardcode it, like vertex input, either retrieve it from slang
-		// reflection
-		VkPushConstantRange cst_range {};
-		cst_range.size = sizeof(mat4);
-		cst_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		push_ranges_.resize(layout_.push_range_count());
+		for (uint32_t i {0}; i < push_ranges_.size(); ++i)
+		{
+			reflection_format::push_range const& range = layout_.get_push_range(i);
+			push_ranges_[i].offset = range.offset;
+			push_ranges_[i].size = range.size;
+			push_ranges_[i].stageFlags = range.stages;
+		}
 
 		VkPipelineLayoutCreateInfo pipe_layout_info {};
 		pipe_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipe_layout_info.setLayoutCount = desc_set_layouts_.size();
 		pipe_layout_info.pSetLayouts = desc_set_layouts_.data();
-		pipe_layout_info.pushConstantRangeCount = 1;
-		pipe_layout_info.pPushConstantRanges = &cst_range;
+		pipe_layout_info.pushConstantRangeCount = push_ranges_.size();
+		pipe_layout_info.pPushConstantRanges = push_ranges_.data();
 
 		VkResult res = vkCreatePipelineLayout(inst.get_device(), &pipe_layout_info,
 		                                      nullptr, &pipe_layout_);
@@ -355,60 +214,148 @@ namespace vkb::vk
 			return false;
 		}
 
-		VkShaderModule shader;
-		uint32_t*      shader_buf {nullptr};
-		int64_t        shader_size {0};
-		FILE*          shader_file {fopen(path_.data(), "rb")};
-		if (!shader_file)
+		pack::resource spirv;
+		if (!pack::get().load(path_, spirv))
 		{
 			log::error("Invalid shader path: %s", path_.data());
 			return false;
 		}
+		spirv_.resize(spirv.size);
+		memcpy(spirv_.data(), spirv.data, spirv.size);
+
+		if (!inst.get_shader_object())
+		{
+			shader_ = inst.create_shader(spirv_.data(), spirv_.size());
+			if (!shader_)
+				return false;
+		}
 
-		fseek(shader_file, 0, SEEK_END);
-		shader_size = ftell(shader_file);
+		return add_variant() != nullptr;
+	}
 
-		fseek(shader_file, 0, SEEK_SET);
-		shader_buf = new uint32_t[shader_size / 4];
-		fread(shader_buf, 1, shader_size, shader_file);
-		fclose(shader_file);
+	material::variant* material::add_variant()
+	{
+		variant& var = variants_.emplace_back();
+		var.mask = constants_mask_;
+		var.values.resize(constants_.size());
+		memcpy(var.values.data(), constants_.data(),
+		       constants_.size() * sizeof(uint32_t));
+		var.st = state_;
+		if (!create_variant(layout_, shader_, spirv_, var))
+		{
+			var.failed = true;
+			return nullptr;
+		}
 
-		VkShaderModuleCreateInfo shader_create_info {};
-		shader_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		shader_create_info.codeSize = shader_size;
-		shader_create_info.pCode = shader_buf;
-		res = vkCreateShaderModule(instance::get().get_device(), &shader_create_info,
-		                           nullptr, &shader);
+		return &var;
+	}
 
-		delete[] shader_buf;
+	bool material::create_variant(layout const& lay, VkShaderModule shader,
+	                              mc::vector<uint8_t> const& spirv, variant& var) const
+	{
+		// Only the constants set on the material are specialized, the others keep
+		// their default value from the shader.
+		scratch                   tmp;
+		VkSpecializationMapEntry* spec_entries =
+			tmp.alloc<VkSpecializationMapEntry>(lay.constant_count());
+		uint32_t spec_cnt {0};
+		for (uint32_t i {0}; i < lay.constant_count(); ++i)
+		{
+			if (!(var.mask & (1ull << i)))
+				continue;
+
+			VkSpecializationMapEntry& entry = spec_entries[spec_cnt++];
+			entry.constantID = lay.get_constant(i).id;
+			entry.offset = i * sizeof(uint32_t);
+			entry.size = sizeof(uint32_t);
+		}
+
+		VkSpecializationInfo spec_info {};
+		spec_info.mapEntryCount = spec_cnt;
+		spec_info.pMapEntries = spec_entries;
+		spec_info.dataSize = var.values.size() * sizeof(uint32_t);
+		spec_info.pData = var.values.data();
+
+		if (instance::get().get_shader_object())
+			return create_shader_objects(lay, spirv, spec_info, var);
+
+		return create_pipeline(lay, shader, spec_info, var);
+	}
+
+	bool material::create_shader_objects(layout const&               lay,
+	                                     mc::vector<uint8_t> const&  spirv,
+	                                     VkSpecializationInfo const& spec_info,
+	                                     variant&                    var) const
+	{
+		instance& inst = instance::get();
+
+		VkShaderStageFlags all_stages {0};
+		for (uint32_t i {0}; i < lay.entry_point_count(); ++i)
+			all_stages |= lay.get_entry_point(i).stage;
+
+		// Stages are linked together, so the driver can optimize across them as it
+		// would for a pipeline.
+		uint32_t               stage_cnt = lay.entry_point_count();
+		scratch                tmp;
+		VkShaderCreateInfoEXT* create_infos = tmp.alloc<VkShaderCreateInfoEXT>(stage_cnt);
+		for (uint32_t i {0}; i < stage_cnt; ++i)
+		{
+			reflection_format::entry_point const& entry_point = lay.get_entry_point(i);
+
+			VkShaderCreateInfoEXT& info = create_infos[i];
+			info.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
+			info.flags = stage_cnt > 1 ? VK_SHADER_CREATE_LINK_STAGE_BIT_EXT : 0;
+			info.stage = static_cast<VkShaderStageFlagBits>(entry_point.stage);
+			// Graphics stage bits are in pipeline order.
+			info.nextStage = entry_point.stage == VK_SHADER_STAGE_FRAGMENT_BIT
+			                     ? 0
+			                     : all_stages & ~((entry_point.stage << 1) - 1);
+			info.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+			info.codeSize = spirv.size();
+			info.pCode = spirv.data();
+			info.pName = lay.get_name(entry_point.name);
+			info.setLayoutCount = desc_set_layouts_.size();
+			info.pSetLayouts = desc_set_layouts_.data();
+			info.pushConstantRangeCount = push_ranges_.size();
+			info.pPushConstantRanges = push_ranges_.data();
+			info.pSpecializationInfo = &spec_info;
+		}
+
+		var.shaders.resize(stage_cnt);
+		VkResult res = inst.get_shader_object()->create_shaders(
+			inst.get_device(), stage_cnt, create_infos, nullptr, var.shaders.data());
 		if (res != VK_SUCCESS)
 		{
-			log::error("Failed to create shader module (%s)", string_VkResult(res));
+			log::error("Failed to create shader objects (%s)", string_VkResult(res));
+			var.shaders.clear();
 			return false;
 		}
 
-		mc::vector<VkPipelineShaderStageCreateInfo> shader_stages_info(
-			layout_.entry_points.size());
-		for (uint32_t i {0}; i < shader_stages_info.size(); ++i)
+		return true;
+	}
+
+	bool material::create_pipeline(layout const& lay, VkShaderModule shader,
+	                               VkSpecializationInfo const& spec_info,
+	                               variant& var) const
+	{
+		instance& inst = instance::get();
+
+		uint32_t                         stage_cnt = lay.entry_point_count();
+		scratch                          tmp;
+		VkPipelineShaderStageCreateInfo* shader_stages_info =
+			tmp.alloc<VkPipelineShaderStageCreateInfo>(stage_cnt);
+		for (uint32_t i {0}; i < stage_cnt; ++i)
 		{
+			reflection_format::entry_point const& entry_point =
+				lay.get_entry_point(i);
+
 			shader_stages_info[i].sType =
 				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-			shader_stages_info[i].pNext = nullptr;
-			shader_stages_info[i].flags = 0;
-			shader_stages_info[i].pSpecializationInfo = nullptr;
+			shader_stages_info[i].pSpecializationInfo = &spec_info;
 			shader_stages_info[i].module = shader;
-			shader_stages_info[i].pName = layout_.entry_points[i].name.data();
-
-			switch (layout_.entry_points[i].stage)
-			{
-				case shader_stage::vertex:
-					shader_stages_info[i].stage = VK_SHADER_STAGE_VERTEX_BIT;
-					break;
-				case shader_stage::fragment:
-					shader_stages_info[i].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-					break;
-				default: log::assert(false, "unknown stage"); break;
-			}
+			shader_stages_info[i].pName = lay.get_name(entry_point.name);
+			shader_stages_info[i].stage =
+				static_cast<VkShaderStageFlagBits>(entry_point.stage);
 		}
 
 		// TODO explore batch/instantiated rendering
@@ -417,42 +364,47 @@ namespace vkb::vk
 		input_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		input_binding.stride = sizeof(model::vert);
 
-		// TODO hardcode this in a better place, to use it more globally
+		// Vertex inputs are tightly packed in model::vert, in locations order.
 		// TODO use pos/normal/uv format when importing models
-		mc::array<VkVertexInputAttributeDescription, 3> input_attributes;
-		input_attributes[0].binding = 0;
-		input_attributes[0].location = 0;
-		input_attributes[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		input_attributes[0].offset = offsetof(model::vert, pos);
-
-		input_attributes[1].binding = 0;
-		input_attributes[1].location = 1;
-		input_attributes[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		input_attributes[1].offset = offsetof(model::vert, col);
-
-		input_attributes[2].binding = 0;
-		input_attributes[2].location = 2;
-		input_attributes[2].format = VK_FORMAT_R32G32_SFLOAT;
-		input_attributes[2].offset = offsetof(model::vert, uv);
+		uint32_t                           input_cnt = lay.vertex_input_count();
+		VkVertexInputAttributeDescription* input_attributes =
+			tmp.alloc<VkVertexInputAttributeDescription>(input_cnt);
+		uint32_t input_off {0};
+		for (uint32_t i {0}; i < input_cnt; ++i)
+		{
+			reflection_format::vertex_input const& input = lay.get_vertex_input(i);
+			input_attributes[i].binding = 0;
+			input_attributes[i].location = input.location;
+			input_attributes[i].format = static_cast<VkFormat>(input.format);
+			input_attributes[i].offset = input_off;
+			input_off += format_size(input_attributes[i].format);
+		}
+
+		if (input_off > sizeof(model::vert))
+		{
+			log::error("Vertex inputs of %s don't match model vertices", path_.data());
+			return false;
+		}
 
 		VkPipelineVertexInputStateCreateInfo vert_input_info {};
 		vert_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vert_input_info.vertexBindingDescriptionCount = 1;
 		vert_input_info.pVertexBindingDescriptions = &input_binding;
-		vert_input_info.vertexAttributeDescriptionCount = input_attributes.size();
-		vert_input_info.pVertexAttributeDescriptions = input_attributes.data();
+		vert_input_info.vertexAttributeDescriptionCount = input_cnt;
+		vert_input_info.pVertexAttributeDescriptions = input_attributes;
 
 		VkPipelineInputAssemblyStateCreateInfo input_assembly {};
 		input_assembly.sType =
 			VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		input_assembly.topology = var.st.topology;
 
-		// TODO explore more dynamic states to limit PSOs
+		// Shader objects make all the state dynamic.
 		VkDynamicState dynamic_states[] {VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
-		                                 VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT};
+		                                 VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT,
+		                                 VK_DYNAMIC_STATE_LINE_WIDTH};
 		VkPipelineDynamicStateCreateInfo dynamic_state_info {};
 		dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamic_state_info.dynamicStateCount = 2;
+		dynamic_state_info.dynamicStateCount = 3;
 		dynamic_state_info.pDynamicStates = dynamic_states;
 
 		VkPipelineViewportStateCreateInfo viewport_state {};
@@ -462,10 +414,10 @@ namespace vkb::vk
 		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 		rasterizer.depthClampEnable = VK_FALSE;
 		rasterizer.rasterizerDiscardEnable = VK_FALSE;
-		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.polygonMode = var.st.polygon_mode;
 		rasterizer.lineWidth = 1.f;
-		rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizer.cullMode = var.st.cull_mode;
+		rasterizer.frontFace = var.st.front_face;
 
 		VkPipelineMultisampleStateCreateInfo msaa {};
 		msaa.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -491,16 +443,16 @@ namespace vkb::vk
 
 		VkPipelineDepthStencilStateCreateInfo depth_stencil {};
 		depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depth_stencil.depthTestEnable = VK_TRUE;
-		depth_stencil.depthWriteEnable = VK_TRUE;
-		depth_stencil.depthCompareOp = VK_COMPARE_OP_LESS;
+		depth_stencil.depthTestEnable = var.st.depth_test;
+		depth_stencil.depthWriteEnable = var.st.depth_write;
+		depth_stencil.depthCompareOp = var.st.depth_compare;
 		// TODO explore stencil usages (picking, see-through, ...)
 		depth_stencil.stencilTestEnable = VK_FALSE;
 
 		VkGraphicsPipelineCreateInfo create_info {};
 		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		create_info.stageCount = shader_stages_info.size();
-		create_info.pStages = shader_stages_info.data();
+		create_info.stageCount = stage_cnt;
+		create_info.pStages = shader_stages_info;
 		create_info.pVertexInputState = &vert_input_info;
 		create_info.pInputAssemblyState = &input_assembly;
 		create_info.pViewportState = &viewport_state;
@@ -519,15 +471,73 @@ namespace vkb::vk
 		// TODO use global hardcoded formats
 		VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
 		rendering_info.pColorAttachmentFormats = &format;
-		rendering_info.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+		rendering_info.depthAttachmentFormat = instance::get().get_depth_format();
 
 		create_info.pNext = &rendering_info;
 
-		res = vkCreateGraphicsPipelines(inst.get_device(), nullptr, 1, &create_info,
-		                                nullptr, &pipe_);
+		if (pipeline_library* lib = inst.get_pipeline_library())
+		{
+			// Vertex stages go in the pre-rasterization part, the fragment stage in the
+			// fragment shader part.
+			uint32_t                               pre_raster_cnt {0};
+			VkPipelineShaderStageCreateInfo const* frag_stage {nullptr};
+			VkPipelineShaderStageCreateInfo*       pre_raster_stages =
+				tmp.alloc<VkPipelineShaderStageCreateInfo>(stage_cnt);
+			for (uint32_t i {0}; i < stage_cnt; ++i)
+			{
+				if (shader_stages_info[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+					frag_stage = &shader_stages_info[i];
+				else
+					pre_raster_stages[pre_raster_cnt++] = shader_stages_info[i];
+			}
+
+			VkGraphicsPipelineCreateInfo pre_raster_info {};
+			pre_raster_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			pre_raster_info.pNext = &rendering_info;
+			pre_raster_info.stageCount = pre_raster_cnt;
+			pre_raster_info.pStages = pre_raster_stages;
+			pre_raster_info.pViewportState = &viewport_state;
+			pre_raster_info.pRasterizationState = &rasterizer;
+			pre_raster_info.pDynamicState = &dynamic_state_info;
+			pre_raster_info.layout = pipe_layout_;
+			var.lib_parts[0] =
+				lib->create_part(pre_raster_info, pipeline_library::pre_rasterization);
+
+			VkGraphicsPipelineCreateInfo frag_info {};
+			frag_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			frag_info.pNext = &rendering_info;
+			frag_info.stageCount = frag_stage ? 1 : 0;
+			frag_info.pStages = frag_stage;
+			frag_info.pMultisampleState = &msaa;
+			frag_info.pDepthStencilState = &depth_stencil;
+			frag_info.layout = pipe_layout_;
+			var.lib_parts[1] =
+				lib->create_part(frag_info, pipeline_library::fragment_shader);
+
+			VkPipeline parts[pipeline_library::part_count] {
+				lib->get_vertex_input(input_binding, input_attributes, input_cnt,
+				                      input_assembly.topology),
+				var.lib_parts[0], var.lib_parts[1],
+				lib->get_fragment_output(format, rendering_info.depthAttachmentFormat,
+				                         color_attachment)};
+			for (uint32_t i {0}; i < pipeline_library::part_count; ++i)
+			{
+				if (!parts[i])
+					return false;
+			}
 
-		vkDestroyShaderModule(inst.get_device(), shader, nullptr);
+			var.pipe = lib->link(parts, pipe_layout_);
+			if (!var.pipe)
+				return false;
 
+			// Swapped in by bind() once linked.
+			var.optimizing = lib->link_optimized(parts, pipe_layout_);
+			return true;
+		}
+
+		VkResult res = vkCreateGraphicsPipelines(inst.get_device(),
+		                                         inst.get_pipeline_cache(), 1,
+		                                         &create_info, nullptr, &var.pipe);
 		if (res != VK_SUCCESS)
 		{
 			log::error("Failed to create graphics pipeline (%s)", string_VkResult(res));
@@ -537,9 +547,24 @@ namespace vkb::vk
 		return true;
 	}
 
-	VkDescriptorSetLayout material::get_descriptor_set_layout()
+	mc::string const& material::get_path() const
+	{
+		return path_;
+	}
+
+	layout const& material::get_layout() const
 	{
-		return desc_set_layouts_[0];
+		return layout_;
+	}
+
+	uint32_t material::descriptor_set_count() const
+	{
+		return desc_set_layouts_.size();
+	}
+
+	VkDescriptorSetLayout material::get_descriptor_set_layout(uint32_t idx)
+	{
+		return desc_set_layouts_[idx];
 	}
 
 	VkPipelineLayout material::get_pipeline_layout()
@@ -547,8 +572,388 @@ namespace vkb::vk
 		return pipe_layout_;
 	}
 
-	VkPipeline material::get_pipeline()
+	VkDescriptorType material::descriptor_type(layout const& lay, uint32_t set,
+	                                           uint32_t binding)
+	{
+		// slangrc lists the uniform block first.
+		reflection_format::set const& refl_set = lay.get_set(set);
+		if (refl_set.uniform_size && binding == 0)
+			return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
+		return static_cast<VkDescriptorType>(
+			lay.get_binding(refl_set.first_binding + binding).type);
+	}
+
+	material::variant* material::get_variant()
+	{
+		// Failed variants aren't compiled again, they fall back on the first one.
+		auto fallback = [&]() -> variant*
+		{
+			return !variants_[0].failed ? &variants_[0] : nullptr;
+		};
+
+		bool shader_object = instance::get().get_shader_object() != nullptr;
+		for (uint32_t i {0}; i < variants_.size(); ++i)
+		{
+			variant& var = variants_[i];
+			if (var.mask == constants_mask_ &&
+			    memcmp(var.values.data(), constants_.data(),
+			           constants_.size() * sizeof(uint32_t)) == 0 &&
+			    (shader_object || same_baked_state(var.st, state_)))
+				return var.failed ? fallback() : &var;
+		}
+
+		// Compiled on first use, which stalls the frame requesting it.
+		variant* var = add_variant();
+		if (!var)
+			return fallback();
+
+		return var;
+	}
+
+	bool material::bind(VkCommandBuffer cmd)
+	{
+		variant* var = get_variant();
+		if (!var)
+		{
+			log::error("No pipeline to bind for %s", path_.data());
+			return false;
+		}
+
+		instance::shader_object_fns const* fns = instance::get().get_shader_object();
+		if (!fns)
+		{
+			if (var->optimizing)
+			{
+				// The fast linked pipeline may still be used by frames in flight.
+				VkPipeline optimized = instance::get().get_pipeline_library()->take(
+					var->optimizing);
+				if (optimized)
+				{
+					var->optimizing = nullptr;
+					var->fast_pipe = var->pipe;
+					var->pipe = optimized;
+				}
+			}
+
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, var->pipe);
+			vkCmdSetLineWidth(cmd, state_.line_width);
+			return true;
+		}
+
+		VkShaderStageFlagBits stages[8];
+		uint32_t              stage_cnt = var->shaders.size();
+		for (uint32_t i {0}; i < stage_cnt; ++i)
+		{
+			stages[i] = static_cast<VkShaderStageFlagBits>(
+				layout_.get_entry_point(i).stage);
+		}
+		fns->cmd_bind_shaders(cmd, stage_cnt, stages, var->shaders.data());
+
+		// Same vertex layout as the pipelines, see create_pipeline().
+		VkVertexInputBindingDescription2EXT input_binding {};
+		input_binding.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT;
+		input_binding.binding = 0;
+		input_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		input_binding.stride = sizeof(model::vert);
+		input_binding.divisor = 1;
+
+		constexpr uint32_t max_inputs {16};
+
+		VkVertexInputAttributeDescription2EXT input_attributes[max_inputs];
+		uint32_t input_cnt = layout_.vertex_input_count();
+		if (input_cnt > max_inputs)
+			input_cnt = max_inputs;
+		uint32_t input_off {0};
+		for (uint32_t i {0}; i < input_cnt; ++i)
+		{
+			reflection_format::vertex_input const& input = layout_.get_vertex_input(i);
+			input_attributes[i] = {};
+			input_attributes[i].sType =
+				VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT;
+			input_attributes[i].binding = 0;
+			input_attributes[i].location = input.location;
+			input_attributes[i].format = static_cast<VkFormat>(input.format);
+			input_attributes[i].offset = input_off;
+			input_off += format_size(input_attributes[i].format);
+		}
+		fns->cmd_set_vertex_input(cmd, 1, &input_binding, input_cnt, input_attributes);
+
+		vkCmdSetPrimitiveTopology(cmd, state_.topology);
+		vkCmdSetPrimitiveRestartEnable(cmd, VK_FALSE);
+		vkCmdSetRasterizerDiscardEnable(cmd, VK_FALSE);
+		vkCmdSetDepthBiasEnable(cmd, VK_FALSE);
+		vkCmdSetStencilTestEnable(cmd, VK_FALSE);
+		vkCmdSetCullMode(cmd, state_.cull_mode);
+		vkCmdSetFrontFace(cmd, state_.front_face);
+		vkCmdSetDepthTestEnable(cmd, state_.depth_test);
+		vkCmdSetDepthWriteEnable(cmd, state_.depth_write);
+		vkCmdSetDepthCompareOp(cmd, state_.depth_compare);
+		fns->cmd_set_polygon_mode(cmd, state_.polygon_mode);
+		vkCmdSetLineWidth(cmd, state_.line_width);
+
+		VkSampleMask sample_mask {~0u};
+		fns->cmd_set_rasterization_samples(cmd, VK_SAMPLE_COUNT_1_BIT);
+		fns->cmd_set_sample_mask(cmd, VK_SAMPLE_COUNT_1_BIT, &sample_mask);
+		fns->cmd_set_alpha_to_coverage(cmd, VK_FALSE);
+
+		VkBool32              blend {VK_FALSE};
+		VkColorComponentFlags write_mask {
+			VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT};
+		fns->cmd_set_color_blend_enable(cmd, 0, 1, &blend);
+		fns->cmd_set_color_write_mask(cmd, 0, 1, &write_mask);
+		return true;
+	}
+
+	void material::set_state(state const& st)
+	{
+		state_ = st;
+	}
+
+	material::state const& material::get_state() const
+	{
+		return state_;
+	}
+
+	void material::push_constants(VkCommandBuffer cmd, uint32_t offset, uint32_t size,
+	                              void const* data)
+	{
+		VkShaderStageFlags stages {0};
+		for (uint32_t i {0}; i < layout_.push_range_count(); ++i)
+		{
+			reflection_format::push_range const& range = layout_.get_push_range(i);
+			if (offset < range.offset + range.size && range.offset < offset + size)
+				stages |= range.stages;
+		}
+
+		log::assert(stages, "No push constant range in %s at %u", path_.data(), offset);
+		vkCmdPushConstants(cmd, pipe_layout_, stages, offset, size, data);
+	}
+
+	bool material::set_constant(mc::string_view name, uint32_t value)
+	{
+		return set_constant(name, reflection_format::scalar_type::uint32, value);
+	}
+
+	bool material::set_constant(mc::string_view name, int32_t value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return set_constant(name, reflection_format::scalar_type::int32, bits);
+	}
+
+	bool material::set_constant(mc::string_view name, float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return set_constant(name, reflection_format::scalar_type::float32, bits);
+	}
+
+	bool material::set_constant(mc::string_view name, reflection_format::scalar_type type,
+	                            uint32_t bits)
+	{
+		for (uint32_t i {0}; i < layout_.constant_count(); ++i)
+		{
+			reflection_format::constant const& cst = layout_.get_constant(i);
+			if (name == layout_.get_name(cst.name))
+			{
+				if (cst.type != type)
+				{
+					log::error("Invalid type for specialization constant %s",
+					           name.data());
+					return false;
+				}
+
+				constants_[i] = bits;
+				constants_mask_ |= 1ull << i;
+				return true;
+			}
+		}
+
+		log::error("Unknown specialization constant %s", name.data());
+		return false;
+	}
+
+	void material::begin_rebuild(rebuild& reb) const
+	{
+		reb.variants.clear();
+		for (uint32_t i {0}; i < variants_.size(); ++i)
+		{
+			variant& var = reb.variants.emplace_back();
+			var.mask = variants_[i].mask;
+			var.values.resize(variants_[i].values.size());
+			memcpy(var.values.data(), variants_[i].values.data(),
+			       var.values.size() * sizeof(uint32_t));
+			var.st = variants_[i].st;
+			var.failed = variants_[i].failed;
+		}
+	}
+
+	bool material::build_rebuild(rebuild& reb, uint8_t const* spirv, uint64_t spirv_size,
+	                             uint8_t const* reflect, uint64_t reflect_size) const
+	{
+		reb.reflect.resize(reflect_size);
+		memcpy(reb.reflect.data(), reflect, reflect_size);
+		if (!reb.lay.load(reb.reflect.data(), reb.reflect.size()))
+		{
+			log::error("Failed to read shader reflection of %s", path_.data());
+			return false;
+		}
+
+		if (!compatible(reb.lay))
+		{
+			log::error("%s changed its resources, restart to apply it", path_.data());
+			return false;
+		}
+
+		reb.spirv.resize(spirv_size);
+		memcpy(reb.spirv.data(), spirv, spirv_size);
+		if (!instance::get().get_shader_object())
+		{
+			reb.shader = instance::get().create_shader(spirv, spirv_size);
+			if (!reb.shader)
+				return false;
+		}
+
+		// Failed variants get another chance with the new shader, without failing
+		// the rebuild.
+		for (uint32_t i {0}; i < reb.variants.size(); ++i)
+		{
+			variant& var = reb.variants[i];
+			bool     failed = var.failed;
+			var.failed = !create_variant(reb.lay, reb.shader, reb.spirv, var);
+			if (var.failed && !failed)
+				return false;
+		}
+
+		return true;
+	}
+
+	void material::end_rebuild(rebuild& reb)
+	{
+		reflect_.storage = static_cast<mc::vector<uint8_t>&&>(reb.reflect);
+		reflect_.data = reflect_.storage.data();
+		reflect_.size = reflect_.storage.size();
+		layout_.load(reflect_.data, reflect_.size);
+
+		spirv_ = static_cast<mc::vector<uint8_t>&&>(reb.spirv);
+
+		VkShaderModule old_shader = shader_;
+		shader_ = reb.shader;
+		reb.shader = old_shader;
+
+		uint32_t rebuilt_cnt = reb.variants.size();
+		for (uint32_t i {0}; i < rebuilt_cnt; ++i)
+		{
+			variant old = static_cast<variant&&>(variants_[i]);
+			variants_[i] = static_cast<variant&&>(reb.variants[i]);
+			reb.variants[i] = static_cast<variant&&>(old);
+		}
+
+		// Variants added during the rebuild still use the old shader, they are created
+		// again on next use.
+		for (uint32_t i {rebuilt_cnt}; i < variants_.size(); ++i)
+			reb.variants.emplace_back(static_cast<variant&&>(variants_[i]));
+		variants_.resize(rebuilt_cnt);
+	}
+
+	void material::destroy_rebuild(rebuild& reb)
 	{
-		return pipe_;
+		instance& inst = instance::get();
+
+		for (uint32_t i {0}; i < reb.variants.size(); ++i)
+			destroy_variant(reb.variants[i]);
+		if (reb.shader)
+			vkDestroyShaderModule(inst.get_device(), reb.shader, nullptr);
+
+		reb.variants.clear();
+		reb.shader = nullptr;
+	}
+
+	void material::destroy_variant(variant& var)
+	{
+		instance& inst = instance::get();
+
+		if (var.optimizing)
+			inst.get_pipeline_library()->cancel(var.optimizing);
+		vkDestroyPipeline(inst.get_device(), var.pipe, nullptr);
+		vkDestroyPipeline(inst.get_device(), var.fast_pipe, nullptr);
+		for (uint32_t i {0}; i < 2; ++i)
+			vkDestroyPipeline(inst.get_device(), var.lib_parts[i], nullptr);
+		for (uint32_t i {0}; i < var.shaders.size(); ++i)
+			inst.get_shader_object()->destroy_shader(inst.get_device(), var.shaders[i],
+			                                         nullptr);
+		var = {};
+	}
+
+	bool material::compatible(layout const& lay) const
+	{
+		auto same_name = [&](uint32_t lhs, uint32_t rhs)
+		{
+			return strcmp(layout_.get_name(lhs), lay.get_name(rhs)) == 0;
+		};
+
+		if (lay.set_count() != layout_.set_count() ||
+		    lay.push_range_count() != layout_.push_range_count() ||
+		    lay.constant_count() != layout_.constant_count())
+			return false;
+
+		for (uint32_t i {0}; i < layout_.set_count(); ++i)
+		{
+			reflection_format::set const& lhs = layout_.get_set(i);
+			reflection_format::set const& rhs = lay.get_set(i);
+			if (lhs.index != rhs.index || lhs.uniform_size != rhs.uniform_size ||
+			    lhs.binding_cnt != rhs.binding_cnt || lhs.member_cnt != rhs.member_cnt)
+				return false;
+
+			for (uint32_t j {0}; j < lhs.binding_cnt; ++j)
+			{
+				reflection_format::binding const& lhs_binding =
+					layout_.get_binding(lhs.first_binding + j);
+				reflection_format::binding const& rhs_binding =
+					lay.get_binding(rhs.first_binding + j);
+				if (lhs_binding.binding != rhs_binding.binding ||
+				    lhs_binding.type != rhs_binding.type ||
+				    lhs_binding.count != rhs_binding.count ||
+				    lhs_binding.stages != rhs_binding.stages)
+					return false;
+			}
+
+			// Uniforms are written by name and offset.
+			for (uint32_t j {0}; j < lhs.member_cnt; ++j)
+			{
+				reflection_format::member const& lhs_member =
+					layout_.get_member(lhs.first_member + j);
+				reflection_format::member const& rhs_member =
+					lay.get_member(rhs.first_member + j);
+				if (!same_name(lhs_member.name, rhs_member.name) ||
+				    lhs_member.offset != rhs_member.offset ||
+				    lhs_member.size != rhs_member.size ||
+				    lhs_member.type != rhs_member.type)
+					return false;
+			}
+		}
+
+		for (uint32_t i {0}; i < layout_.push_range_count(); ++i)
+		{
+			reflection_format::push_range const& lhs = layout_.get_push_range(i);
+			reflection_format::push_range const& rhs = lay.get_push_range(i);
+			if (lhs.offset != rhs.offset || lhs.size != rhs.size ||
+			    lhs.stages != rhs.stages)
+				return false;
+		}
+
+		// Variant masks index the constants.
+		for (uint32_t i {0}; i < layout_.constant_count(); ++i)
+		{
+			reflection_format::constant const& lhs = layout_.get_constant(i);
+			reflection_format::constant const& rhs = lay.get_constant(i);
+			if (!same_name(lhs.name, rhs.name) || lhs.id != rhs.id ||
+			    lhs.type != rhs.type)
+				return false;
+		}
+
+		return true;
 	}
 } // namespace vkb::vk
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "../core/handle.hh"
+#include "../core/pack.hh"
 #include "material_layout.hh"
+#include "pipeline_library.hh"
 
 #include <string.hh>
 #include <string_view.hh>
+#include <vector.hh>
 
 #include <stdint.h>
 
@@ -14,22 +18,167 @@ namespace vkb::vk
 	class material
 	{
 	public:
+		// Fixed function state. It is dynamic when drawing with shader objects, and
+		// baked in the pipelines otherwise.
+		struct state
+		{
+			VkCullModeFlags     cull_mode {VK_CULL_MODE_BACK_BIT};
+			VkFrontFace         front_face {VK_FRONT_FACE_COUNTER_CLOCKWISE};
+			VkPolygonMode       polygon_mode {VK_POLYGON_MODE_FILL};
+			VkBool32            depth_test {VK_TRUE};
+			VkBool32            depth_write {VK_TRUE};
+			VkCompareOp         depth_compare {VK_COMPARE_OP_LESS};
+			VkPrimitiveTopology topology {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+			// Dynamic in the pipelines too, so last: it isn't compared when looking for
+			// the pipeline variant of a state.
+			float line_width {1.f};
+		};
+
+		// Shaders specialized with the constants set in mask, one bit per reflected
+		// constant. Drawing with pipelines, each state also has its own variant.
+		struct variant
+		{
+			uint64_t             mask {0};
+			mc::vector<uint32_t> values;
+			state                st;
+			VkPipeline           pipe {nullptr};
+			// One per entry point, with shader objects.
+			mc::vector<VkShaderEXT> shaders;
+
+			// With pipeline libraries, pipe is first linked fast, then replaced by the
+			// optimized link. The shared parts are owned by the library.
+			VkPipeline                  lib_parts[2] {};
+			VkPipeline                  fast_pipe {nullptr};
+			pipeline_library::link_job* optimizing {nullptr};
+
+			// Failed to compile, kept so its key isn't compiled again on every bind.
+			bool failed {false};
+		};
+
+		// New shader and pipelines for all the variants, built in the background from
+		// a new version of the shader. Once swapped in, holds the replaced ones until
+		// no frame uses them anymore.
+		struct rebuild
+		{
+			// Viewed by lay.
+			mc::vector<uint8_t> reflect;
+			layout              lay;
+			mc::vector<uint8_t> spirv;
+			VkShaderModule      shader {nullptr};
+			mc::vector<variant> variants;
+		};
+
 		material(mc::string_view shader);
 		~material();
 
+		// Bakes sampler in the set layout as the immutable sampler of a sampler
+		// binding, which the instances then don't write. The sampler must come from
+		// instance::get_sampler(), to outlive the layout. Must be called before
+		// create_pipeline_state(). Returns false if the shader has no sampler binding
+		// with this name.
+		bool set_immutable_sampler(mc::string_view name, VkSampler sampler);
+		// Binding counted from reflection_format::set::first_binding.
+		bool has_immutable_sampler(uint32_t set, uint32_t binding) const;
+
 		bool create_pipeline_state();
 
-		VkDescriptorSetLayout get_descriptor_set_layout();
+		// SPIR-V path given on creation.
+		mc::string const& get_path() const;
+
+		layout const& get_layout() const;
+
+		// One layout per reflected set, in set index order.
+		uint32_t              descriptor_set_count() const;
+		VkDescriptorSetLayout get_descriptor_set_layout(uint32_t idx);
 		VkPipelineLayout      get_pipeline_layout();
-		VkPipeline            get_pipeline();
+
+		// Type of a binding of a set, counted from reflection_format::set::first_binding.
+		// The uniform block of a set is a dynamic uniform buffer, offset in the
+		// uniform arena each time the set is bound.
+		static VkDescriptorType descriptor_type(layout const& lay, uint32_t set,
+		                                        uint32_t binding);
+
+		// Binds the shaders for the current specialization constants and state,
+		// compiling them on first use. With shader objects, also sets the whole
+		// fixed function state except the viewports and scissors. Returns false if
+		// there is no pipeline to draw with.
+		bool bind(VkCommandBuffer cmd);
+
+		void         set_state(state const& st);
+		state const& get_state() const;
+
+		// Pushes constants to all the stages whose reflected range overlaps them.
+		void push_constants(VkCommandBuffer cmd, uint32_t offset, uint32_t size,
+		                    void const* data);
+
+		// Sets a specialization constant by its name in the shader. Returns false if
+		// the shader has no constant with this name and type.
+		bool set_constant(mc::string_view name, uint32_t value);
+		bool set_constant(mc::string_view name, int32_t value);
+		bool set_constant(mc::string_view name, float value);
+
+		// Hot reload, in three steps: begin_rebuild() snapshots the variants on the
+		// main thread, build_rebuild() creates the new pipelines on any thread, then
+		// end_rebuild() swaps them in on the main thread, between two frames. The
+		// material must not be rebuilt twice at once.
+		// The new shader must keep the same resources, push constants and
+		// specialization constants, since the pipeline layout and the descriptor sets
+		// are kept.
+		void begin_rebuild(rebuild& reb) const;
+		bool build_rebuild(rebuild& reb, uint8_t const* spirv, uint64_t spirv_size,
+		                   uint8_t const* reflect, uint64_t reflect_size) const;
+		void end_rebuild(rebuild& reb);
+
+		static void destroy_rebuild(rebuild& reb);
 
 	private:
+		struct immutable_sampler
+		{
+			uint32_t  set {0};
+			uint32_t  binding {0};
+			VkSampler sampler {nullptr};
+		};
+
+		// Variant for the current constants and state, added on first use. The first
+		// variant if it failed to compile, nullptr if that one failed too.
+		variant* get_variant();
+		// Keeps the variant, marked failed, if it doesn't compile.
+		variant* add_variant();
+		bool     create_variant(layout const& lay, VkShaderModule shader,
+		                        mc::vector<uint8_t> const& spirv, variant& var) const;
+		bool     create_pipeline(layout const& lay, VkShaderModule shader,
+		                         VkSpecializationInfo const& spec_info,
+		                         variant& var) const;
+		bool     create_shader_objects(layout const&               lay,
+		                               mc::vector<uint8_t> const&  spirv,
+		                               VkSpecializationInfo const& spec_info,
+		                               variant& var) const;
+		bool     compatible(layout const& lay) const;
+
+		static void destroy_variant(variant& var);
+		bool set_constant(mc::string_view name, reflection_format::scalar_type type,
+		                  uint32_t bits);
+
 		mc::string path_;
 
-		layout layout_;
+		// Viewed by layout_, kept alive with the material.
+		pack::resource reflect_;
+		layout         layout_;
 
+		mc::vector<immutable_sampler>     immutable_samplers_;
 		mc::vector<VkDescriptorSetLayout> desc_set_layouts_;
+		mc::vector<VkPushConstantRange>   push_ranges_;
 		VkPipelineLayout                  pipe_layout_ {nullptr};
-		VkPipeline                        pipe_ {nullptr};
+		// Kept to compile new variants. The module is only used by pipelines.
+		mc::vector<uint8_t> spirv_;
+		VkShaderModule      shader_ {nullptr};
+
+		mc::vector<uint32_t> constants_;
+		uint64_t             constants_mask_ {0};
+		state                state_;
+		mc::vector<variant>  variants_;
 	};
+
+	// Of the materials registered in the context, which stay owned by their users.
+	using material_handle = handle<material>;
 }
\ No newline at end of file
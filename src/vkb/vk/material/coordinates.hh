@@ -3,7 +3,9 @@
 #include <vulkan/vulkan.h>
 
 #include "../../math/vec2.hh"
-#include "../buffer.hh"
+#include "../assets/model.hh"
+#include "../material.hh"
+#include "../material_instance.hh"
 
 namespace vkb
 {
@@ -28,23 +30,15 @@ namespace vkb::vk
 		coordinates& operator=(coordinates const&) = delete;
 		coordinates& operator=(coordinates&&) = delete;
 
-		void prepare_draw(VkCommandBuffer cmd, uint32_t const img_idx,
-		                  cam::base const& cam, mat4 const& proj, vec2 translate);
-		void draw(VkCommandBuffer cmd, uint32_t const img_idx);
+		void prepare_draw(cam::base const& cam, mat4 const& proj, vec2 translate);
+		void draw(VkCommandBuffer cmd);
 
-	private:
-		VkDescriptorSetLayout dynamic_set_layout_ {nullptr};
-
-		VkDescriptorPool desc_pool_ {nullptr};
+		material& get_material();
 
-		VkDescriptorSet dynamic_sets_[3] {nullptr};
-		buffer          staging_uniforms_[3];
-		buffer          uniforms_[3];
-
-		VkPipelineLayout pipe_layout_ {nullptr};
-		VkPipeline       pipe_ {nullptr};
+	private:
+		material          mat_;
+		material_instance params_;
 
-		buffer vertices_;
-		buffer indices_;
+		model mesh_;
 	};
 }
\ No newline at end of file
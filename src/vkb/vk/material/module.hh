@@ -3,7 +3,8 @@
 #include <vector.hh>
 #include <vulkan/vulkan.h>
 
-#include "../buffer.hh"
+#include "../material.hh"
+#include "../material_instance.hh"
 
 #include "../../math/mat4.hh"
 #include "../../math/vec4.hh"
@@ -17,7 +18,7 @@ namespace vkb
 
 	namespace vk
 	{
-		struct texture;
+		class texture_pool;
 		struct model;
 	}
 }
@@ -27,31 +28,30 @@ namespace vkb::vk
 	class module
 	{
 	public:
-		module(texture const& tex);
+		// Pushed for each drawn part, selecting its slot in the texture pool.
+		struct part
+		{
+			mat4     trs;
+			vec4     uv_rect {0.f, 0.f, 1.f, 1.f};
+			uint32_t layer {0};
+		};
+
+		// uv_tiling specializes the shader, for textures repeated on each face.
+		module(texture_pool const& pool, float uv_tiling = 2.f);
 		module(module const&) = delete;
 		module(module&&) = delete;
-		~module();
+		~module() = default;
 
 		module& operator=(module const&) = delete;
 		module& operator=(module&&) = delete;
 
-		void prepare_draw(VkCommandBuffer cmd, uint32_t const img_idx,
-		                  cam::base const& cam, mat4 const& proj);
-		void draw(VkCommandBuffer cmd, uint32_t const img_idx, model const& cube,
-		          mc::vector<mat4> models);
+		void prepare_draw(cam::base const& cam, mat4 const& proj);
+		void draw(VkCommandBuffer cmd, model const& cube, mc::vector<part> const& parts);
 
-	private:
-		VkDescriptorSetLayout static_set_layout_ {nullptr};
-		VkDescriptorSetLayout dynamic_set_layout_ {nullptr};
-
-		VkDescriptorPool desc_pool_ {nullptr};
+		material& get_material();
 
-		VkDescriptorSet static_set_ {nullptr};
-		VkDescriptorSet dynamic_sets_[3] {nullptr};
-		buffer          staging_uniforms_[3];
-		buffer          uniforms_[3];
-
-		VkPipelineLayout pipe_layout_ {nullptr};
-		VkPipeline       pipe_ {nullptr};
+	private:
+		material          mat_;
+		material_instance params_;
 	};
 }
\ No newline at end of file
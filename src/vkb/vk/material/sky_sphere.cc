@@ -1,19 +1,50 @@
 #include "sky_sphere.hh"
 
 #include "../../cam/base.hh"
+#include "../../core/pack.hh"
 #include "../../log.hh"
 #include "../../math/mat4.hh"
 #include "../../math/math.hh"
 #include "../../sphere.hh"
 #include "../enum_string_helper.hh"
 #include "../instance.hh"
+#include "../material_layout.hh"
+#include "../staging_ring.hh"
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 namespace vkb::vk
 {
+	namespace
+	{
+		constexpr uint32_t star_count {1000};
+		// Stars the fragment shader loops over, specialized in the pipeline.
+		constexpr uint32_t lit_star_count {100};
+		static_assert(lit_star_count <= star_count);
+
+		bool find_constant(char const* reflect_path, char const* name, uint32_t& id)
+		{
+			pack::resource reflect;
+			layout         lay;
+			if (!pack::get().load(reflect_path, reflect) ||
+			    !lay.load(reflect.data, reflect.size))
+				return false;
+
+			for (uint32_t i {0}; i < lay.constant_count(); ++i)
+			{
+				reflection_format::constant const& cst = lay.get_constant(i);
+				if (strcmp(lay.get_name(cst.name), name) == 0)
+				{
+					id = cst.id;
+					return true;
+				}
+			}
+
+			return false;
+		}
+	}
+
 	sky_sphere::sky_sphere()
 	{
 		instance& inst = instance::get();
@@ -73,15 +104,9 @@ namespace vkb::vk
 			for (uint32_t i {0}; i < 3; ++i)
 			{
 				desc_sets_[i] = sets[i];
-				staging_uniforms_[i] =
-					inst.create_buffer(sizeof(mat4), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-				                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-				uniforms_[i] = inst.create_buffer(sizeof(mat4),
-				                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-				                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				uniforms_[i] = inst.create_buffer(
+					sizeof(mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+					mem_intent::dynamic_upload, mem_category::uniforms);
 
 				VkDescriptorBufferInfo buf_info {};
 				buf_info.buffer = uniforms_[i].buffer;
@@ -100,17 +125,11 @@ namespace vkb::vk
 			}
 
 			star_positions_set_ = sets[3];
-			constexpr uint32_t star_count = 1000;
-
-			buffer staging = inst.create_buffer(sizeof(star) * star_count,
-			                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-			                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 			star_positions_uniform_ = inst.create_buffer(
 				sizeof(star) * star_count,
 				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				mem_intent::gpu_static, mem_category::uniforms);
 
 			VkDescriptorBufferInfo buf_info {};
 			buf_info.buffer = star_positions_uniform_.buffer;
@@ -135,15 +154,15 @@ namespace vkb::vk
 				stars[i].intensity = math::rand() * 0.8 + 0.2;
 			}
 
-			void* buf_mem;
-			vmaMapMemory(inst.get_allocator(), staging.memory, &buf_mem);
-			memcpy(buf_mem, stars, sizeof(stars));
-			vmaUnmapMemory(inst.get_allocator(), staging.memory);
+			staging_ring&        ring = inst.get_staging_ring();
+			staging_ring::region staging = ring.reserve(sizeof(stars));
+			memcpy(staging.data, stars, sizeof(stars));
 
-			VkCommandBuffer cmd = inst.begin_commands();
+			VkCommandBuffer cmd = ring.begin_commands();
 
 			VkBufferCopy2 region {};
 			region.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
+			region.srcOffset = staging.offset;
 			region.size = sizeof(stars);
 			VkCopyBufferInfo2 copy {};
 			copy.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
@@ -153,9 +172,7 @@ namespace vkb::vk
 			copy.pRegions = &region;
 			vkCmdCopyBuffer2(cmd, &copy);
 
-			inst.end_commands(cmd);
-
-			inst.destroy_buffer(staging);
+			ring.submit(cmd);
 		}
 
 		// Pipeline
@@ -171,31 +188,8 @@ namespace vkb::vk
 			log::assert(res == VK_SUCCESS, "Failed to create pipeline layout (%s)",
 			            string_VkResult(res));
 
-			VkShaderModule shader;
-			uint32_t*      shader_buf {nullptr};
-			uint32_t       shader_size {0};
-			FILE*          shader_file {fopen("res/shaders/sky_sphere.spv", "rb")};
-
-			log::assert(shader_file, "Failed to open sky_sphere.spv");
-
-			fseek(shader_file, 0, SEEK_END);
-			shader_size = ftell(shader_file);
-
-			fseek(shader_file, 0, SEEK_SET);
-			shader_buf = new uint32_t[shader_size / 4];
-			fread(shader_buf, 1, shader_size, shader_file);
-			fclose(shader_file);
-
-			VkShaderModuleCreateInfo shader_create_info {};
-			shader_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-			shader_create_info.codeSize = shader_size;
-			shader_create_info.pCode = shader_buf;
-			res = vkCreateShaderModule(instance::get().get_device(), &shader_create_info,
-			                           nullptr, &shader);
-
-			delete[] shader_buf;
-			log::assert(res == VK_SUCCESS, "Failed to create shader module (%s)",
-			            string_VkResult(res));
+			VkShaderModule shader = inst.create_shader("res/shaders/sky_sphere.spv");
+			log::assert(shader, "Failed to create sky_sphere shader");
 
 			VkPipelineShaderStageCreateInfo stages_info[2] {};
 			memset(stages_info, 0, sizeof(stages_info));
@@ -210,6 +204,23 @@ namespace vkb::vk
 			stages_info[1].pName = "f_main";
 			stages_info[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+			// lit_star_count, with its id from the reflection of the shader. Left to
+			// its default in the shader if it can't be found.
+			VkSpecializationMapEntry spec_entry {};
+			spec_entry.offset = 0;
+			spec_entry.size = sizeof(uint32_t);
+
+			VkSpecializationInfo spec_info {};
+			spec_info.mapEntryCount = 1;
+			spec_info.pMapEntries = &spec_entry;
+			spec_info.dataSize = sizeof(uint32_t);
+			spec_info.pData = &lit_star_count;
+			if (find_constant("res/shaders/sky_sphere.spv.refl", "lit_star_count",
+			                  spec_entry.constantID))
+				stages_info[1].pSpecializationInfo = &spec_info;
+			else
+				log::warn("No lit_star_count constant in the sky_sphere shader");
+
 			VkVertexInputBindingDescription input_binding {};
 			input_binding.binding = 0;
 			input_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
@@ -307,12 +318,12 @@ namespace vkb::vk
 			// TODO use global hardcoded formats
 			VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
 			rendering_info.pColorAttachmentFormats = &format;
-			rendering_info.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+			rendering_info.depthAttachmentFormat = instance::get().get_depth_format();
 
 			create_info.pNext = &rendering_info;
 
-			res = vkCreateGraphicsPipelines(inst.get_device(), nullptr, 1, &create_info,
-			                                nullptr, &pipe_);
+			res = vkCreateGraphicsPipelines(inst.get_device(), inst.get_pipeline_cache(),
+			                                1, &create_info, nullptr, &pipe_);
 			log::assert(res == VK_SUCCESS, "Failed to create graphics pipeline (%s)",
 			            string_VkResult(res));
 
@@ -321,56 +332,44 @@ namespace vkb::vk
 
 		// Model
 		{
-			buffer vertices_staging = inst.create_buffer(
-				sizeof(sphere_vertices), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-					VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			buffer indices_staging = inst.create_buffer(
-				sizeof(sphere_indices), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-					VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			void* buf_mem;
-			vmaMapMemory(inst.get_allocator(), vertices_staging.memory, &buf_mem);
-			memcpy(buf_mem, &sphere_vertices, sizeof(sphere_vertices));
-			vmaUnmapMemory(inst.get_allocator(), vertices_staging.memory);
-
-			vmaMapMemory(inst.get_allocator(), indices_staging.memory, &buf_mem);
-			memcpy(buf_mem, &sphere_indices, sizeof(sphere_indices));
-			vmaUnmapMemory(inst.get_allocator(), indices_staging.memory);
+			staging_ring&        ring = inst.get_staging_ring();
+			staging_ring::region staging =
+				ring.reserve(sizeof(sphere_vertices) + sizeof(sphere_indices));
+			memcpy(staging.data, &sphere_vertices, sizeof(sphere_vertices));
+			memcpy(staging.data + sizeof(sphere_vertices), &sphere_indices,
+			       sizeof(sphere_indices));
 
 			vertices_ = inst.create_buffer(sizeof(sphere_vertices),
 			                               VK_BUFFER_USAGE_TRANSFER_DST_BIT |
 			                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-			                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			                               mem_intent::gpu_static,
+			                               mem_category::geometry);
 
 			indices_ = inst.create_buffer(sizeof(sphere_indices),
 			                              VK_BUFFER_USAGE_TRANSFER_DST_BIT |
 			                                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			                              mem_intent::gpu_static, mem_category::geometry);
 
-			VkCommandBuffer cmd = inst.begin_commands();
+			VkCommandBuffer cmd = ring.begin_commands();
 
 			VkBufferCopy2 region {};
 			region.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
+			region.srcOffset = staging.offset;
 			region.size = sizeof(sphere_vertices);
 			VkCopyBufferInfo2 copy {};
 			copy.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
-			copy.srcBuffer = vertices_staging.buffer;
+			copy.srcBuffer = staging.buffer;
 			copy.dstBuffer = vertices_.buffer;
 			copy.regionCount = 1;
 			copy.pRegions = &region;
 			vkCmdCopyBuffer2(cmd, &copy);
 
+			region.srcOffset = staging.offset + sizeof(sphere_vertices);
 			region.size = sizeof(sphere_indices);
-			copy.srcBuffer = indices_staging.buffer;
 			copy.dstBuffer = indices_.buffer;
 			vkCmdCopyBuffer2(cmd, &copy);
 
-			inst.end_commands(cmd);
-
-			inst.destroy_buffer(vertices_staging);
-			inst.destroy_buffer(indices_staging);
+			ring.submit(cmd);
 		}
 	}
 
@@ -388,7 +387,6 @@ namespace vkb::vk
 
 		for (uint32_t i {0}; i < 3; ++i)
 		{
-			inst.destroy_buffer(staging_uniforms_[i]);
 			inst.destroy_buffer(uniforms_[i]);
 		}
 
@@ -397,47 +395,22 @@ namespace vkb::vk
 		vkDestroyDescriptorSetLayout(inst.get_device(), desc_set_layout_, nullptr);
 	}
 
-	void sky_sphere::prepare_draw(VkCommandBuffer cmd, uint32_t const img_idx,
-	                              cam::base const& cam, mat4 const& proj)
+	void sky_sphere::prepare_draw(uint32_t const frame_idx, cam::base const& cam,
+	                              mat4 const& proj)
 	{
-		instance& inst = instance::get();
-		mat4      transform = cam.rot_mat() * proj;
-
-		void* buf_mem;
-		vmaMapMemory(inst.get_allocator(), staging_uniforms_[img_idx].memory, &buf_mem);
-		memcpy(buf_mem, &transform, sizeof(mat4));
-		vmaUnmapMemory(inst.get_allocator(), staging_uniforms_[img_idx].memory);
-
-		VkBufferCopy2 region {};
-		region.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2;
-		region.size = sizeof(mat4);
-		VkCopyBufferInfo2 copy {};
-		copy.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2;
-		copy.srcBuffer = staging_uniforms_[img_idx].buffer;
-		copy.dstBuffer = uniforms_[img_idx].buffer;
-		copy.regionCount = 1;
-		copy.pRegions = &region;
-		vkCmdCopyBuffer2(cmd, &copy);
-
-		VkBufferMemoryBarrier barrier {};
-		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-		barrier.buffer = uniforms_[img_idx].buffer;
-		barrier.size = sizeof(mat4);
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
-		                     VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 1,
-		                     &barrier, 0, nullptr);
+		// Mapped, and made visible to the device by the frame submission.
+		mat4 transform = cam.rot_mat() * proj;
+		memcpy(uniforms_[frame_idx].data, &transform, sizeof(mat4));
 	}
 
-	void sky_sphere::draw(VkCommandBuffer cmd, uint32_t const img_idx)
+	void sky_sphere::draw(VkCommandBuffer cmd, uint32_t const frame_idx)
 	{
 		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe_);
 		VkDeviceSize offset {0};
 		vkCmdBindVertexBuffers(cmd, 0, 1, &vertices_.buffer, &offset);
 		vkCmdBindIndexBuffer(cmd, indices_.buffer, 0, VK_INDEX_TYPE_UINT16);
 
-		VkDescriptorSet sets[2] {desc_sets_[img_idx], star_positions_set_};
+		VkDescriptorSet sets[2] {desc_sets_[frame_idx], star_positions_set_};
 
 		VkBindDescriptorSetsInfo set_info {};
 		set_info.sType = VK_STRUCTURE_TYPE_BIND_DESCRIPTOR_SETS_INFO;
@@ -29,9 +29,9 @@ namespace vkb::vk
 		sky_sphere& operator=(sky_sphere const&) = delete;
 		sky_sphere& operator=(sky_sphere&&) = delete;
 
-		void prepare_draw(VkCommandBuffer cmd, uint32_t const img_idx,
-		                  cam::base const& cam, mat4 const& proj);
-		void draw(VkCommandBuffer cmd, uint32_t const img_idx);
+		void prepare_draw(uint32_t const frame_idx, cam::base const& cam,
+		                  mat4 const& proj);
+		void draw(VkCommandBuffer cmd, uint32_t const frame_idx);
 
 	private:
 		struct alignas(16) star
@@ -44,7 +44,6 @@ namespace vkb::vk
 
 		VkDescriptorPool desc_pool_ {nullptr};
 		VkDescriptorSet  desc_sets_[3] {nullptr};
-		buffer           staging_uniforms_[3];
 		buffer           uniforms_[3];
 
 		VkDescriptorSetLayout star_positions_layout_ {nullptr};
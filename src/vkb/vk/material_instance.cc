@@ -0,0 +1,258 @@
+#include "material_instance.hh"
+
+#include "../log.hh"
+#include "descriptor_allocator.hh"
+#include "instance.hh"
+#include "material.hh"
+#include "uniform_arena.hh"
+
+#include <string.h>
+
+namespace vkb::vk
+{
+	namespace
+	{
+		constexpr uint32_t max_sets {8};
+	}
+
+	material_instance::material_instance(material& mat)
+	: mat_ {mat}
+	{
+		instance&     inst = instance::get();
+		layout const& lay = mat_.get_layout();
+
+		log::assert(mat_.descriptor_set_count() <= max_sets, "Too many sets in %s",
+		            mat_.get_path().data());
+
+		sets_.resize(mat_.descriptor_set_count());
+		uint32_t uniform_size {0};
+		for (uint32_t i {0}; i < sets_.size(); ++i)
+		{
+			reflection_format::set const& refl_set = lay.get_set(i);
+			set_data&                     data = sets_[i];
+			data.uniform_off = uniform_size;
+			data.uniform_size = refl_set.uniform_size;
+			uniform_size += refl_set.uniform_size;
+
+			data.set = inst.get_descriptor_allocator().allocate(
+				mat_.get_descriptor_set_layout(i));
+			if (!data.set)
+			{
+				log::error("Failed to allocate descriptor sets of %s",
+				           mat_.get_path().data());
+				continue;
+			}
+
+			if (!data.uniform_size)
+				continue;
+
+			// The offset in the arena is given when binding.
+			VkDescriptorBufferInfo buf_info {};
+			buf_info.buffer = inst.get_uniform_arena().get_buffer();
+			buf_info.offset = 0;
+			buf_info.range = data.uniform_size;
+
+			VkWriteDescriptorSet write {};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = data.set;
+			write.dstBinding = lay.get_binding(refl_set.first_binding).binding;
+			write.dstArrayElement = 0;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			write.descriptorCount = 1;
+			write.pBufferInfo = &buf_info;
+			vkUpdateDescriptorSets(inst.get_device(), 1, &write, 0, nullptr);
+		}
+
+		uniforms_.resize(uniform_size);
+		memset(uniforms_.data(), 0, uniform_size);
+	}
+
+	material_instance::~material_instance()
+	{
+		instance& inst = instance::get();
+
+		for (uint32_t i {0}; i < sets_.size(); ++i)
+		{
+			if (sets_[i].set)
+				inst.get_descriptor_allocator().free(mat_.get_descriptor_set_layout(i),
+				                                     sets_[i].set);
+		}
+	}
+
+	material& material_instance::get_material()
+	{
+		return mat_;
+	}
+
+	bool material_instance::set(mc::string_view name, float value)
+	{
+		return set(name, reflection_format::scalar_type::float32, &value, sizeof(value));
+	}
+
+	bool material_instance::set(mc::string_view name, int32_t value)
+	{
+		return set(name, reflection_format::scalar_type::int32, &value, sizeof(value));
+	}
+
+	bool material_instance::set(mc::string_view name, uint32_t value)
+	{
+		return set(name, reflection_format::scalar_type::uint32, &value, sizeof(value));
+	}
+
+	bool material_instance::set(mc::string_view name, vec2 const& value)
+	{
+		return set(name, reflection_format::scalar_type::float32, &value, sizeof(vec2));
+	}
+
+	bool material_instance::set(mc::string_view name, vec4 const& value)
+	{
+		return set(name, reflection_format::scalar_type::float32, &value, sizeof(vec4));
+	}
+
+	bool material_instance::set(mc::string_view name, mat4 const& value)
+	{
+		return set(name, reflection_format::scalar_type::float32, &value, sizeof(mat4));
+	}
+
+	bool material_instance::set(mc::string_view name, reflection_format::scalar_type type,
+	                            void const* data, uint32_t size)
+	{
+		layout const& lay = mat_.get_layout();
+
+		for (uint32_t i {0}; i < sets_.size(); ++i)
+		{
+			reflection_format::set const& refl_set = lay.get_set(i);
+			for (uint32_t j {0}; j < refl_set.member_cnt; ++j)
+			{
+				reflection_format::member const& member =
+					lay.get_member(refl_set.first_member + j);
+				if (name == lay.get_name(member.name))
+				{
+					if (member.type != type || member.size != size)
+					{
+						log::error("Invalid type for uniform %s", name.data());
+						return false;
+					}
+
+					memcpy(uniforms_.data() + sets_[i].uniform_off + member.offset, data,
+					       size);
+					return true;
+				}
+			}
+		}
+
+		log::error("Unknown uniform %s in %s", name.data(), mat_.get_path().data());
+		return false;
+	}
+
+	bool material_instance::set_image(mc::string_view name, VkImageView view,
+	                                  VkImageLayout layout)
+	{
+		VkDescriptorImageInfo img_info {};
+		img_info.imageLayout = layout;
+		img_info.imageView = view;
+		return write_image(name, img_info, false);
+	}
+
+	bool material_instance::set_sampler(mc::string_view name, VkSampler sampler)
+	{
+		VkDescriptorImageInfo img_info {};
+		img_info.sampler = sampler;
+		return write_image(name, img_info, true);
+	}
+
+	bool material_instance::write_image(mc::string_view              name,
+	                                    VkDescriptorImageInfo const& info, bool sampler)
+	{
+		layout const& lay = mat_.get_layout();
+
+		for (uint32_t i {0}; i < sets_.size(); ++i)
+		{
+			reflection_format::set const& refl_set = lay.get_set(i);
+			for (uint32_t j {0}; j < refl_set.binding_cnt; ++j)
+			{
+				reflection_format::binding const& binding =
+					lay.get_binding(refl_set.first_binding + j);
+				if (!(name == lay.get_name(binding.name)))
+					continue;
+
+				// Combined image samplers would need both at once.
+				VkDescriptorType type = material::descriptor_type(lay, i, j);
+				bool             is_sampler = type == VK_DESCRIPTOR_TYPE_SAMPLER;
+				bool             is_image = type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+				                            type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				if (sampler ? !is_sampler : !is_image)
+					continue;
+
+				// Baked in the set layout, it can't be written.
+				if (sampler && mat_.has_immutable_sampler(i, j))
+					return true;
+
+				if (!sets_[i].set)
+					return false;
+
+				VkWriteDescriptorSet write {};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = sets_[i].set;
+				write.dstBinding = binding.binding;
+				write.dstArrayElement = 0;
+				write.descriptorType = type;
+				write.descriptorCount = 1;
+				write.pImageInfo = &info;
+				vkUpdateDescriptorSets(instance::get().get_device(), 1, &write, 0,
+				                       nullptr);
+				return true;
+			}
+		}
+
+		log::error("Unknown %s %s in %s", sampler ? "sampler" : "image", name.data(),
+		           mat_.get_path().data());
+		return false;
+	}
+
+	bool material_instance::bind(VkCommandBuffer cmd)
+	{
+		return mat_.bind(cmd) && bind_sets(cmd);
+	}
+
+	bool material_instance::bind_sets(VkCommandBuffer cmd)
+	{
+		uniform_arena& arena = instance::get().get_uniform_arena();
+
+		VkDescriptorSet sets[max_sets];
+		uint32_t        offsets[max_sets];
+		uint32_t        offset_cnt {0};
+		for (uint32_t i {0}; i < sets_.size(); ++i)
+		{
+			set_data const& data = sets_[i];
+			if (!data.set)
+			{
+				log::error("Set %u of %s isn't allocated", i, mat_.get_path().data());
+				return false;
+			}
+
+			sets[i] = data.set;
+			if (!data.uniform_size)
+				continue;
+
+			void*    mem;
+			uint32_t off = arena.alloc(data.uniform_size, mem);
+			if (off == UINT32_MAX)
+			{
+				log::error("Uniform arena full, can't bind %s", mat_.get_path().data());
+				return false;
+			}
+
+			memcpy(mem, uniforms_.data() + data.uniform_off, data.uniform_size);
+			offsets[offset_cnt++] = off;
+		}
+
+		if (sets_.empty())
+			return true;
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+		                        mat_.get_pipeline_layout(), 0, sets_.size(), sets,
+		                        offset_cnt, offsets);
+		return true;
+	}
+}
\ No newline at end of file
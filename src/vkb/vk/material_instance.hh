@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../math/mat4.hh"
+#include "../math/vec2.hh"
+#include "../math/vec4.hh"
+#include "reflection_format.hh"
+
+#include <string_view.hh>
+#include <vector.hh>
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	class material;
+
+	// Parameters of a material: one descriptor set per set of the material, allocated
+	// from the descriptor allocator. Uniform members are kept on the CPU, and copied to
+	// the uniform arena each time the sets are bound, so they can change every frame
+	// without touching the sets. Images and samplers are written in the sets, and
+	// must not change while a frame in flight uses them.
+	class material_instance
+	{
+	public:
+		// The material must have created its pipeline state.
+		material_instance(material& mat);
+		material_instance(material_instance const&) = delete;
+		material_instance(material_instance&&) = delete;
+		~material_instance();
+
+		material_instance& operator=(material_instance const&) = delete;
+		material_instance& operator=(material_instance&&) = delete;
+
+		material& get_material();
+
+		// Sets a uniform member by its path from its set ("cam.view"). Returns false
+		// if the material has no member with this name, type and size.
+		bool set(mc::string_view name, float value);
+		bool set(mc::string_view name, int32_t value);
+		bool set(mc::string_view name, uint32_t value);
+		bool set(mc::string_view name, vec2 const& value);
+		bool set(mc::string_view name, vec4 const& value);
+		bool set(mc::string_view name, mat4 const& value);
+
+		// Sets an image or sampler binding by its path from its set.
+		bool set_image(mc::string_view name, VkImageView view,
+		               VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		bool set_sampler(mc::string_view name, VkSampler sampler);
+
+		// Binds the material, then the sets of the instance. Returns false if
+		// something couldn't be bound, in which case nothing must be drawn.
+		bool bind(VkCommandBuffer cmd);
+		// Binds the sets only, to draw several instances of the bound material.
+		bool bind_sets(VkCommandBuffer cmd);
+
+	private:
+		struct set_data
+		{
+			VkDescriptorSet set {nullptr};
+			// Uniform block in uniforms_.
+			uint32_t uniform_off {0};
+			uint32_t uniform_size {0};
+		};
+
+		bool set(mc::string_view name, reflection_format::scalar_type type,
+		         void const* data, uint32_t size);
+		bool write_image(mc::string_view name, VkDescriptorImageInfo const& info,
+		                 bool sampler);
+
+		material& mat_;
+
+		mc::vector<set_data> sets_;
+		mc::vector<uint8_t>  uniforms_;
+	};
+}
\ No newline at end of file
@@ -1,115 +1,121 @@
 #include "material_layout.hh"
 
-#include <alloc.hh>
-#include <string.h>
+#include "../log.hh"
 
 namespace vkb::vk
 {
-	mc::string_view shader_stage_names[mc::to_underlying(shader_stage::count)] {
-		"vertex",
-		"fragment",
-	};
-
-	property_layout::property_layout(enum type t)
-	: type {t}
+	namespace
 	{
-		switch (type)
+		bool valid_table(reflection_format::table const& table, uint64_t elem_size,
+		                 uint64_t size)
 		{
-			case type::simple: memset(&simple, 0, sizeof(simple)); break;
-			case type::resource: memset(&resource, 0, sizeof(resource)); break;
-			case type::sampler: memset(&sampler, 0, sizeof(sampler)); break;
-			case type::object:
-			{
-				new (&object) decltype(object)();
-				break;
-			}
+			return table.off + table.cnt * elem_size <= size;
 		}
 	}
 
-	property_layout::property_layout(property_layout&& prop)
-	: type {prop.type}
+	bool layout::load(uint8_t const* data, uint64_t size)
 	{
-		switch (type)
+		reflection_format::header const* header =
+			reinterpret_cast<reflection_format::header const*>(data);
+		if (size < sizeof(reflection_format::header) ||
+		    header->magic != reflection_format::magic ||
+		    header->version != reflection_format::version)
+		{
+			log::error("Invalid shader reflection header");
+			return false;
+		}
+
+		if (!valid_table(header->strings, 1, size) ||
+		    !valid_table(header->sets, sizeof(reflection_format::set), size) ||
+		    !valid_table(header->bindings, sizeof(reflection_format::binding), size) ||
+		    !valid_table(header->members, sizeof(reflection_format::member), size) ||
+		    !valid_table(header->push_ranges, sizeof(reflection_format::push_range),
+		                 size) ||
+		    !valid_table(header->entry_points, sizeof(reflection_format::entry_point),
+		                 size) ||
+		    !valid_table(header->vertex_inputs, sizeof(reflection_format::vertex_input),
+		                 size) ||
+		    !valid_table(header->constants, sizeof(reflection_format::constant), size))
 		{
-			case type::simple:
-			{
-				simple = prop.simple;
-				break;
-			}
-			case type::resource:
-			{
-				resource = prop.resource;
-				break;
-			}
-			case type::sampler:
-			{
-				sampler = prop.sampler;
-				break;
-			}
-			case type::object:
-			{
-				new (&object) decltype(object)();
-				object.props =
-					static_cast<mc::vector<property_layout>&&>(prop.object.props);
-				break;
-			}
+			log::error("Truncated shader reflection");
+			return false;
 		}
+
+		data_ = data;
+		header_ = header;
+		return true;
 	}
 
-	property_layout::~property_layout() noexcept
+	uint32_t layout::set_count() const
 	{
-		switch (type)
-		{
-			case type::object:
-			{
-				object.props.~vector<property_layout>();
-				break;
-			}
+		return header_ ? header_->sets.cnt : 0;
+	}
 
-			default: break;
-		}
+	reflection_format::set const& layout::get_set(uint32_t idx) const
+	{
+		return get<reflection_format::set>(header_->sets, idx);
 	}
 
-	property_layout& property_layout::operator=(property_layout&& prop)
+	reflection_format::binding const& layout::get_binding(uint32_t idx) const
 	{
-		switch (type)
-		{
-			case type::object:
-			{
-				object.props.~vector<property_layout>();
-				break;
-			}
+		return get<reflection_format::binding>(header_->bindings, idx);
+	}
 
-			default: break;
-		}
+	reflection_format::member const& layout::get_member(uint32_t idx) const
+	{
+		return get<reflection_format::member>(header_->members, idx);
+	}
+
+	uint32_t layout::push_range_count() const
+	{
+		return header_ ? header_->push_ranges.cnt : 0;
+	}
 
-		type = prop.type;
+	reflection_format::push_range const& layout::get_push_range(uint32_t idx) const
+	{
+		return get<reflection_format::push_range>(header_->push_ranges, idx);
+	}
 
-		switch (type)
-		{
-			case type::simple:
-			{
-				simple = prop.simple;
-				break;
-			}
-			case type::resource:
-			{
-				resource = prop.resource;
-				break;
-			}
-			case type::sampler:
-			{
-				sampler = prop.sampler;
-				break;
-			}
-			case type::object:
-			{
-				object.props =
-					static_cast<mc::vector<property_layout>&&>(prop.object.props);
-				break;
-			}
-		}
+	uint32_t layout::entry_point_count() const
+	{
+		return header_ ? header_->entry_points.cnt : 0;
+	}
+
+	reflection_format::entry_point const& layout::get_entry_point(uint32_t idx) const
+	{
+		return get<reflection_format::entry_point>(header_->entry_points, idx);
+	}
+
+	uint32_t layout::vertex_input_count() const
+	{
+		return header_ ? header_->vertex_inputs.cnt : 0;
+	}
+
+	reflection_format::vertex_input const& layout::get_vertex_input(uint32_t idx) const
+	{
+		return get<reflection_format::vertex_input>(header_->vertex_inputs, idx);
+	}
 
-		return *this;
+	uint32_t layout::constant_count() const
+	{
+		return header_ ? header_->constants.cnt : 0;
+	}
+
+	reflection_format::constant const& layout::get_constant(uint32_t idx) const
+	{
+		return get<reflection_format::constant>(header_->constants, idx);
+	}
+
+	char const* layout::get_name(uint32_t name) const
+	{
+		log::assert(name < header_->strings.cnt, "Invalid reflection name");
+		return reinterpret_cast<char const*>(data_ + header_->strings.off + name);
+	}
+
+	template <typename T>
+	T const& layout::get(reflection_format::table const& table, uint32_t idx) const
+	{
+		log::assert(idx < table.cnt, "Reflection index out of range");
+		return reinterpret_cast<T const*>(data_ + table.off)[idx];
 	}
 }
\ No newline at end of file
@@ -1,108 +1,45 @@
 #pragma once
 
-#include <enum.hh>
-#include <string.hh>
-#include <string_view.hh>
-#include <vector.hh>
+#include "reflection_format.hh"
+
+#include <stdint.h>
 
 namespace vkb::vk
 {
-	enum class shader_stage
+	// View over a reflection blob written by slangrc. Nothing is copied: the blob must
+	// outlive the layout.
+	class layout
 	{
-		vertex,
-		fragment,
-
-		count
-	};
+	public:
+		bool load(uint8_t const* data, uint64_t size);
 
-	extern mc::string_view shader_stage_names[mc::to_underlying(shader_stage::count)];
-
-	struct property_layout
-	{
-		enum class type
-		{
-			simple,
-			resource,
-			sampler,
-			object
-		};
+		uint32_t                      set_count() const;
+		reflection_format::set const& get_set(uint32_t idx) const;
 
-		enum class simple_type
-		{
-			float1,
-			float2,
-			float4,
-			float44,
-		};
+		// Indices from reflection_format::set::first_binding.
+		reflection_format::binding const& get_binding(uint32_t idx) const;
+		// Indices from reflection_format::set::first_member.
+		reflection_format::member const& get_member(uint32_t idx) const;
 
-		enum class resource_type
-		{
-			texture2D
-		};
-		enum class resource_format
-		{
-			float4
-		};
+		uint32_t                             push_range_count() const;
+		reflection_format::push_range const& get_push_range(uint32_t idx) const;
 
-		property_layout(enum type t);
-		property_layout(property_layout const&) = delete;
-		property_layout(property_layout&&);
-		~property_layout() noexcept;
+		uint32_t                              entry_point_count() const;
+		reflection_format::entry_point const& get_entry_point(uint32_t idx) const;
 
-		property_layout& operator=(property_layout const&) = delete;
-		property_layout& operator=(property_layout&&);
+		uint32_t                               vertex_input_count() const;
+		reflection_format::vertex_input const& get_vertex_input(uint32_t idx) const;
 
-		union
-		{
-			struct
-			{
-				simple_type type;
-			} simple;
+		uint32_t                           constant_count() const;
+		reflection_format::constant const& get_constant(uint32_t idx) const;
 
-			struct
-			{
-				resource_type   type;
-				resource_format format;
-				uint32_t        binding;
-			} resource;
+		char const* get_name(uint32_t name) const;
 
-			struct
-			{
-				uint32_t binding;
-			} sampler;
+	private:
+		template <typename T>
+		T const& get(reflection_format::table const& table, uint32_t idx) const;
 
-			struct
-			{
-				mc::vector<property_layout> props;
-			} object;
-		};
-
-		mc::string name;
-		type       type;
-	};
-
-	struct set_layout
-	{
-		property_layout obj {property_layout::type::object};
-
-		uint32_t uniform_off {0};
-		uint32_t uniform_size {0};
-
-		uint32_t binding_off {0};
-	};
-
-	struct entry_point_layout
-	{
-		mc::string                  name;
-		shader_stage                stage {shader_stage::count};
-		property_layout*            param_in {nullptr};
-		property_layout*            param_out {nullptr};
-		mc::vector<property_layout> push_constants;
-	};
-
-	struct layout
-	{
-		mc::vector<set_layout>         sets;
-		mc::vector<entry_point_layout> entry_points;
+		uint8_t const*                   data_ {nullptr};
+		reflection_format::header const* header_ {nullptr};
 	};
 }
\ No newline at end of file
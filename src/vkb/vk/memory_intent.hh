@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// How a resource is accessed, which decides where its memory is placed.
+	enum class mem_intent : uint8_t
+	{
+		// Written once through a transfer, then only read by the device.
+		gpu_static,
+		// Written by the host, possibly every frame. Mapped for its whole lifetime.
+		// Buffers read by shaders are placed in device local memory when the host can
+		// write it directly (UMA or resizable BAR), so they need no staging copy.
+		dynamic_upload,
+		// Written by the device and read back by the host. Mapped.
+		readback,
+		// Attachment only used during a render pass. Lazily allocated when the device
+		// supports it and the image has VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT.
+		transient_attachment,
+	};
+}
\ No newline at end of file
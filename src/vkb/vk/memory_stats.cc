@@ -0,0 +1,164 @@
+#include "memory_stats.hh"
+
+#include "../log.hh"
+
+namespace vkb::vk
+{
+	namespace
+	{
+		constexpr char const* category_names[] {
+			"geometry", "textures", "uniforms", "attachments", "staging", "other",
+		};
+		static_assert(sizeof(category_names) / sizeof(*category_names) ==
+		              static_cast<uint8_t>(mem_category::count));
+
+		void add(memory_stats::usage& u, uint64_t size)
+		{
+			u.bytes += size;
+			++u.allocs;
+			if (u.bytes > u.peak)
+				u.peak = u.bytes;
+		}
+
+		void sub(memory_stats::usage& u, uint64_t size)
+		{
+			u.bytes -= size;
+			--u.allocs;
+		}
+
+		float to_mib(uint64_t bytes)
+		{
+			return static_cast<float>(bytes) / (1024.f * 1024.f);
+		}
+	}
+
+	char const* mem_category_name(mem_category cat)
+	{
+		return category_names[static_cast<uint8_t>(cat)];
+	}
+
+	memory_stats::memory_stats(VmaAllocator allocator, bool has_budget_ext)
+	: allocator_ {allocator}
+	, has_budget_ext_ {has_budget_ext}
+	{
+		VkPhysicalDeviceMemoryProperties const* mem_props;
+		vmaGetMemoryProperties(allocator_, &mem_props);
+
+		heap_cnt_ = mem_props->memoryHeapCount;
+		for (uint32_t i {0}; i < heap_cnt_; ++i)
+			heaps_[i].device_local =
+				mem_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+		update();
+	}
+
+	void memory_stats::on_alloc(VmaAllocation alloc, mem_category cat)
+	{
+		// Offset by one, allocations made outside of the instance have no user data.
+		vmaSetAllocationUserData(
+			allocator_, alloc, reinterpret_cast<void*>(static_cast<uintptr_t>(cat) + 1));
+		vmaSetAllocationName(allocator_, alloc, mem_category_name(cat));
+
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(allocator_, alloc, &info);
+
+		add(usages_[static_cast<uint8_t>(cat)], info.size);
+		add(total_, info.size);
+	}
+
+	void memory_stats::on_free(VmaAllocation alloc)
+	{
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(allocator_, alloc, &info);
+
+		uintptr_t tag = reinterpret_cast<uintptr_t>(info.pUserData);
+		if (!tag)
+			return;
+
+		sub(usages_[tag - 1], info.size);
+		sub(total_, info.size);
+	}
+
+	void memory_stats::update()
+	{
+		// VMA refreshes its budget from the driver when the frame index changes.
+		vmaSetCurrentFrameIndex(allocator_, ++frame_);
+
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetHeapBudgets(allocator_, budgets);
+
+		for (uint32_t i {0}; i < heap_cnt_; ++i)
+		{
+			heap& h = heaps_[i];
+			h.usage = budgets[i].usage;
+			h.budget = budgets[i].budget;
+			if (h.usage > h.peak)
+				h.peak = h.usage;
+
+			bool over = h.usage > static_cast<uint64_t>(h.budget * threshold_);
+			if (over && !h.over)
+				hook_(i, h, hook_ud_);
+			h.over = over;
+		}
+	}
+
+	memory_stats::usage const& memory_stats::get_usage(mem_category cat) const
+	{
+		return usages_[static_cast<uint8_t>(cat)];
+	}
+
+	memory_stats::usage const& memory_stats::get_total() const
+	{
+		return total_;
+	}
+
+	uint32_t memory_stats::heap_count() const
+	{
+		return heap_cnt_;
+	}
+
+	memory_stats::heap const& memory_stats::get_heap(uint32_t idx) const
+	{
+		return heaps_[idx];
+	}
+
+	bool memory_stats::has_budget_ext() const
+	{
+		return has_budget_ext_;
+	}
+
+	void memory_stats::set_warn_hook(warn_hook hook, void* ud, float threshold)
+	{
+		hook_ = hook ? hook : log_warn;
+		hook_ud_ = ud;
+		threshold_ = threshold;
+	}
+
+	void memory_stats::log_report() const
+	{
+		log::info("Device memory%s:", has_budget_ext_ ? "" : " (estimated budget)");
+		for (uint8_t i {0}; i < static_cast<uint8_t>(mem_category::count); ++i)
+		{
+			usage const& u = usages_[i];
+			log::info("  %-12s %8.1f MiB, peak %8.1f MiB", category_names[i],
+			          to_mib(u.bytes), to_mib(u.peak));
+		}
+		log::info("  %-12s %8.1f MiB, peak %8.1f MiB", "total", to_mib(total_.bytes),
+		          to_mib(total_.peak));
+
+		for (uint32_t i {0}; i < heap_cnt_; ++i)
+		{
+			heap const& h = heaps_[i];
+			log::info("  heap %u (%s): peak %.1f / %.1f MiB", i,
+			          h.device_local ? "device" : "host", to_mib(h.peak),
+			          to_mib(h.budget));
+		}
+	}
+
+	void memory_stats::log_warn(uint32_t heap_idx, heap const& h, void*)
+	{
+		log::warn("Memory heap %u (%s) over budget threshold: %.1f / %.1f MiB", heap_idx,
+		          h.device_local ? "device" : "host", to_mib(h.usage),
+		          to_mib(h.budget));
+	}
+}
\ No newline at end of file
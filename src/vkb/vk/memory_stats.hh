@@ -0,0 +1,98 @@
+#pragma once
+
+#include "vma/vma.hh"
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// What a device allocation is used for. Kept in the user data of the allocation,
+	// so it is known again when freed.
+	enum class mem_category : uint8_t
+	{
+		geometry,
+		textures,
+		uniforms,
+		attachments,
+		staging,
+		other,
+		count
+	};
+
+	char const* mem_category_name(mem_category cat);
+
+	// Bytes allocated by category, and usage of the memory heaps against the budget
+	// given by VK_EXT_memory_budget (or estimated by VMA without it). Allocations must
+	// be created and freed from the main thread.
+	class memory_stats
+	{
+	public:
+		struct usage
+		{
+			uint64_t bytes {0};
+			uint64_t peak {0};
+			uint32_t allocs {0};
+		};
+
+		struct heap
+		{
+			uint64_t usage {0};
+			uint64_t budget {0};
+			uint64_t peak {0};
+			bool     device_local {false};
+			// Set while usage is above the warning threshold, so the hook is only
+			// called when crossing it.
+			bool over {false};
+		};
+
+		// Called when the usage of a heap crosses threshold * budget.
+		using warn_hook = void (*)(uint32_t heap_idx, heap const& h, void* ud);
+
+		memory_stats(VmaAllocator allocator, bool has_budget_ext);
+		memory_stats(memory_stats const&) = delete;
+		memory_stats(memory_stats&&) = delete;
+		~memory_stats() = default;
+
+		memory_stats& operator=(memory_stats const&) = delete;
+		memory_stats& operator=(memory_stats&&) = delete;
+
+		// Tags a new allocation, and names it after its category.
+		void on_alloc(VmaAllocation alloc, mem_category cat);
+		void on_free(VmaAllocation alloc);
+
+		// Queries the heap budgets, once per frame.
+		void update();
+
+		usage const& get_usage(mem_category cat) const;
+		// Sum of all the categories.
+		usage const& get_total() const;
+
+		uint32_t    heap_count() const;
+		heap const& get_heap(uint32_t idx) const;
+		bool        has_budget_ext() const;
+
+		// Replaces the default hook, which logs a warning. threshold is a fraction of
+		// the budget.
+		void set_warn_hook(warn_hook hook, void* ud, float threshold = 0.9f);
+
+		// Logs the totals and high-water marks.
+		void log_report() const;
+
+	private:
+		static void log_warn(uint32_t heap_idx, heap const& h, void* ud);
+
+		VmaAllocator allocator_ {nullptr};
+		bool         has_budget_ext_ {false};
+
+		usage    usages_[static_cast<uint8_t>(mem_category::count)];
+		usage    total_;
+		heap     heaps_[VK_MAX_MEMORY_HEAPS];
+		uint32_t heap_cnt_ {0};
+		uint32_t frame_ {0};
+
+		warn_hook hook_ {log_warn};
+		void*     hook_ud_ {nullptr};
+		float     threshold_ {0.9f};
+	};
+}
\ No newline at end of file
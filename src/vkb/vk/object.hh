@@ -8,6 +8,7 @@
 
 #include "assets/model.hh"
 #include "assets/texture.hh"
+#include "material.hh"
 
 namespace vkb::vk
 {
@@ -22,10 +23,11 @@ namespace vkb::vk
 		double rot {0.0};
 		float  rot_speed {1.0f};
 
-		VkDescriptorSet desc_sets_[3] {nullptr};
-
-		model*   model;
-		texture* tex;
+		model_handle    model;
+		texture_handle  tex;
+		// The material of the context if not set.
+		material_handle mat;
 	};
 
+	using object_handle = handle<object>;
 }
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include "pipeline_library.hh"
+
+#include "../log.hh"
+#include "enum_string_helper.hh"
+#include "instance.hh"
+
+#include <string.h>
+
+namespace vkb::vk
+{
+	struct pipeline_library::link_job
+	{
+		VkPipeline       parts[part_count] {};
+		VkPipelineLayout layout {nullptr};
+		VkPipeline       pipe {nullptr};
+		uint32_t         done {0};
+	};
+
+	pipeline_library::pipeline_library(bool fast_linking)
+	: fast_linking_ {fast_linking}
+	{
+		if (!fast_linking_)
+			log::warn("Graphics pipeline libraries can't be linked fast on this device");
+	}
+
+	pipeline_library::~pipeline_library()
+	{
+		instance& inst = instance::get();
+
+		if (joinable_)
+			thread::join(worker_);
+
+		for (uint32_t i {0}; i < vertex_inputs_.size(); ++i)
+			vkDestroyPipeline(inst.get_device(), vertex_inputs_[i].pipe, nullptr);
+		for (uint32_t i {0}; i < fragment_outputs_.size(); ++i)
+			vkDestroyPipeline(inst.get_device(), fragment_outputs_[i].pipe, nullptr);
+	}
+
+	VkPipeline pipeline_library::get_vertex_input(
+		VkVertexInputBindingDescription const& binding,
+		VkVertexInputAttributeDescription const* attrs, uint32_t attr_cnt,
+		VkPrimitiveTopology topology)
+	{
+		lock();
+		VkPipeline pipe = find_vertex_input(binding, attrs, attr_cnt, topology);
+		unlock();
+		if (pipe)
+			return pipe;
+
+		VkPipelineVertexInputStateCreateInfo vert_input_info {};
+		vert_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vert_input_info.vertexBindingDescriptionCount = 1;
+		vert_input_info.pVertexBindingDescriptions = &binding;
+		vert_input_info.vertexAttributeDescriptionCount = attr_cnt;
+		vert_input_info.pVertexAttributeDescriptions = attrs;
+
+		VkPipelineInputAssemblyStateCreateInfo input_assembly {};
+		input_assembly.sType =
+			VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		input_assembly.topology = topology;
+
+		VkGraphicsPipelineCreateInfo create_info {};
+		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		create_info.pVertexInputState = &vert_input_info;
+		create_info.pInputAssemblyState = &input_assembly;
+
+		// Created without the lock, which is only held to publish the part. If another
+		// thread published the same one meanwhile, it's kept instead.
+		pipe = create_part(create_info, vertex_input);
+		if (!pipe)
+			return nullptr;
+
+		lock();
+		VkPipeline published = find_vertex_input(binding, attrs, attr_cnt, topology);
+		if (!published)
+		{
+			vertex_input_entry& entry = vertex_inputs_.emplace_back();
+			entry.binding = binding;
+			entry.attrs.resize(attr_cnt);
+			memcpy(entry.attrs.data(), attrs,
+			       attr_cnt * sizeof(VkVertexInputAttributeDescription));
+			entry.topology = topology;
+			entry.pipe = pipe;
+		}
+		unlock();
+
+		if (published)
+		{
+			vkDestroyPipeline(instance::get().get_device(), pipe, nullptr);
+			return published;
+		}
+
+		return pipe;
+	}
+
+	VkPipeline pipeline_library::get_fragment_output(
+		VkFormat color_format, VkFormat depth_format,
+		VkPipelineColorBlendAttachmentState const& blend)
+	{
+		lock();
+		VkPipeline pipe = find_fragment_output(color_format, depth_format, blend);
+		unlock();
+		if (pipe)
+			return pipe;
+
+		VkPipelineMultisampleStateCreateInfo msaa {};
+		msaa.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		msaa.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		msaa.minSampleShading = 1.f;
+
+		VkPipelineColorBlendStateCreateInfo color_blend {};
+		color_blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		color_blend.logicOp = VK_LOGIC_OP_COPY;
+		color_blend.attachmentCount = 1;
+		color_blend.pAttachments = &blend;
+
+		VkPipelineRenderingCreateInfo rendering_info {};
+		rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachmentFormats = &color_format;
+		rendering_info.depthAttachmentFormat = depth_format;
+
+		VkGraphicsPipelineCreateInfo create_info {};
+		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		create_info.pNext = &rendering_info;
+		create_info.pMultisampleState = &msaa;
+		create_info.pColorBlendState = &color_blend;
+
+		pipe = create_part(create_info, fragment_output);
+		if (!pipe)
+			return nullptr;
+
+		lock();
+		VkPipeline published = find_fragment_output(color_format, depth_format, blend);
+		if (!published)
+		{
+			fragment_output_entry& entry = fragment_outputs_.emplace_back();
+			entry.color_format = color_format;
+			entry.depth_format = depth_format;
+			entry.blend = blend;
+			entry.pipe = pipe;
+		}
+		unlock();
+
+		if (published)
+		{
+			vkDestroyPipeline(instance::get().get_device(), pipe, nullptr);
+			return published;
+		}
+
+		return pipe;
+	}
+
+	VkPipeline pipeline_library::find_vertex_input(
+		VkVertexInputBindingDescription const& binding,
+		VkVertexInputAttributeDescription const* attrs, uint32_t attr_cnt,
+		VkPrimitiveTopology topology) const
+	{
+		for (uint32_t i {0}; i < vertex_inputs_.size(); ++i)
+		{
+			vertex_input_entry const& entry = vertex_inputs_[i];
+			if (entry.topology == topology && entry.attrs.size() == attr_cnt &&
+			    memcmp(&entry.binding, &binding, sizeof(binding)) == 0 &&
+			    memcmp(entry.attrs.data(), attrs,
+			           attr_cnt * sizeof(VkVertexInputAttributeDescription)) == 0)
+				return entry.pipe;
+		}
+
+		return nullptr;
+	}
+
+	VkPipeline pipeline_library::find_fragment_output(
+		VkFormat color_format, VkFormat depth_format,
+		VkPipelineColorBlendAttachmentState const& blend) const
+	{
+		for (uint32_t i {0}; i < fragment_outputs_.size(); ++i)
+		{
+			fragment_output_entry const& entry = fragment_outputs_[i];
+			if (entry.color_format == color_format &&
+			    entry.depth_format == depth_format &&
+			    memcmp(&entry.blend, &blend, sizeof(blend)) == 0)
+				return entry.pipe;
+		}
+
+		return nullptr;
+	}
+
+	VkPipeline pipeline_library::create_part(VkGraphicsPipelineCreateInfo& create_info,
+	                                         part                          p)
+	{
+		instance& inst = instance::get();
+
+		VkGraphicsPipelineLibraryCreateInfoEXT library_info {};
+		library_info.sType =
+			VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+		library_info.pNext = create_info.pNext;
+		library_info.flags = 1u << p;
+
+		create_info.pNext = &library_info;
+		// Link time optimization info is kept for the optimized link.
+		create_info.flags |=
+			VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+			VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+		VkPipeline pipe {nullptr};
+		VkResult   res = vkCreateGraphicsPipelines(inst.get_device(),
+		                                           inst.get_pipeline_cache(), 1,
+		                                           &create_info, nullptr, &pipe);
+		create_info.pNext = library_info.pNext;
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to create pipeline library (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		return pipe;
+	}
+
+	VkPipeline pipeline_library::link(VkPipeline const (&parts)[part_count],
+	                                   VkPipelineLayout layout)
+	{
+		return link(parts, layout, 0);
+	}
+
+	VkPipeline pipeline_library::link(VkPipeline const (&parts)[part_count],
+	                                   VkPipelineLayout      layout,
+	                                   VkPipelineCreateFlags flags)
+	{
+		instance& inst = instance::get();
+
+		VkPipelineLibraryCreateInfoKHR library_info {};
+		library_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+		library_info.libraryCount = part_count;
+		library_info.pLibraries = parts;
+
+		VkGraphicsPipelineCreateInfo create_info {};
+		create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		create_info.pNext = &library_info;
+		create_info.flags = flags;
+		create_info.layout = layout;
+
+		VkPipeline pipe {nullptr};
+		VkResult   res = vkCreateGraphicsPipelines(inst.get_device(),
+		                                           inst.get_pipeline_cache(), 1,
+		                                           &create_info, nullptr, &pipe);
+		if (res != VK_SUCCESS)
+		{
+			log::error("Failed to link graphics pipeline (%s)", string_VkResult(res));
+			return nullptr;
+		}
+
+		return pipe;
+	}
+
+	pipeline_library::link_job* pipeline_library::link_optimized(
+		VkPipeline const (&parts)[part_count], VkPipelineLayout layout)
+	{
+		link_job* job = new link_job;
+		memcpy(job->parts, parts, sizeof(job->parts));
+		job->layout = layout;
+
+		lock();
+		queue_.emplace_back(job);
+		if (!running_)
+		{
+			// The previous worker ran out of jobs, and is exiting.
+			if (joinable_)
+				thread::join(worker_);
+
+			running_ = thread::start(worker_, run, this);
+			joinable_ = running_;
+			if (!running_)
+			{
+				queue_.pop_back();
+				delete job;
+				job = nullptr;
+			}
+		}
+		unlock();
+
+		return job;
+	}
+
+	VkPipeline pipeline_library::take(link_job* job)
+	{
+		if (!__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+			return nullptr;
+
+		VkPipeline pipe = job->pipe;
+		delete job;
+		return pipe;
+	}
+
+	void pipeline_library::cancel(link_job* job)
+	{
+		lock();
+		for (uint32_t i {0}; i < queue_.size(); ++i)
+		{
+			if (queue_[i] == job)
+			{
+				queue_[i] = queue_.back();
+				queue_.pop_back();
+				unlock();
+				delete job;
+				return;
+			}
+		}
+		unlock();
+
+		// Being linked, which can take a while with link time optimizations.
+		while (!__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+			thread::yield();
+
+		vkDestroyPipeline(instance::get().get_device(), job->pipe, nullptr);
+		delete job;
+	}
+
+	void pipeline_library::run(uint32_t, void* user)
+	{
+		pipeline_library& lib = *static_cast<pipeline_library*>(user);
+
+		for (;;)
+		{
+			lib.lock();
+			if (!lib.queue_.size())
+			{
+				lib.running_ = false;
+				lib.unlock();
+				return;
+			}
+
+			link_job* job = lib.queue_.back();
+			lib.queue_.pop_back();
+			lib.unlock();
+
+			job->pipe = lib.link(job->parts, job->layout,
+			                     VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT);
+			__atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+		}
+	}
+
+	void pipeline_library::lock()
+	{
+		while (__atomic_exchange_n(&lock_, 1, __ATOMIC_ACQUIRE))
+			thread::yield();
+	}
+
+	void pipeline_library::unlock()
+	{
+		__atomic_store_n(&lock_, 0, __ATOMIC_RELEASE);
+	}
+}
\ No newline at end of file
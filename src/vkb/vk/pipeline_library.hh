@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../core/thread.hh"
+
+#include <vector.hh>
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// VK_EXT_graphics_pipeline_library parts. The vertex input and fragment output
+	// parts are shared between all the pipelines with the same state, and cached
+	// until destruction. The shader parts are created by their owners, and linked
+	// with the shared ones: quickly on first use, then with link time optimizations
+	// on a background thread.
+	// Can be used from any thread.
+	class pipeline_library
+	{
+	public:
+		// Parts in VkGraphicsPipelineLibraryFlagBitsEXT order.
+		enum part : uint8_t
+		{
+			vertex_input,
+			pre_rasterization,
+			fragment_shader,
+			fragment_output,
+			part_count,
+		};
+
+		struct link_job;
+
+		pipeline_library(bool fast_linking);
+		pipeline_library(pipeline_library const&) = delete;
+		pipeline_library(pipeline_library&&) = delete;
+		~pipeline_library();
+
+		pipeline_library& operator=(pipeline_library const&) = delete;
+		pipeline_library& operator=(pipeline_library&&) = delete;
+
+		VkPipeline get_vertex_input(VkVertexInputBindingDescription const&   binding,
+		                            VkVertexInputAttributeDescription const* attrs,
+		                            uint32_t attr_cnt, VkPrimitiveTopology topology);
+		VkPipeline get_fragment_output(VkFormat color_format, VkFormat depth_format,
+		                               VkPipelineColorBlendAttachmentState const& blend);
+
+		// Creates a part owned by the caller, usually the pre-rasterization or
+		// fragment shader one.
+		VkPipeline create_part(VkGraphicsPipelineCreateInfo& create_info, part p);
+
+		// Links without optimization, which is fast when supported by the driver.
+		VkPipeline link(VkPipeline const (&parts)[part_count], VkPipelineLayout layout);
+
+		// Queues an optimized link. take() returns the pipeline once linked, and
+		// releases the job. cancel() waits for the job, and destroys its pipeline.
+		link_job*  link_optimized(VkPipeline const (&parts)[part_count],
+		                          VkPipelineLayout layout);
+		VkPipeline take(link_job* job);
+		void       cancel(link_job* job);
+
+	private:
+		struct vertex_input_entry
+		{
+			VkVertexInputBindingDescription               binding {};
+			mc::vector<VkVertexInputAttributeDescription> attrs;
+			VkPrimitiveTopology                           topology {};
+			VkPipeline                                    pipe {nullptr};
+		};
+
+		struct fragment_output_entry
+		{
+			VkFormat                            color_format {};
+			VkFormat                            depth_format {};
+			VkPipelineColorBlendAttachmentState blend {};
+			VkPipeline                          pipe {nullptr};
+		};
+
+		static void run(uint32_t idx, void* user);
+
+		VkPipeline link(VkPipeline const (&parts)[part_count], VkPipelineLayout layout,
+		                VkPipelineCreateFlags flags);
+
+		// Lock held.
+		VkPipeline find_vertex_input(VkVertexInputBindingDescription const&   binding,
+		                             VkVertexInputAttributeDescription const* attrs,
+		                             uint32_t                                 attr_cnt,
+		                             VkPrimitiveTopology topology) const;
+		VkPipeline find_fragment_output(
+			VkFormat color_format, VkFormat depth_format,
+			VkPipelineColorBlendAttachmentState const& blend) const;
+
+		void lock();
+		void unlock();
+
+		bool fast_linking_ {false};
+
+		// Guards everything below. Only held for bookkeeping, never across the
+		// creation of a pipeline.
+		uint32_t lock_ {0};
+
+		mc::vector<vertex_input_entry>    vertex_inputs_;
+		mc::vector<fragment_output_entry> fragment_outputs_;
+
+		mc::vector<link_job*> queue_;
+		thread::handle        worker_ {0};
+		bool                  running_ {false};
+		bool                  joinable_ {false};
+	};
+}
\ No newline at end of file
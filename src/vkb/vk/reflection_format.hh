@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+
+// Layout of the .spv.refl reflection blobs, written by slangrc next to each SPIR-V
+// module. Tables follow the header, at the offsets it gives from the start of the blob.
+// Names are offsets in the string table, which holds interned, null terminated strings.
+// Enums and flags are stored with their Vulkan values.
+namespace vkb::vk::reflection_format
+{
+	constexpr uint32_t magic {0x52424b56}; // "VKBR"
+	constexpr uint32_t version {3};
+
+	struct table
+	{
+		uint32_t off;
+		uint32_t cnt;
+	};
+
+	struct header
+	{
+		uint32_t magic;
+		uint32_t version;
+		table    strings; // Size in bytes.
+		table    sets;
+		table    bindings;
+		table    members;
+		table    push_ranges;
+		table    entry_points;
+		table    vertex_inputs;
+		table    constants;
+	};
+
+	// Parameter block bound as descriptor set `index`. Its uniform data, if any, is in
+	// a uniform buffer listed with its other bindings.
+	struct set
+	{
+		uint32_t name;
+		uint32_t index;
+		uint32_t uniform_size;
+		uint32_t first_binding;
+		uint32_t binding_cnt;
+		uint32_t first_member;
+		uint32_t member_cnt;
+	};
+
+	struct binding
+	{
+		uint32_t name;
+		uint32_t binding;
+		uint32_t type;   // VkDescriptorType
+		uint32_t count;
+		uint32_t stages; // VkShaderStageFlags
+	};
+
+	enum class scalar_type : uint32_t
+	{
+		float32,
+		int32,
+		uint32,
+		other,
+	};
+
+	// Uniform data of a set, named after its path from the set ("cam.view").
+	struct member
+	{
+		uint32_t    name;
+		uint32_t    offset;
+		uint32_t    size;
+		scalar_type type;
+		uint32_t    rows;
+		uint32_t    cols;
+	};
+
+	struct push_range
+	{
+		uint32_t offset;
+		uint32_t size;
+		uint32_t stages; // VkShaderStageFlags
+	};
+
+	struct entry_point
+	{
+		uint32_t name;
+		uint32_t stage; // VkShaderStageFlagBits
+	};
+
+	struct vertex_input
+	{
+		uint32_t name;
+		uint32_t location;
+		uint32_t format; // VkFormat
+	};
+
+	// Specialization constant, 32 bits wide.
+	struct constant
+	{
+		uint32_t    name;
+		uint32_t    id;
+		scalar_type type;
+	};
+}
\ No newline at end of file
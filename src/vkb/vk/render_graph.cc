@@ -0,0 +1,729 @@
+#include "render_graph.hh"
+
+#include "../log.hh"
+#include "deletion_queue.hh"
+#include "enum_string_helper.hh"
+#include "instance.hh"
+
+namespace vkb::vk
+{
+	namespace
+	{
+		constexpr uint32_t max_color_attachments {8};
+
+		constexpr VkImageUsageFlags attachment_usages =
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		bool is_attachment(render_graph::use u)
+		{
+			return u == render_graph::use::color_attachment ||
+			       u == render_graph::use::depth_attachment;
+		}
+
+		VkImageUsageFlags usage_of(render_graph::use u)
+		{
+			switch (u)
+			{
+				case render_graph::use::color_attachment:
+					return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+				case render_graph::use::depth_attachment:
+				case render_graph::use::depth_read:
+					return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				case render_graph::use::sampled: return VK_IMAGE_USAGE_SAMPLED_BIT;
+				case render_graph::use::transfer_src:
+					return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+				case render_graph::use::transfer_dst:
+					return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+				default: return 0;
+			}
+		}
+	}
+
+	render_graph::~render_graph()
+	{
+		retire();
+	}
+
+	void render_graph::reset()
+	{
+		resources_.clear();
+		uses_.clear();
+		passes_.clear();
+		image_barriers_.clear();
+		buffer_barriers_.clear();
+		wanted_.clear();
+	}
+
+	render_graph::resource
+	render_graph::import_image(VkImage img, VkImageView view, image_desc const& desc,
+	                           VkImageLayout         initial_layout,
+	                           VkPipelineStageFlags2 initial_stage,
+	                           VkImageLayout         final_layout)
+	{
+		resource_data& r = resources_.emplace_back();
+		r.imported = true;
+		r.output = final_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+		r.initial.stages = initial_stage;
+		r.initial.layout = initial_layout;
+		r.img = img;
+		r.view = view;
+		r.desc = desc;
+		r.final_layout = final_layout;
+		return resources_.size() - 1;
+	}
+
+	render_graph::resource render_graph::import_buffer(VkBuffer buf)
+	{
+		resource_data& r = resources_.emplace_back();
+		r.image = false;
+		r.imported = true;
+		// Read outside of the graph.
+		r.output = true;
+		r.buf = buf;
+		return resources_.size() - 1;
+	}
+
+	render_graph::resource render_graph::create_image(image_desc const& desc)
+	{
+		resource_data& r = resources_.emplace_back();
+		r.desc = desc;
+		return resources_.size() - 1;
+	}
+
+	uint32_t render_graph::add_pass(char const* name, record_fn fn, void* ud)
+	{
+		pass_data& p = passes_.emplace_back();
+		p.name = name;
+		p.fn = fn;
+		p.ud = ud;
+		return passes_.size() - 1;
+	}
+
+	void render_graph::read(uint32_t pass, resource res, use u)
+	{
+		use_data& d = uses_.emplace_back();
+		d.pass = pass;
+		d.res = res;
+		d.u = u;
+	}
+
+	void render_graph::write(uint32_t pass, resource res, use u)
+	{
+		use_data& d = uses_.emplace_back();
+		d.pass = pass;
+		d.res = res;
+		d.u = u;
+		d.write = true;
+	}
+
+	void render_graph::attach(uint32_t pass, resource res, VkAttachmentLoadOp load,
+	                          VkClearValue clear)
+	{
+		use_data& d = uses_.emplace_back();
+		d.pass = pass;
+		d.res = res;
+		d.u = resources_[res].desc.aspect & VK_IMAGE_ASPECT_DEPTH_BIT
+		          ? use::depth_attachment
+		          : use::color_attachment;
+		d.write = true;
+		d.load = load;
+		d.clear = clear;
+	}
+
+	void render_graph::compile()
+	{
+		cull();
+		place_transients();
+		compute_barriers();
+	}
+
+	void render_graph::begin_execute(VkCommandBuffer cmd)
+	{
+		cmd_ = cmd;
+		next_pass_ = 0;
+	}
+
+	bool render_graph::begin_pass(uint32_t pass)
+	{
+		while (next_pass_ < pass)
+			run(next_pass_++);
+
+		next_pass_ = pass + 1;
+		if (!passes_[pass].live)
+			return false;
+
+		record(pass);
+		return true;
+	}
+
+	void render_graph::end_pass()
+	{
+		if (rendering_)
+			vkCmdEndRendering(cmd_);
+		rendering_ = false;
+	}
+
+	void render_graph::end_execute()
+	{
+		while (next_pass_ < passes_.size())
+			run(next_pass_++);
+
+		uint32_t cnt = image_barriers_.size() - final_barrier_off_;
+		if (cnt)
+		{
+			VkDependencyInfo dep {};
+			dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			dep.imageMemoryBarrierCount = cnt;
+			dep.pImageMemoryBarriers = image_barriers_.data() + final_barrier_off_;
+			vkCmdPipelineBarrier2(cmd_, &dep);
+		}
+
+		cmd_ = nullptr;
+	}
+
+	VkImageView render_graph::get_view(resource res) const
+	{
+		return resources_[res].view;
+	}
+
+	uint32_t render_graph::culled_passes() const
+	{
+		return culled_;
+	}
+
+	uint32_t render_graph::barrier_count() const
+	{
+		return image_barriers_.size() + buffer_barriers_.size();
+	}
+
+	render_graph::state render_graph::state_of(use u, VkAttachmentLoadOp load)
+	{
+		state s;
+		switch (u)
+		{
+			case use::color_attachment:
+				s.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+				s.access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+				if (load == VK_ATTACHMENT_LOAD_OP_LOAD)
+					s.access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+				s.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				break;
+			case use::depth_attachment:
+				s.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+				           VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+				s.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+				           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				s.layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+				break;
+			case use::depth_read:
+				s.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+				           VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+				s.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+				s.layout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+				break;
+			case use::sampled:
+				s.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+				s.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+				s.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				break;
+			case use::transfer_src:
+				s.stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+				s.access = VK_ACCESS_2_TRANSFER_READ_BIT;
+				s.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				break;
+			case use::transfer_dst:
+				s.stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+				s.access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+				s.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				break;
+			case use::uniform:
+				s.stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+				           VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+				s.access = VK_ACCESS_2_UNIFORM_READ_BIT;
+				break;
+			case use::vertex:
+				s.stages = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+				s.access = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+				break;
+			case use::index:
+				s.stages = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+				s.access = VK_ACCESS_2_INDEX_READ_BIT;
+				break;
+		}
+
+		return s;
+	}
+
+	bool render_graph::same(transient const& lhs, transient const& rhs)
+	{
+		return lhs.desc.format == rhs.desc.format &&
+		       lhs.desc.extent.width == rhs.desc.extent.width &&
+		       lhs.desc.extent.height == rhs.desc.extent.height &&
+		       lhs.desc.aspect == rhs.desc.aspect && lhs.usage == rhs.usage &&
+		       lhs.first == rhs.first && lhs.last == rhs.last;
+	}
+
+	void render_graph::cull()
+	{
+		for (uint32_t i {0}; i < resources_.size(); ++i)
+			resources_[i].needed = resources_[i].output;
+
+		// Backward, a pass is live if a later live pass or the outside reads what it
+		// writes.
+		culled_ = 0;
+		for (uint32_t p = passes_.size(); p-- > 0;)
+		{
+			pass_data& pass = passes_[p];
+			pass.live = false;
+			for (uint32_t i {0}; i < uses_.size(); ++i)
+			{
+				use_data const& d = uses_[i];
+				if (d.pass == p && d.write && resources_[d.res].needed)
+					pass.live = true;
+			}
+
+			if (!pass.live)
+			{
+				++culled_;
+				continue;
+			}
+
+			// Attachments not loaded are overwritten, the earlier content is unused.
+			for (uint32_t i {0}; i < uses_.size(); ++i)
+			{
+				use_data const& d = uses_[i];
+				if (d.pass == p && is_attachment(d.u) &&
+				    d.load != VK_ATTACHMENT_LOAD_OP_LOAD)
+					resources_[d.res].needed = false;
+			}
+			for (uint32_t i {0}; i < uses_.size(); ++i)
+			{
+				use_data const& d = uses_[i];
+				if (d.pass == p && (!d.write || (is_attachment(d.u) &&
+				                                 d.load == VK_ATTACHMENT_LOAD_OP_LOAD)))
+					resources_[d.res].needed = true;
+			}
+		}
+
+		for (uint32_t i {0}; i < uses_.size(); ++i)
+		{
+			use_data const& d = uses_[i];
+			if (!passes_[d.pass].live)
+				continue;
+
+			resource_data& r = resources_[d.res];
+			if (d.pass < r.first)
+				r.first = d.pass;
+			if (d.pass > r.last)
+				r.last = d.pass;
+			r.usage |= usage_of(d.u);
+		}
+	}
+
+	void render_graph::place_transients()
+	{
+		for (uint32_t i {0}; i < resources_.size(); ++i)
+		{
+			resource_data const& r = resources_[i];
+			if (r.imported || r.first == UINT32_MAX)
+				continue;
+
+			transient t;
+			t.res = i;
+			t.desc = r.desc;
+			t.usage = r.usage;
+			// Never read outside of the render passes, tile memory is enough.
+			if (!(t.usage & ~attachment_usages))
+				t.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			t.first = r.first;
+			t.last = r.last;
+
+			// Sorted by first use.
+			uint32_t pos = wanted_.size();
+			wanted_.emplace_back(t);
+			for (; pos > 0 && wanted_[pos - 1].first > t.first; --pos)
+				wanted_[pos] = wanted_[pos - 1];
+			wanted_[pos] = t;
+		}
+
+		bool reuse = wanted_.size() == transients_.size();
+		for (uint32_t i {0}; reuse && i < wanted_.size(); ++i)
+			reuse = same(wanted_[i], transients_[i]);
+
+		if (!reuse)
+		{
+			retire();
+			create_transients();
+		}
+
+		for (uint32_t i {0}; i < blocks_.size(); ++i)
+		{
+			blocks_[i].stages = VK_PIPELINE_STAGE_2_NONE;
+			blocks_[i].access = VK_ACCESS_2_NONE;
+		}
+
+		for (uint32_t i {0}; i < wanted_.size(); ++i)
+		{
+			resource_data& r = resources_[wanted_[i].res];
+			r.img = transients_[i].img;
+			r.view = transients_[i].view;
+			r.block = transients_[i].block;
+		}
+	}
+
+	void render_graph::create_transients()
+	{
+		instance& inst = instance::get();
+
+		// Greedy: each image takes the memory of the first block free since before
+		// its first use, or a new block. Lazily allocated memory is only committed
+		// while used, it isn't shared.
+		bool lazy_memory = inst.has_lazy_memory();
+		for (uint32_t i {0}; i < wanted_.size(); ++i)
+		{
+			transient t = wanted_[i];
+
+			VkImageCreateInfo img_info {};
+			img_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			img_info.imageType = VK_IMAGE_TYPE_2D;
+			img_info.format = t.desc.format;
+			img_info.extent = {t.desc.extent.width, t.desc.extent.height, 1};
+			img_info.mipLevels = 1;
+			img_info.arrayLayers = 1;
+			img_info.samples = VK_SAMPLE_COUNT_1_BIT;
+			img_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			img_info.usage = t.usage;
+			img_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			img_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkResult res = vkCreateImage(inst.get_device(), &img_info, nullptr, &t.img);
+			log::assert(res == VK_SUCCESS, "Failed to create transient image (%s)",
+			            string_VkResult(res));
+
+			VkMemoryRequirements reqs;
+			vkGetImageMemoryRequirements(inst.get_device(), t.img, &reqs);
+
+			bool lazy =
+				lazy_memory && (t.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+
+			t.block = UINT32_MAX;
+			for (uint32_t j {0}; !lazy && j < blocks_.size(); ++j)
+			{
+				block& b = blocks_[j];
+				if (!b.lazy && b.busy_until < t.first &&
+				    (b.reqs.memoryTypeBits & reqs.memoryTypeBits))
+				{
+					if (reqs.size > b.reqs.size)
+						b.reqs.size = reqs.size;
+					if (reqs.alignment > b.reqs.alignment)
+						b.reqs.alignment = reqs.alignment;
+					b.reqs.memoryTypeBits &= reqs.memoryTypeBits;
+					b.busy_until = t.last;
+					t.block = j;
+					break;
+				}
+			}
+
+			if (t.block == UINT32_MAX)
+			{
+				block& b = blocks_.emplace_back();
+				b.reqs = reqs;
+				b.busy_until = t.last;
+				b.lazy = lazy;
+				t.block = blocks_.size() - 1;
+			}
+
+			transients_.emplace_back(t);
+		}
+
+		// Blocks are shared by several images, so the memory type is picked from their
+		// merged requirements instead of an image.
+		VmaAllocationCreateInfo alloc_info {};
+		alloc_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		alloc_info.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		VmaAllocationCreateInfo lazy_info = alloc_info;
+		lazy_info.requiredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		for (uint32_t i {0}; i < blocks_.size(); ++i)
+		{
+			block&   b = blocks_[i];
+			VkResult res = VK_ERROR_FEATURE_NOT_PRESENT;
+			if (b.lazy)
+				res = vmaAllocateMemory(inst.get_allocator(), &b.reqs, &lazy_info,
+				                        &b.alloc, nullptr);
+			// Lazy memory types may not suit the image.
+			if (res != VK_SUCCESS)
+				res = vmaAllocateMemory(inst.get_allocator(), &b.reqs, &alloc_info,
+				                        &b.alloc, nullptr);
+			log::assert(res == VK_SUCCESS, "Failed to allocate transient memory (%s)",
+			            string_VkResult(res));
+			inst.get_memory_stats().on_alloc(b.alloc, mem_category::attachments);
+		}
+
+		for (uint32_t i {0}; i < transients_.size(); ++i)
+		{
+			transient& t = transients_[i];
+			vmaBindImageMemory(inst.get_allocator(), blocks_[t.block].alloc, t.img);
+			t.view = inst.create_image_view(t.img, t.desc.format, t.desc.aspect, 1);
+		}
+
+		if (blocks_.size() < transients_.size())
+		{
+			log::info("Render graph: %u transient images in %u memory blocks",
+			          static_cast<uint32_t>(transients_.size()),
+			          static_cast<uint32_t>(blocks_.size()));
+		}
+	}
+
+	void render_graph::retire()
+	{
+		deletion_queue& queue = instance::get().get_deletion_queue();
+		for (uint32_t i {0}; i < transients_.size(); ++i)
+			queue.destroy(image {transients_[i].img, nullptr}, transients_[i].view);
+		for (uint32_t i {0}; i < blocks_.size(); ++i)
+			queue.free(blocks_[i].alloc);
+
+		transients_.clear();
+		blocks_.clear();
+	}
+
+	void render_graph::compute_barriers()
+	{
+		// Transient images are undefined at their first use, which waits for the
+		// previous uses of their memory, by this frame or the previous one.
+		for (uint32_t i {0}; i < uses_.size(); ++i)
+		{
+			use_data const&      d = uses_[i];
+			resource_data const& r = resources_[d.res];
+			if (!passes_[d.pass].live || r.block == UINT32_MAX)
+				continue;
+
+			state s = state_of(d.u, d.load);
+			blocks_[r.block].stages |= s.stages;
+			if (d.write)
+				blocks_[r.block].access |= s.access;
+		}
+
+		for (uint32_t i {0}; i < resources_.size(); ++i)
+		{
+			resource_data& r = resources_[i];
+			r.cur = r.initial;
+			if (r.block != UINT32_MAX)
+			{
+				r.cur.stages = blocks_[r.block].stages;
+				r.cur.access = blocks_[r.block].access;
+			}
+			r.visible = VK_PIPELINE_STAGE_2_NONE;
+			r.read_stages = VK_PIPELINE_STAGE_2_NONE;
+		}
+
+		for (uint32_t p {0}; p < passes_.size(); ++p)
+		{
+			pass_data& pass = passes_[p];
+			pass.img_barrier_off = image_barriers_.size();
+			pass.buf_barrier_off = buffer_barriers_.size();
+			if (pass.live)
+			{
+				// The uses of a resource by the pass are merged in a single barrier.
+				for (uint32_t i {0}; i < uses_.size(); ++i)
+				{
+					use_data const& d = uses_[i];
+					if (d.pass != p)
+						continue;
+
+					bool seen {false};
+					for (uint32_t j {0}; j < i && !seen; ++j)
+						seen = uses_[j].pass == p && uses_[j].res == d.res;
+					if (seen)
+						continue;
+
+					state dst = state_of(d.u, d.load);
+					bool  write = d.write;
+					for (uint32_t j {i + 1}; j < uses_.size(); ++j)
+					{
+						use_data const& other = uses_[j];
+						if (other.pass != p || other.res != d.res)
+							continue;
+
+						state s = state_of(other.u, other.load);
+						log::assert(!resources_[d.res].image || s.layout == dst.layout,
+						            "Pass %s uses an image in two layouts", pass.name);
+						dst.stages |= s.stages;
+						dst.access |= s.access;
+						write |= other.write;
+					}
+
+					add_barrier(d.res, dst, write);
+				}
+			}
+			pass.img_barrier_cnt = image_barriers_.size() - pass.img_barrier_off;
+			pass.buf_barrier_cnt = buffer_barriers_.size() - pass.buf_barrier_off;
+		}
+
+		final_barrier_off_ = image_barriers_.size();
+		for (uint32_t i {0}; i < resources_.size(); ++i)
+		{
+			resource_data& r = resources_[i];
+			if (!r.image || !r.imported || r.final_layout == VK_IMAGE_LAYOUT_UNDEFINED ||
+			    r.cur.layout == r.final_layout)
+				continue;
+
+			state src = r.cur;
+			src.stages |= r.read_stages;
+			state dst;
+			dst.layout = r.final_layout;
+			push_barrier(r, src, dst);
+		}
+	}
+
+	void render_graph::add_barrier(resource res, state const& dst, bool write)
+	{
+		resource_data& r = resources_[res];
+
+		bool transition = r.image && r.cur.layout != dst.layout;
+		if (write || transition)
+		{
+			// Waits for the last write and the reads since, a write after reads only
+			// needs an execution dependency.
+			state src = r.cur;
+			src.stages |= r.read_stages;
+			if (transition || src.stages != VK_PIPELINE_STAGE_2_NONE)
+				push_barrier(r, src, dst);
+
+			r.cur.stages = dst.stages;
+			r.cur.access = write ? dst.access : VK_ACCESS_2_NONE;
+			r.cur.layout = dst.layout;
+			r.visible = dst.stages;
+			r.read_stages = write ? VK_PIPELINE_STAGE_2_NONE : dst.stages;
+			return;
+		}
+
+		// Reads after a write only wait for it once per stage.
+		if ((dst.stages & ~r.visible) && r.cur.stages != VK_PIPELINE_STAGE_2_NONE)
+		{
+			push_barrier(r, r.cur, dst);
+			r.visible |= dst.stages;
+		}
+		r.read_stages |= dst.stages;
+	}
+
+	void render_graph::push_barrier(resource_data const& r, state const& src,
+	                                state const& dst)
+	{
+		if (r.image)
+		{
+			VkImageMemoryBarrier2& barrier = image_barriers_.emplace_back();
+			barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+			barrier.srcStageMask = src.stages;
+			barrier.srcAccessMask = src.access;
+			barrier.dstStageMask = dst.stages;
+			barrier.dstAccessMask = dst.access;
+			barrier.oldLayout = src.layout;
+			barrier.newLayout = dst.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = r.img;
+			barrier.subresourceRange.aspectMask = r.desc.aspect;
+			barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+			barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		}
+		else
+		{
+			VkBufferMemoryBarrier2& barrier = buffer_barriers_.emplace_back();
+			barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			barrier.srcStageMask = src.stages;
+			barrier.srcAccessMask = src.access;
+			barrier.dstStageMask = dst.stages;
+			barrier.dstAccessMask = dst.access;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = r.buf;
+			barrier.size = VK_WHOLE_SIZE;
+		}
+	}
+
+	void render_graph::record(uint32_t pass)
+	{
+		pass_data const& p = passes_[pass];
+		if (p.img_barrier_cnt || p.buf_barrier_cnt)
+		{
+			VkDependencyInfo dep {};
+			dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			dep.imageMemoryBarrierCount = p.img_barrier_cnt;
+			dep.pImageMemoryBarriers = image_barriers_.data() + p.img_barrier_off;
+			dep.bufferMemoryBarrierCount = p.buf_barrier_cnt;
+			dep.pBufferMemoryBarriers = buffer_barriers_.data() + p.buf_barrier_off;
+			vkCmdPipelineBarrier2(cmd_, &dep);
+		}
+
+		VkRenderingAttachmentInfo colors[max_color_attachments] {};
+		VkRenderingAttachmentInfo depth {};
+		uint32_t                  color_cnt {0};
+		bool                      has_depth {false};
+		VkExtent2D                extent {};
+		for (uint32_t i {0}; i < uses_.size(); ++i)
+		{
+			use_data const& d = uses_[i];
+			if (d.pass != pass || !is_attachment(d.u))
+				continue;
+
+			resource_data const& r = resources_[d.res];
+			bool                 color = d.u == use::color_attachment;
+			log::assert(!color || color_cnt < max_color_attachments,
+			            "Pass %s has too many color attachments", p.name);
+			VkRenderingAttachmentInfo& att = color ? colors[color_cnt++] : depth;
+			has_depth |= !color;
+
+			att.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			att.imageView = r.view;
+			att.imageLayout = state_of(d.u, d.load).layout;
+			att.loadOp = d.load;
+			// Stored only if used after this pass.
+			att.storeOp = r.output || r.last > pass ? VK_ATTACHMENT_STORE_OP_STORE
+			                                        : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			att.clearValue = d.clear;
+			extent = r.desc.extent;
+		}
+
+		if (!color_cnt && !has_depth)
+			return;
+
+		VkRenderingInfo render_info {};
+		render_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		render_info.layerCount = 1;
+		render_info.colorAttachmentCount = color_cnt;
+		render_info.pColorAttachments = colors;
+		render_info.pDepthAttachment = has_depth ? &depth : nullptr;
+		render_info.renderArea = {
+			{0, 0},
+            extent
+        };
+		vkCmdBeginRendering(cmd_, &render_info);
+		rendering_ = true;
+
+		VkViewport viewport {};
+		viewport.width = extent.width;
+		viewport.height = extent.height;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewportWithCount(cmd_, 1, &viewport);
+
+		VkRect2D scissor {};
+		scissor.extent = extent;
+		vkCmdSetScissorWithCount(cmd_, 1, &scissor);
+	}
+
+	void render_graph::run(uint32_t pass)
+	{
+		pass_data const& p = passes_[pass];
+		if (!p.live)
+			return;
+
+		record(pass);
+		if (p.fn)
+			p.fn(cmd_, p.ud);
+		end_pass();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <vector.hh>
+
+#include "vma/vma.hh"
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Passes of a frame, declared with the images and buffers they use, then compiled
+	// and recorded in declaration order.
+	// Compiling culls the passes whose results are never used, places one batch of
+	// synchronization2 barriers before each pass, and picks the store operation of
+	// the attachments. Transient images are created by the graph, and share their
+	// memory with the transient images whose lifetime doesn't overlap theirs. They are
+	// kept while the next frames declare the same transient images. Those only used as
+	// attachments, like depth or multisampled targets resolved in their pass, are
+	// created as transient attachments, in lazily allocated memory when available.
+	// The graph is declared again every frame, reset() keeps the storage.
+	class render_graph
+	{
+	public:
+		// Index of a resource declared since the last reset().
+		using resource = uint32_t;
+		// Records the commands of a pass, inside its rendering scope if it has
+		// attachments.
+		using record_fn = void (*)(VkCommandBuffer cmd, void* ud);
+
+		enum class use : uint8_t
+		{
+			color_attachment,
+			depth_attachment,
+			depth_read,
+			sampled,
+			transfer_src,
+			transfer_dst,
+			uniform,
+			vertex,
+			index,
+		};
+
+		struct image_desc
+		{
+			VkFormat           format {VK_FORMAT_UNDEFINED};
+			VkExtent2D         extent {};
+			VkImageAspectFlags aspect {VK_IMAGE_ASPECT_COLOR_BIT};
+		};
+
+		render_graph() = default;
+		render_graph(render_graph const&) = delete;
+		render_graph(render_graph&&) = delete;
+		~render_graph();
+
+		render_graph& operator=(render_graph const&) = delete;
+		render_graph& operator=(render_graph&&) = delete;
+
+		void reset();
+
+		// Image owned outside of the graph, in initial_layout once initial_stage
+		// completed. It is left in final_layout, and its writers are never culled,
+		// unless final_layout is VK_IMAGE_LAYOUT_UNDEFINED.
+		resource import_image(VkImage img, VkImageView view, image_desc const& desc,
+		                      VkImageLayout         initial_layout,
+		                      VkPipelineStageFlags2 initial_stage,
+		                      VkImageLayout         final_layout);
+		resource import_buffer(VkBuffer buf);
+		// Image whose content only lives during the frame.
+		resource create_image(image_desc const& desc);
+
+		// Passes without record function are recorded by the caller, between
+		// begin_pass() and end_pass().
+		uint32_t add_pass(char const* name, record_fn fn = nullptr, void* ud = nullptr);
+		void     read(uint32_t pass, resource res, use u);
+		void     write(uint32_t pass, resource res, use u);
+		// Color or depth attachment, both read and written by the pass.
+		void attach(uint32_t pass, resource res, VkAttachmentLoadOp load,
+		            VkClearValue clear = {});
+
+		void compile();
+
+		void begin_execute(VkCommandBuffer cmd);
+		// Records the passes before pass, then the barriers of pass and begins its
+		// rendering scope. Returns false if pass was culled.
+		bool begin_pass(uint32_t pass);
+		void end_pass();
+		// Records the remaining passes and the final transitions.
+		void end_execute();
+
+		VkImageView get_view(resource res) const;
+
+		// Of the last compile().
+		uint32_t culled_passes() const;
+		uint32_t barrier_count() const;
+
+	private:
+		struct state
+		{
+			VkPipelineStageFlags2 stages {VK_PIPELINE_STAGE_2_NONE};
+			VkAccessFlags2        access {VK_ACCESS_2_NONE};
+			VkImageLayout         layout {VK_IMAGE_LAYOUT_UNDEFINED};
+		};
+
+		struct resource_data
+		{
+			bool  image {true};
+			bool  imported {false};
+			bool  output {false};
+			state initial;
+			// While culling, whether a later live pass reads the content.
+			bool needed {false};
+
+			VkImage       img {nullptr};
+			VkImageView   view {nullptr};
+			VkBuffer      buf {nullptr};
+			image_desc    desc;
+			VkImageLayout final_layout {VK_IMAGE_LAYOUT_UNDEFINED};
+			// Of the transient images, from their uses.
+			VkImageUsageFlags usage {0};
+
+			// Live passes using the resource, first and last.
+			uint32_t first {UINT32_MAX};
+			uint32_t last {0};
+			uint32_t block {UINT32_MAX};
+
+			// While compiling: last write or layout transition, the stages it was
+			// made visible to, and the stages reading it since.
+			state                 cur;
+			VkPipelineStageFlags2 visible {VK_PIPELINE_STAGE_2_NONE};
+			VkPipelineStageFlags2 read_stages {VK_PIPELINE_STAGE_2_NONE};
+		};
+
+		struct use_data
+		{
+			uint32_t           pass {0};
+			resource           res {0};
+			use                u {use::sampled};
+			bool               write {false};
+			VkAttachmentLoadOp load {VK_ATTACHMENT_LOAD_OP_DONT_CARE};
+			VkClearValue       clear {};
+		};
+
+		struct pass_data
+		{
+			char const* name {nullptr};
+			record_fn   fn {nullptr};
+			void*       ud {nullptr};
+			bool        live {false};
+			// Range in image_barriers_ and buffer_barriers_.
+			uint32_t img_barrier_off {0};
+			uint32_t img_barrier_cnt {0};
+			uint32_t buf_barrier_off {0};
+			uint32_t buf_barrier_cnt {0};
+		};
+
+		// Transient image as created, compared between frames to keep them.
+		struct transient
+		{
+			resource          res {0};
+			image_desc        desc;
+			VkImageUsageFlags usage {0};
+			uint32_t          first {0};
+			uint32_t          last {0};
+			VkImage           img {nullptr};
+			VkImageView       view {nullptr};
+			uint32_t          block {0};
+		};
+
+		// Memory shared by transient images.
+		struct block
+		{
+			VmaAllocation         alloc {nullptr};
+			VkMemoryRequirements  reqs {};
+			uint32_t              busy_until {0};
+			// Uses of all its images, waited before any of them is used again.
+			VkPipelineStageFlags2 stages {VK_PIPELINE_STAGE_2_NONE};
+			VkAccessFlags2        access {VK_ACCESS_2_NONE};
+			// Lazily allocated memory of a single transient attachment.
+			bool lazy {false};
+		};
+
+		static state state_of(use u, VkAttachmentLoadOp load);
+		static bool  same(transient const& lhs, transient const& rhs);
+
+		void cull();
+		void place_transients();
+		void create_transients();
+		// Hands the transient images and their memory to the deletion queue.
+		void retire();
+		void compute_barriers();
+		void add_barrier(resource res, state const& dst, bool write);
+		void push_barrier(resource_data const& r, state const& src, state const& dst);
+		// Records the barriers of pass, and begins its rendering scope.
+		void record(uint32_t pass);
+		void run(uint32_t pass);
+
+		mc::vector<resource_data> resources_;
+		mc::vector<use_data>      uses_;
+		mc::vector<pass_data>     passes_;
+
+		mc::vector<VkImageMemoryBarrier2>  image_barriers_;
+		mc::vector<VkBufferMemoryBarrier2> buffer_barriers_;
+		// After the last pass.
+		uint32_t final_barrier_off_ {0};
+		uint32_t culled_ {0};
+
+		// Transients of this frame, then the ones created by a previous frame.
+		mc::vector<transient> wanted_;
+		mc::vector<transient> transients_;
+		mc::vector<block>     blocks_;
+
+		VkCommandBuffer cmd_ {nullptr};
+		uint32_t        next_pass_ {0};
+		bool            rendering_ {false};
+	};
+}
\ No newline at end of file
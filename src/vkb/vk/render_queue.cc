@@ -0,0 +1,187 @@
+#include "render_queue.hh"
+
+#include "../core/arena.hh"
+#include "../log.hh"
+#include "material.hh"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace vkb::vk
+{
+	namespace
+	{
+		template <typename T>
+		T* frame_alloc(uint32_t cnt)
+		{
+			T* data = arena_allocator<T>(frame_arena::get().current()).allocate(cnt);
+			log::assert(data, "Frame arena full, %u draws queued", cnt);
+			return data;
+		}
+	}
+
+	uint64_t render_queue::make_key(uint32_t pass, uint32_t pipeline, uint32_t set,
+	                                uint32_t mesh, float depth)
+	{
+		depth = depth < 0.f ? 0.f : (depth > 1.f ? 1.f : depth);
+
+		return (static_cast<uint64_t>(pass & 0xf) << 60) |
+		       (static_cast<uint64_t>(pipeline & 0xfff) << 48) |
+		       (static_cast<uint64_t>(set & 0xffff) << 32) |
+		       (static_cast<uint64_t>(mesh & 0xffff) << 16) |
+		       static_cast<uint64_t>(depth * 0xffff);
+	}
+
+	uint32_t render_queue::handle_id(void const* handle)
+	{
+		// Handles are aligned addresses or small indices, their bits are mixed so the
+		// low bits kept in the keys differ.
+		uint64_t h = reinterpret_cast<uintptr_t>(handle);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return static_cast<uint32_t>(h);
+	}
+
+	void render_queue::submit(uint64_t key, draw const& d)
+	{
+		if (cnt_ == cap_)
+		{
+			uint32_t cap = cap_ ? cap_ * 2 : 64;
+			draw*    draws = frame_alloc<draw>(cap);
+			entry*   entries = frame_alloc<entry>(cap);
+			if (cnt_)
+			{
+				memcpy(draws, draws_, cnt_ * sizeof(draw));
+				memcpy(entries, entries_, cnt_ * sizeof(entry));
+			}
+			draws_ = draws;
+			entries_ = entries;
+			cap_ = cap;
+		}
+
+		entries_[cnt_] = entry {key, cnt_};
+		draws_[cnt_] = d;
+		++cnt_;
+	}
+
+	void render_queue::flush(VkCommandBuffer cmd)
+	{
+		stats_ = {};
+		stats_.draws = cnt_;
+		if (!cnt_)
+			return;
+
+		entry const* sorted = sort();
+
+		// Bound state, a material bind resets the sets since another pipeline layout
+		// may disturb them.
+		material*       mat {nullptr};
+		bool            mat_bound {false};
+		VkDescriptorSet set {nullptr};
+		uint32_t        uniform_off {0};
+		VkBuffer        vertices {nullptr};
+		VkBuffer        indices {nullptr};
+		for (uint32_t i {0}; i < cnt_; ++i)
+		{
+			draw const& d = draws_[sorted[i].draw];
+
+			if (d.mat != mat)
+			{
+				mat_bound = d.mat->bind(cmd);
+				mat = d.mat;
+				set = nullptr;
+				++stats_.binds;
+			}
+			else
+				++stats_.skipped_binds;
+
+			// Already logged by the material.
+			if (!mat_bound)
+				continue;
+
+			if (d.set != set || d.uniform_off != uniform_off)
+			{
+				uint32_t offset_cnt = mat->get_layout().get_set(0).uniform_size ? 1 : 0;
+				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				                        mat->get_pipeline_layout(), 0, 1, &d.set,
+				                        offset_cnt, &d.uniform_off);
+				set = d.set;
+				uniform_off = d.uniform_off;
+				++stats_.binds;
+			}
+			else
+				++stats_.skipped_binds;
+
+			if (d.vertices != vertices)
+			{
+				VkDeviceSize offset {0};
+				vkCmdBindVertexBuffers(cmd, 0, 1, &d.vertices, &offset);
+				vertices = d.vertices;
+				++stats_.binds;
+			}
+			else
+				++stats_.skipped_binds;
+
+			if (d.indices != indices)
+			{
+				vkCmdBindIndexBuffer(cmd, d.indices, 0, VK_INDEX_TYPE_UINT16);
+				indices = d.indices;
+				++stats_.binds;
+			}
+			else
+				++stats_.skipped_binds;
+
+			if (d.push_size)
+				mat->push_constants(cmd, 0, d.push_size, d.push);
+			vkCmdDrawIndexed(cmd, d.idx_cnt, 1, d.first_idx, d.vertex_off, 0);
+		}
+
+		draws_ = nullptr;
+		entries_ = nullptr;
+		cnt_ = 0;
+		cap_ = 0;
+	}
+
+	render_queue::stats const& render_queue::get_stats() const
+	{
+		return stats_;
+	}
+
+	render_queue::entry const* render_queue::sort()
+	{
+		// Ping-pong buffer.
+		uint32_t cnt = cnt_;
+		entry*   src = entries_;
+		entry*   dst = frame_alloc<entry>(cnt);
+
+		// Least significant byte first, each pass being stable.
+		for (uint32_t shift {0}; shift < 64; shift += 8)
+		{
+			uint32_t counts[256] {};
+			for (uint32_t i {0}; i < cnt; ++i)
+				++counts[(src[i].key >> shift) & 0xff];
+
+			// All the keys share this byte, nothing to move.
+			if (counts[(src[0].key >> shift) & 0xff] == cnt)
+				continue;
+
+			uint32_t off {0};
+			for (uint32_t i {0}; i < 256; ++i)
+			{
+				uint32_t count = counts[i];
+				counts[i] = off;
+				off += count;
+			}
+
+			for (uint32_t i {0}; i < cnt; ++i)
+				dst[counts[(src[i].key >> shift) & 0xff]++] = src[i];
+
+			entry* tmp = src;
+			src = dst;
+			dst = tmp;
+		}
+
+		return src;
+	}
+}
\ No newline at end of file
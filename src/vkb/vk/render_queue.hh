@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	class material;
+
+	// Draws submitted in any order during a frame, then sorted by their key and
+	// replayed, skipping the binds already made by the previous draw. The draws are
+	// kept in the frame arena, they must be submitted and flushed in the same frame.
+	// Keys hold, from the most significant bits: the pass (4 bits), the pipeline
+	// (12 bits), the descriptor set (16 bits), the mesh (16 bits) and the depth (16
+	// bits). Draws sharing a state are then consecutive, front to back.
+	class render_queue
+	{
+	public:
+		struct draw
+		{
+			material*       mat {nullptr};
+			// Bound as set 0. uniform_off is the dynamic offset of its uniform block,
+			// if the set has one.
+			VkDescriptorSet set {nullptr};
+			uint32_t        uniform_off {0};
+			VkBuffer        vertices {nullptr};
+			// 16 bits indices.
+			VkBuffer        indices {nullptr};
+			uint32_t        first_idx {0};
+			int32_t         vertex_off {0};
+			uint32_t        idx_cnt {0};
+			// Pushed at offset 0, must stay valid until flush().
+			void const* push {nullptr};
+			uint32_t    push_size {0};
+		};
+
+		// Binds made and skipped by the last flush().
+		struct stats
+		{
+			uint32_t draws {0};
+			uint32_t binds {0};
+			uint32_t skipped_binds {0};
+		};
+
+		// depth is normalized, from 0 at the camera to 1 at the far plane.
+		static uint64_t make_key(uint32_t pass, uint32_t pipeline, uint32_t set,
+		                         uint32_t mesh, float depth);
+		// Id of a handle for a key field. Different handles may share an id, which
+		// only groups their draws less well.
+		static uint32_t handle_id(void const* handle);
+
+		void submit(uint64_t key, draw const& d);
+
+		// Sorts the draws, records them in cmd and clears the queue.
+		void flush(VkCommandBuffer cmd);
+
+		stats const& get_stats() const;
+
+	private:
+		struct entry
+		{
+			uint64_t key;
+			uint32_t draw;
+		};
+
+		// Radix sort of entries_ by key, returns the sorted entries.
+		entry const* sort();
+
+		// Growing in the frame arena, the outgrown blocks stay there until the frame
+		// is begun again. One entry per draw.
+		draw*    draws_ {nullptr};
+		entry*   entries_ {nullptr};
+		uint32_t cnt_ {0};
+		uint32_t cap_ {0};
+		stats    stats_;
+	};
+}
\ No newline at end of file
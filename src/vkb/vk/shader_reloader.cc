@@ -0,0 +1,199 @@
+#include "shader_reloader.hh"
+
+#include "../log.hh"
+#include "deletion_queue.hh"
+#include "instance.hh"
+
+#include <slangrc/compiler.hh>
+
+#include <string.h>
+
+namespace vkb::vk
+{
+	namespace
+	{
+		bool ends_with(mc::string const& str, char const* suffix)
+		{
+			uint32_t len = strlen(suffix);
+			return str.size() >= len &&
+			       memcmp(str.data() + str.size() - len, suffix, len) == 0;
+		}
+
+		bool same(mc::string const& lhs, mc::string const& rhs)
+		{
+			return lhs.size() == rhs.size() &&
+			       memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+		}
+
+		// Deferred with a pointer to the replaced rebuild.
+		void destroy_retired(void* data)
+		{
+			material::rebuild* reb = *static_cast<material::rebuild**>(data);
+			material::destroy_rebuild(*reb);
+			delete reb;
+		}
+	}
+
+	shader_reloader::shader_reloader(char const* shader_dir)
+	: dir_ {shader_dir}
+	, watcher_ {shader_dir}
+	{
+		if (watcher_.opened())
+			log::info("Watching shaders in %s", shader_dir);
+	}
+
+	shader_reloader::~shader_reloader()
+	{
+		if (running_)
+			thread::join(worker_);
+		for (uint32_t i {0}; i < jobs_.size(); ++i)
+			material::destroy_rebuild(jobs_[i].reb);
+
+		if (compiler_)
+			slangrc::destroy_compiler(compiler_);
+	}
+
+	void shader_reloader::add(material& mat)
+	{
+		// <dir>/<name>.spv -> <name>.slang
+		mc::string const& path = mat.get_path();
+		uint32_t          start {0};
+		uint32_t          end = path.size();
+		for (uint32_t i {0}; i < path.size(); ++i)
+		{
+			if (path.data()[i] == '/')
+				start = i + 1;
+			else if (path.data()[i] == '.')
+				end = i;
+		}
+		if (end < start)
+			end = path.size();
+
+		entry& e = entries_.emplace_back();
+		e.mat = &mat;
+		e.source.reserve(end - start + 6);
+		e.source += mc::string_view(path.data() + start, end - start);
+		e.source += ".slang";
+	}
+
+	void shader_reloader::remove(material& mat)
+	{
+		if (running_)
+			finish();
+
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+		{
+			if (entries_[i].mat == &mat)
+			{
+				entries_[i] = static_cast<entry&&>(entries_.back());
+				entries_.pop_back();
+				return;
+			}
+		}
+	}
+
+	void shader_reloader::update()
+	{
+		if (running_ && __atomic_load_n(&done_, __ATOMIC_ACQUIRE))
+			finish();
+
+		watcher_.poll(changed_);
+		if (!running_ && changed_.size())
+			start();
+	}
+
+	void shader_reloader::run(uint32_t, void* user)
+	{
+		shader_reloader& reloader = *static_cast<shader_reloader*>(user);
+
+		if (!reloader.compiler_)
+			reloader.compiler_ = slangrc::create_compiler();
+
+		for (uint32_t i {0}; i < reloader.jobs_.size(); ++i)
+		{
+			job&            j = reloader.jobs_[i];
+			slangrc::output out;
+			if (!reloader.compiler_ ||
+			    !slangrc::compile(reloader.compiler_, j.path.data(), out))
+				continue;
+
+			j.built = j.mat->build_rebuild(j.reb, out.spirv.data, out.spirv.size,
+			                               out.reflection.data, out.reflection.size);
+			slangrc::free_output(out);
+		}
+
+		__atomic_store_n(&reloader.done_, 1, __ATOMIC_RELEASE);
+	}
+
+	void shader_reloader::start()
+	{
+		// Changes to other sources, like imported modules, may affect any shader.
+		bool all {false};
+		for (uint32_t i {0}; i < changed_.size(); ++i)
+		{
+			if (!ends_with(changed_[i], ".slang"))
+				continue;
+
+			bool found {false};
+			for (uint32_t j {0}; j < entries_.size(); ++j)
+				found |= same(changed_[i], entries_[j].source);
+			all |= !found;
+		}
+
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+		{
+			bool changed {all};
+			for (uint32_t j {0}; !changed && j < changed_.size(); ++j)
+				changed = same(changed_[j], entries_[i].source);
+			if (!changed)
+				continue;
+
+			job& j = jobs_.emplace_back();
+			j.mat = entries_[i].mat;
+			j.path.reserve(dir_.size() + 1 + entries_[i].source.size());
+			j.path += dir_;
+			j.path += "/";
+			j.path += entries_[i].source;
+			j.mat->begin_rebuild(j.reb);
+		}
+		changed_.clear();
+
+		if (!jobs_.size())
+			return;
+
+		done_ = 0;
+		running_ = thread::start(worker_, run, this);
+		if (!running_)
+		{
+			log::error("Failed to start shader reload thread");
+			jobs_.clear();
+		}
+	}
+
+	void shader_reloader::finish()
+	{
+		thread::join(worker_);
+		running_ = false;
+
+		for (uint32_t i {0}; i < jobs_.size(); ++i)
+		{
+			job& j = jobs_[i];
+			if (!j.built)
+			{
+				// Never used by a frame.
+				material::destroy_rebuild(j.reb);
+				log::error("Failed to reload %s, keeping the previous version",
+				           j.path.data());
+				continue;
+			}
+
+			j.mat->end_rebuild(j.reb);
+			material::rebuild* reb =
+				new material::rebuild(static_cast<material::rebuild&&>(j.reb));
+			instance::get().get_deletion_queue().defer(destroy_retired, &reb,
+			                                           sizeof(reb));
+			log::info("Reloaded %s", j.path.data());
+		}
+		jobs_.clear();
+	}
+}
\ No newline at end of file
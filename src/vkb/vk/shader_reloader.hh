@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../core/file_watcher.hh"
+#include "../core/thread.hh"
+#include "material.hh"
+
+#include <string.hh>
+#include <vector.hh>
+
+#include <stdint.h>
+
+namespace slangrc
+{
+	struct compiler;
+}
+
+namespace vkb::vk
+{
+	// Only built with VKB_HOT_RELOAD, which links the Slang compiler in.
+	// Recompiles the shaders of the registered materials when their source changes,
+	// and rebuilds their pipelines on a worker thread, through the pipeline cache.
+	// Frames keep rendering with the old pipelines, until update() swaps in the new
+	// ones between two frames.
+	class shader_reloader
+	{
+	public:
+		// Sources are looked up in shader_dir, by the name of the SPIR-V of the
+		// materials: res/shaders/default.spv is compiled from <shader_dir>/default.slang.
+		shader_reloader(char const* shader_dir);
+		shader_reloader(shader_reloader const&) = delete;
+		shader_reloader(shader_reloader&&) = delete;
+		~shader_reloader();
+
+		shader_reloader& operator=(shader_reloader const&) = delete;
+		shader_reloader& operator=(shader_reloader&&) = delete;
+
+		void add(material& mat);
+		// Waits for the pending rebuild, if any.
+		void remove(material& mat);
+
+		// Swaps in the finished rebuilds, hands the replaced pipelines to the
+		// deletion queue, and starts rebuilding the changed shaders. Must be called
+		// once per frame, after the context prepared it and before recording it, so
+		// frames that fail to be prepared don't count.
+		void update();
+
+	private:
+		struct entry
+		{
+			material*  mat {nullptr};
+			mc::string source;
+		};
+
+		struct job
+		{
+			material*         mat {nullptr};
+			mc::string        path;
+			material::rebuild reb;
+			bool              built {false};
+		};
+
+		static void run(uint32_t idx, void* user);
+
+		void start();
+		void finish();
+
+		mc::string             dir_;
+		file_watcher           watcher_;
+		mc::vector<entry>      entries_;
+		mc::vector<mc::string> changed_;
+
+		// Owned by the worker while running_ is set.
+		slangrc::compiler* compiler_ {nullptr};
+		mc::vector<job>    jobs_;
+		thread::handle     worker_ {0};
+		bool               running_ {false};
+		uint32_t           done_ {0};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "staging_ring.hh"
+
+#include "../log.hh"
+#include "enum_string_helper.hh"
+#include "instance.hh"
+
+namespace vkb::vk
+{
+	staging_ring::staging_ring(uint64_t size)
+	: size_ {size}
+	{
+		instance& inst = instance::get();
+
+		buf_ = inst.create_buffer(size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                          mem_intent::dynamic_upload, mem_category::staging);
+		data_ = static_cast<uint8_t*>(buf_.data);
+
+		VkCommandPoolCreateInfo pool_info {};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		pool_info.queueFamilyIndex = inst.get_queue_indices().graphics;
+		VkResult res =
+			vkCreateCommandPool(inst.get_device(), &pool_info, nullptr, &cmd_pool_);
+		log::assert(res == VK_SUCCESS, "Failed to create staging command pool (%s)",
+		            string_VkResult(res));
+
+		VkSemaphoreTypeCreateInfo type_info {};
+		type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_info.initialValue = 0;
+		VkSemaphoreCreateInfo sem_info {};
+		sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		sem_info.pNext = &type_info;
+		res = vkCreateSemaphore(inst.get_device(), &sem_info, nullptr, &timeline_);
+		log::assert(res == VK_SUCCESS, "Failed to create staging semaphore (%s)",
+		            string_VkResult(res));
+	}
+
+	staging_ring::~staging_ring()
+	{
+		instance& inst = instance::get();
+
+		wait(value_);
+		reclaim();
+
+		vkDestroySemaphore(inst.get_device(), timeline_, nullptr);
+		vkDestroyCommandPool(inst.get_device(), cmd_pool_, nullptr);
+
+		inst.destroy_buffer(buf_);
+	}
+
+	staging_ring::region staging_ring::reserve(uint64_t size, uint64_t align)
+	{
+		reclaim();
+
+		if (size > size_)
+		{
+			log::warn("Staging ring too small for %llu bytes",
+			          static_cast<unsigned long long>(size));
+			return reserve_dedicated(size);
+		}
+
+		// Nothing in flight nor reserved, so the whole ring is free: starting over from
+		// its beginning lets reservations larger than its tail fit.
+		if (pending_.empty() && head_ == tail_)
+		{
+			head_ = 0;
+			tail_ = 0;
+		}
+
+		uint64_t pos = (head_ + align - 1) & ~(align - 1);
+		// Regions don't wrap, the end of the ring is skipped instead.
+		if (pos % size_ + size > size_)
+			pos = (pos / size_ + 1) * size_;
+
+		while (pos + size - tail_ > size_)
+		{
+			if (pending_.empty())
+			{
+				// Only reservations not submitted yet hold the ring.
+				log::warn("Staging ring full before submission");
+				return reserve_dedicated(size);
+			}
+
+			wait(pending_[0].value);
+			reclaim();
+		}
+
+		head_ = pos + size;
+
+		region reg;
+		reg.buffer = buf_.buffer;
+		reg.offset = pos % size_;
+		reg.data = data_ + reg.offset;
+		return reg;
+	}
+
+	staging_ring::region staging_ring::reserve_dedicated(uint64_t size)
+	{
+		instance& inst = instance::get();
+
+		// Read by the next submission.
+		dedicated ded;
+		ded.buf = inst.create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                             mem_intent::dynamic_upload, mem_category::staging);
+		ded.value = value_ + 1;
+		dedicated_.emplace_back(ded);
+
+		region reg;
+		reg.buffer = ded.buf.buffer;
+		reg.offset = 0;
+		reg.data = static_cast<uint8_t*>(ded.buf.data);
+		return reg;
+	}
+
+	VkCommandBuffer staging_ring::begin_commands()
+	{
+		instance& inst = instance::get();
+
+		VkCommandBufferAllocateInfo cmd_info {};
+		cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmd_info.commandPool = cmd_pool_;
+		cmd_info.commandBufferCount = 1;
+
+		VkCommandBuffer cmd {nullptr};
+		vkAllocateCommandBuffers(inst.get_device(), &cmd_info, &cmd);
+
+		VkCommandBufferBeginInfo begin {};
+		begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmd, &begin);
+
+		return cmd;
+	}
+
+	uint64_t staging_ring::submit(VkCommandBuffer cmd)
+	{
+		instance& inst = instance::get();
+
+		// The next submissions of the queue see the uploaded data, without waiting
+		// for this one.
+		VkMemoryBarrier barrier {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0,
+		                     nullptr, 0, nullptr);
+		vkEndCommandBuffer(cmd);
+
+		++value_;
+
+		VkTimelineSemaphoreSubmitInfo timeline_info {};
+		timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_info.signalSemaphoreValueCount = 1;
+		timeline_info.pSignalSemaphoreValues = &value_;
+
+		VkSubmitInfo submit {};
+		submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit.pNext = &timeline_info;
+		submit.commandBufferCount = 1;
+		submit.pCommandBuffers = &cmd;
+		submit.signalSemaphoreCount = 1;
+		submit.pSignalSemaphores = &timeline_;
+
+		VkResult res = vkQueueSubmit(inst.get_graphics_queue(), 1, &submit, nullptr);
+		if (res != VK_SUCCESS)
+			log::error("Failed to submit uploads (%s)", string_VkResult(res));
+
+		pending_.emplace_back(pending {head_, value_, cmd});
+		return value_;
+	}
+
+	void staging_ring::wait(uint64_t value)
+	{
+		if (!value)
+			return;
+
+		VkSemaphoreWaitInfo wait_info {};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &timeline_;
+		wait_info.pValues = &value;
+		vkWaitSemaphores(instance::get().get_device(), &wait_info, UINT64_MAX);
+	}
+
+	void staging_ring::reclaim()
+	{
+		instance& inst = instance::get();
+
+		uint64_t completed {0};
+		vkGetSemaphoreCounterValue(inst.get_device(), timeline_, &completed);
+
+		uint32_t done {0};
+		while (done < pending_.size() && pending_[done].value <= completed)
+		{
+			tail_ = pending_[done].end;
+			vkFreeCommandBuffers(inst.get_device(), cmd_pool_, 1, &pending_[done].cmd);
+			++done;
+		}
+
+		if (done)
+		{
+			for (uint32_t i {done}; i < pending_.size(); ++i)
+				pending_[i - done] = pending_[i];
+			pending_.resize(pending_.size() - done);
+		}
+
+		for (uint32_t i {0}; i < dedicated_.size();)
+		{
+			if (dedicated_[i].value <= completed)
+			{
+				inst.destroy_buffer(dedicated_[i].buf);
+				dedicated_[i] = dedicated_.back();
+				dedicated_.pop_back();
+			}
+			else
+				++i;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "buffer.hh"
+
+#include <vector.hh>
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Upload memory shared by all the loaders. A single persistently mapped buffer is
+	// used as a ring: reservations are made at its head, and released once the GPU
+	// completed the submission reading them, tracked by a timeline semaphore.
+	// Submissions don't wait on the CPU, they end with a barrier making the copies
+	// visible to the later commands of the queue.
+	class staging_ring
+	{
+	public:
+		struct region
+		{
+			VkBuffer buffer {nullptr};
+			uint64_t offset {0};
+			uint8_t* data {nullptr};
+		};
+
+		staging_ring(uint64_t size);
+		staging_ring(staging_ring const&) = delete;
+		staging_ring(staging_ring&&) = delete;
+		~staging_ring();
+
+		staging_ring& operator=(staging_ring const&) = delete;
+		staging_ring& operator=(staging_ring&&) = delete;
+
+		// Reserves size bytes, valid until the next submit() completes on the GPU.
+		// Waits for previous submissions when the ring is full. Falls back to a
+		// dedicated buffer when size doesn't fit in the ring.
+		region reserve(uint64_t size, uint64_t align = 16);
+
+		// Command buffer to record the copies from the reserved regions.
+		VkCommandBuffer begin_commands();
+		// Ends and submits cmd. Returns the timeline value signaled once it completes.
+		uint64_t        submit(VkCommandBuffer cmd);
+
+		// Waits until the submission signaling value completed.
+		void wait(uint64_t value);
+
+	private:
+		struct pending
+		{
+			// Ring position released once value is signaled.
+			uint64_t        end {0};
+			uint64_t        value {0};
+			VkCommandBuffer cmd {nullptr};
+		};
+
+		struct dedicated
+		{
+			buffer   buf;
+			uint64_t value {0};
+		};
+
+		region reserve_dedicated(uint64_t size);
+		// Releases the regions and buffers of the completed submissions.
+		void reclaim();
+
+		buffer   buf_;
+		uint8_t* data_ {nullptr};
+		uint64_t size_ {0};
+
+		// Positions in bytes since the creation or the last time the ring was idle,
+		// offsets are taken modulo size_.
+		uint64_t head_ {0};
+		uint64_t tail_ {0};
+
+		VkCommandPool         cmd_pool_ {nullptr};
+		VkSemaphore           timeline_ {nullptr};
+		uint64_t              value_ {0};
+		mc::vector<pending>   pending_;
+		mc::vector<dedicated> dedicated_;
+	};
+}
\ No newline at end of file
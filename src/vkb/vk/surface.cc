@@ -130,21 +130,12 @@ namespace vkb::vk
 			                        &swapchain_image_views_[i]);
 			log::assert(res == VK_SUCCESS, "Cannot create swapchain image view %u", i);
 		}
-
-		create_depth_resources();
 	}
 
 	void surface::destroy_swapchain()
 	{
 		instance& inst = instance::get();
 
-		if (depth_stencil_view_)
-			vkDestroyImageView(inst.get_device(), depth_stencil_view_, nullptr);
-
-		if (depth_stencil_.image && depth_stencil_.memory)
-			vmaDestroyImage(inst.get_allocator(), depth_stencil_.image,
-			                depth_stencil_.memory);
-
 		for (uint32_t i {0}; i < swapchain_image_views_.size(); ++i)
 			vkDestroyImageView(inst.get_device(), swapchain_image_views_[i], nullptr);
 
@@ -211,16 +202,6 @@ namespace vkb::vk
 		return swapchain_image_views_;
 	}
 
-	VkImage surface::get_depth_stencil() const
-	{
-		return depth_stencil_.image;
-	}
-
-	VkImageView surface::get_depth_stencil_view() const
-	{
-		return depth_stencil_view_;
-	}
-
 	VkSurfaceFormatKHR surface::choose_swap_format()
 	{
 		for (uint32_t i {0}; i < swapchain_support_.formats.size(); ++i)
@@ -265,30 +246,4 @@ namespace vkb::vk
 			return extent;
 		}
 	}
-
-	void surface::create_depth_resources()
-	{
-		instance& inst = instance::get();
-		VkFormat  depth_fmt =
-			inst.find_supported_format({VK_FORMAT_D32_SFLOAT}, VK_IMAGE_TILING_OPTIMAL,
-		                               VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
-		depth_stencil_ = inst.create_image(
-			swapchain_extent_.width, swapchain_extent_.height, 1, depth_fmt,
-			VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		depth_stencil_view_ = inst.create_image_view(depth_stencil_.image, depth_fmt,
-		                                             VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-
-		VkCommandBuffer cmd = inst.begin_commands();
-
-		inst.transition_image_layout(cmd, depth_stencil_.image, VK_IMAGE_LAYOUT_UNDEFINED,
-		                             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 0,
-		                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-		                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-		                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-		                             VK_IMAGE_ASPECT_DEPTH_BIT);
-		inst.end_commands(cmd);
-	}
 }
\ No newline at end of file
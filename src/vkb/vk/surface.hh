@@ -5,8 +5,6 @@
 
 #include "../win/window.hh"
 
-#include "image.hh"
-
 namespace vkb::vk
 {
 	class surface
@@ -36,16 +34,11 @@ namespace vkb::vk
 		mc::vector<VkImage> const&     get_images() const;
 		mc::vector<VkImageView> const& get_image_views() const;
 
-		VkImage     get_depth_stencil() const;
-		VkImageView get_depth_stencil_view() const;
-
 	private:
 		VkSurfaceFormatKHR choose_swap_format();
 		VkPresentModeKHR   choose_swap_present_mode();
 		VkExtent2D         choose_swap_extent();
 
-		void create_depth_resources();
-
 		window const& win_;
 
 		VkSurfaceKHR surface_ {nullptr};
@@ -56,8 +49,5 @@ namespace vkb::vk
 		VkExtent2D              swapchain_extent_;
 		mc::vector<VkImage>     swapchain_images_;
 		mc::vector<VkImageView> swapchain_image_views_;
-
-		image       depth_stencil_;
-		VkImageView depth_stencil_view_ {nullptr};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "texture_pool.hh"
+
+#include "../core/pack.hh"
+#include "../log.hh"
+#include "instance.hh"
+#include "staging_ring.hh"
+
+#include <stb/stb_image.h>
+
+#include <math.h>
+#include <string.h>
+
+namespace vkb::vk
+{
+	namespace
+	{
+		constexpr VkFormat pool_format {VK_FORMAT_R8G8B8A8_SRGB};
+
+		// Gap left around atlas rects, so linear filtering doesn't sample neighbours.
+		constexpr uint32_t atlas_padding {1};
+
+		void layer_barrier(VkCommandBuffer cmd, VkImage img, uint32_t layer,
+		                   uint32_t base_mip, uint32_t mip_cnt, VkImageLayout old_layout,
+		                   VkImageLayout new_layout, VkAccessFlags src_access,
+		                   VkAccessFlags dst_access, VkPipelineStageFlags src_stage,
+		                   VkPipelineStageFlags dst_stage)
+		{
+			VkImageMemoryBarrier barrier {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = old_layout;
+			barrier.newLayout = new_layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = img;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = base_mip;
+			barrier.subresourceRange.levelCount = mip_cnt;
+			barrier.subresourceRange.baseArrayLayer = layer;
+			barrier.subresourceRange.layerCount = 1;
+			barrier.srcAccessMask = src_access;
+			barrier.dstAccessMask = dst_access;
+
+			vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1,
+			                     &barrier);
+		}
+	}
+
+	texture_pool::texture_pool(mode pool_mode, uint32_t w, uint32_t h,
+	                           uint32_t layer_cnt)
+	: mode_ {pool_mode}
+	, w_ {w}
+	, h_ {h}
+	, layer_cnt_ {layer_cnt}
+	{
+		instance& inst = instance::get();
+
+		tex_.mip_lvl = mode_ == mode::array ? floor(log2(w > h ? w : h)) + 1 : 1;
+		tex_.img = inst.create_image(
+			w_, h_, tex_.mip_lvl, pool_format, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+				VK_IMAGE_USAGE_SAMPLED_BIT,
+			mem_intent::gpu_static, mem_category::textures, layer_cnt_);
+		tex_.img_view =
+			inst.create_image_view(tex_.img.image, pool_format, VK_IMAGE_ASPECT_COLOR_BIT,
+		                           tex_.mip_lvl, VK_IMAGE_VIEW_TYPE_2D_ARRAY, layer_cnt_);
+
+		// Unused layers still need a valid layout to be sampled.
+		VkCommandBuffer cmd = inst.begin_commands();
+		inst.transition_image_layout(
+			cmd, tex_.img.image, VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT, tex_.mip_lvl, layer_cnt_);
+		inst.end_commands(cmd);
+
+		VkSamplerAddressMode address_mode = mode_ == mode::array
+		                                        ? VK_SAMPLER_ADDRESS_MODE_REPEAT
+		                                        : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+		VkSamplerCreateInfo sampler {};
+		sampler.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler.magFilter = VK_FILTER_NEAREST;
+		sampler.minFilter = VK_FILTER_NEAREST;
+		sampler.addressModeU = address_mode;
+		sampler.addressModeV = address_mode;
+		sampler.addressModeW = address_mode;
+		sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		sampler.minLod = 0.f;
+		sampler.maxLod = VK_LOD_CLAMP_NONE;
+		sampler.mipLodBias = 0.f;
+
+		sampler.anisotropyEnable = VK_TRUE;
+		sampler.maxAnisotropy = inst.get_device_properties().limits.maxSamplerAnisotropy;
+
+		sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+		sampler.unnormalizedCoordinates = VK_FALSE;
+		sampler.compareEnable = VK_FALSE;
+		sampler.compareOp = VK_COMPARE_OP_ALWAYS;
+
+		tex_.sampler = inst.get_sampler(sampler);
+		log::assert(tex_.sampler, "Failed to create texture pool sampler");
+	}
+
+	texture_pool::~texture_pool()
+	{
+		instance& inst = instance::get();
+
+		vkDestroyImageView(inst.get_device(), tex_.img_view, nullptr);
+		inst.destroy_image(tex_.img);
+	}
+
+	uint32_t texture_pool::add(mc::string_view path)
+	{
+		pack::resource file;
+		int32_t        w, h, c;
+		uint8_t*       pix {nullptr};
+		if (pack::get().load(path, file))
+			pix = stbi_load_from_memory(file.data, file.size, &w, &h, &c, STBI_rgb_alpha);
+		if (!pix)
+		{
+			log::error("Failed to load pooled texture %s", path.data());
+			return UINT32_MAX;
+		}
+
+		uint32_t idx = add(pix, w, h);
+		stbi_image_free(pix);
+
+		return idx;
+	}
+
+	uint32_t texture_pool::add(uint8_t const* pixels, uint32_t w, uint32_t h)
+	{
+		uint32_t layer, x, y;
+		if (mode_ == mode::array)
+		{
+			if (w != w_ || h != h_)
+			{
+				log::error("Pooled texture size %ux%u does not match layer size %ux%u", w,
+				           h, w_, h_);
+				return UINT32_MAX;
+			}
+
+			if (used_layers_ == layer_cnt_)
+			{
+				log::error("Texture pool is full");
+				return UINT32_MAX;
+			}
+
+			layer = used_layers_++;
+			x = 0;
+			y = 0;
+		}
+		else if (!alloc_rect(w, h, layer, x, y))
+		{
+			log::error("No room left in texture atlas for %ux%u texture", w, h);
+			return UINT32_MAX;
+		}
+
+		upload(pixels, w, h, layer, x, y);
+
+		slot& s = slots_.emplace_back();
+		s.layer = layer;
+		s.uv_rect = {x / static_cast<float>(w_), y / static_cast<float>(h_),
+		             w / static_cast<float>(w_), h / static_cast<float>(h_)};
+
+		return slots_.size() - 1;
+	}
+
+	texture_pool::slot const& texture_pool::get_slot(uint32_t idx) const
+	{
+		return slots_[idx];
+	}
+
+	texture const& texture_pool::get_texture() const
+	{
+		return tex_;
+	}
+
+	bool texture_pool::alloc_rect(uint32_t w, uint32_t h, uint32_t& layer, uint32_t& x,
+	                              uint32_t& y)
+	{
+		uint32_t pad_w = w + atlas_padding * 2;
+		uint32_t pad_h = h + atlas_padding * 2;
+		if (pad_w > w_ || pad_h > h_)
+			return false;
+
+		// Shortest shelf the rect fits in, to limit the wasted height.
+		shelf* best {nullptr};
+		for (uint32_t i {0}; i < shelves_.size(); ++i)
+		{
+			shelf& s = shelves_[i];
+			if (s.h >= pad_h && s.x + pad_w <= w_ && (!best || s.h < best->h))
+				best = &s;
+		}
+
+		if (!best)
+		{
+			uint32_t top {0};
+			if (used_layers_ && !shelves_.empty())
+			{
+				shelf const& last = shelves_.back();
+				top = last.y + last.h;
+			}
+
+			if (!used_layers_ || top + pad_h > h_)
+			{
+				if (used_layers_ == layer_cnt_)
+					return false;
+
+				++used_layers_;
+				top = 0;
+			}
+
+			best = &shelves_.emplace_back();
+			best->layer = used_layers_ - 1;
+			best->y = top;
+			best->h = pad_h;
+		}
+
+		layer = best->layer;
+		x = best->x + atlas_padding;
+		y = best->y + atlas_padding;
+		best->x += pad_w;
+
+		return true;
+	}
+
+	void texture_pool::upload(uint8_t const* pixels, uint32_t w, uint32_t h,
+	                          uint32_t layer, uint32_t x, uint32_t y)
+	{
+		instance& inst = instance::get();
+
+		uint64_t             size = static_cast<uint64_t>(w) * h * 4;
+		staging_ring&        ring = inst.get_staging_ring();
+		staging_ring::region staging = ring.reserve(size);
+		memcpy(staging.data, pixels, size);
+
+		VkCommandBuffer cmd = ring.begin_commands();
+
+		// Other rects of the layer are kept, hence the transition from the current
+		// layout.
+		layer_barrier(cmd, tex_.img.image, layer, 0, tex_.mip_lvl,
+		              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+		              VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		              VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		VkBufferImageCopy2 copy {};
+		copy.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+		copy.bufferOffset = staging.offset;
+		copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copy.imageSubresource.baseArrayLayer = layer;
+		copy.imageSubresource.layerCount = 1;
+		copy.imageOffset = {static_cast<int32_t>(x), static_cast<int32_t>(y), 0};
+		copy.imageExtent = {w, h, 1};
+
+		VkCopyBufferToImageInfo2 info {};
+		info.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2;
+		info.srcBuffer = staging.buffer;
+		info.dstImage = tex_.img.image;
+		info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		info.regionCount = 1;
+		info.pRegions = &copy;
+		vkCmdCopyBufferToImage2(cmd, &info);
+
+		// Only array layers have mips, each one filling the whole layer.
+		int32_t mip_w = w;
+		int32_t mip_h = h;
+		for (uint32_t i {1}; i < tex_.mip_lvl; ++i)
+		{
+			layer_barrier(cmd, tex_.img.image, layer, i - 1, 1,
+			              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			              VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+			VkImageBlit blit {};
+			blit.srcOffsets[1] = {mip_w, mip_h, 1};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = i - 1;
+			blit.srcSubresource.baseArrayLayer = layer;
+			blit.srcSubresource.layerCount = 1;
+
+			if (mip_w > 1)
+				mip_w /= 2;
+			if (mip_h > 1)
+				mip_h /= 2;
+
+			blit.dstOffsets[1] = {mip_w, mip_h, 1};
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = i;
+			blit.dstSubresource.baseArrayLayer = layer;
+			blit.dstSubresource.layerCount = 1;
+
+			vkCmdBlitImage(cmd, tex_.img.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			               tex_.img.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+			               VK_FILTER_LINEAR);
+
+			layer_barrier(cmd, tex_.img.image, layer, i - 1, 1,
+			              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			              VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+			              VK_PIPELINE_STAGE_TRANSFER_BIT,
+			              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		}
+
+		layer_barrier(cmd, tex_.img.image, layer, tex_.mip_lvl - 1, 1,
+		              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		              VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		              VK_PIPELINE_STAGE_TRANSFER_BIT,
+		              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+		ring.submit(cmd);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../math/vec4.hh"
+#include "assets/texture.hh"
+
+#include <string_view.hh>
+#include <vector.hh>
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Packs textures into the layers of a single 2D array image, sharing one view and
+	// sampler, so objects using different textures can be drawn with the same
+	// descriptors.
+	// In array mode, each texture takes a whole layer and must match the layer size.
+	// In atlas mode, smaller textures are packed in shelves within the layers, and
+	// addressed through their UV rect. Atlas layers have no mips, to avoid bleeding
+	// between neighbours, and can't be sampled with repeat addressing: shaders wrap
+	// their UVs within the rect instead.
+	class texture_pool
+	{
+	public:
+		enum class mode : uint8_t
+		{
+			array,
+			atlas,
+		};
+
+		struct slot
+		{
+			uint32_t layer {0};
+			// Offset in xy, scale in zw.
+			vec4 uv_rect {0.f, 0.f, 1.f, 1.f};
+		};
+
+		texture_pool(mode pool_mode, uint32_t w, uint32_t h, uint32_t layer_cnt);
+		texture_pool(texture_pool const&) = delete;
+		texture_pool(texture_pool&&) = delete;
+		~texture_pool();
+
+		texture_pool& operator=(texture_pool const&) = delete;
+		texture_pool& operator=(texture_pool&&) = delete;
+
+		// Returns the slot index of the texture, UINT32_MAX if it could not be loaded
+		// or the pool is full.
+		uint32_t add(mc::string_view path);
+		uint32_t add(uint8_t const* pixels, uint32_t w, uint32_t h);
+
+		slot const&    get_slot(uint32_t idx) const;
+		texture const& get_texture() const;
+
+	private:
+		struct shelf
+		{
+			uint32_t layer {0};
+			uint32_t y {0};
+			uint32_t h {0};
+			uint32_t x {0};
+		};
+
+		bool alloc_rect(uint32_t w, uint32_t h, uint32_t& layer, uint32_t& x,
+		                uint32_t& y);
+		void upload(uint8_t const* pixels, uint32_t w, uint32_t h, uint32_t layer,
+		            uint32_t x, uint32_t y);
+
+		mode     mode_;
+		uint32_t w_ {0};
+		uint32_t h_ {0};
+		uint32_t layer_cnt_ {0};
+		uint32_t used_layers_ {0};
+
+		texture           tex_;
+		mc::vector<slot>  slots_;
+		mc::vector<shelf> shelves_;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,524 @@
+#include "texture_streamer.hh"
+
+#include "../core/pack.hh"
+#include "../log.hh"
+#include "assets/texture.hh"
+#include "deletion_queue.hh"
+#include "instance.hh"
+#include "staging_ring.hh"
+
+#include <stb/stb_image.h>
+
+#include <math.h>
+#include <string.h>
+
+namespace vkb::vk
+{
+	namespace
+	{
+		constexpr VkFormat stream_format {VK_FORMAT_R8G8B8A8_SRGB};
+
+		// Levels whose sides are all under this size are uploaded when the texture is
+		// added.
+		constexpr uint32_t tail_size {64};
+
+		// Enough for a 32768x32768 texture.
+		constexpr uint32_t max_lvl_cnt {16};
+
+		uint32_t lvl_dim(uint32_t dim, uint32_t lvl)
+		{
+			dim >>= lvl;
+			return dim ? dim : 1;
+		}
+
+		// 2x2 box filter, clamping on odd sizes.
+		void downsample(uint8_t const* src, uint32_t src_w, uint32_t src_h, uint8_t* dst,
+		                uint32_t dst_w, uint32_t dst_h)
+		{
+			for (uint32_t y {0}; y < dst_h; ++y)
+			{
+				uint32_t y0 = y * 2 < src_h ? y * 2 : src_h - 1;
+				uint32_t y1 = y * 2 + 1 < src_h ? y * 2 + 1 : src_h - 1;
+				for (uint32_t x {0}; x < dst_w; ++x)
+				{
+					uint32_t x0 = x * 2 < src_w ? x * 2 : src_w - 1;
+					uint32_t x1 = x * 2 + 1 < src_w ? x * 2 + 1 : src_w - 1;
+					for (uint32_t c {0}; c < 4; ++c)
+					{
+						uint32_t sum = src[(y0 * src_w + x0) * 4 + c] +
+						               src[(y0 * src_w + x1) * 4 + c] +
+						               src[(y1 * src_w + x0) * 4 + c] +
+						               src[(y1 * src_w + x1) * 4 + c];
+						dst[(y * dst_w + x) * 4 + c] =
+							static_cast<uint8_t>((sum + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+
+	texture_streamer::texture_streamer(handle_pool<texture>& textures, uint64_t budget,
+	                                   uint64_t upload_per_frame)
+	: textures_ {textures}
+	, budget_ {budget}
+	, upload_per_frame_ {upload_per_frame}
+	{}
+
+	texture_streamer::~texture_streamer()
+	{
+		instance& inst = instance::get();
+
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+		{
+			if (entries_[i].loading)
+				finish_load(entries_[i]);
+
+			texture& tex = tex_of(entries_[i]);
+			if (tex.img_view)
+				vkDestroyImageView(inst.get_device(), tex.img_view, nullptr);
+			if (tex.img.image && tex.img.memory)
+				inst.destroy_image(tex.img);
+		}
+	}
+
+	bool texture_streamer::add(texture_handle handle, mc::string_view path)
+	{
+		instance& inst = instance::get();
+
+		texture* tex = textures_.get(handle);
+		if (!tex)
+			return false;
+
+		// Only the header is read here, decoding the whole image would stall the
+		// frame adding the texture.
+		load_job* job = new load_job;
+		int32_t   w, h, c;
+		if (!pack::get().load(path, job->file) ||
+		    !stbi_info_from_memory(job->file.data, job->file.size, &w, &h, &c))
+		{
+			delete job;
+			return false;
+		}
+
+		entry& e = entries_.emplace_back();
+		e.tex = handle;
+		e.w = w;
+		e.h = h;
+		e.lvl_cnt = floor(log2(w > h ? w : h)) + 1;
+		log::assert(e.lvl_cnt <= max_lvl_cnt, "Texture too large to be streamed: %s",
+		            path.data());
+
+		e.lvl_offs.resize(e.lvl_cnt + 1);
+		uint64_t size {0};
+		for (uint32_t i {0}; i < e.lvl_cnt; ++i)
+		{
+			e.lvl_offs[i] = size;
+			size += lvl_dim(e.w, i) * lvl_dim(e.h, i) * 4;
+		}
+		e.lvl_offs[e.lvl_cnt] = size;
+
+		VkSamplerCreateInfo sampler {};
+		sampler.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		sampler.magFilter = VK_FILTER_NEAREST;
+		sampler.minFilter = VK_FILTER_NEAREST;
+		sampler.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		sampler.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		sampler.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		// Levels are relative to the resident part of the chain, which always starts at
+		// the view first level.
+		sampler.minLod = 0.f;
+		sampler.maxLod = VK_LOD_CLAMP_NONE;
+		sampler.mipLodBias = 0.f;
+
+		sampler.anisotropyEnable = VK_TRUE;
+		sampler.maxAnisotropy = inst.get_device_properties().limits.maxSamplerAnisotropy;
+
+		sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+		sampler.unnormalizedCoordinates = VK_FALSE;
+		sampler.compareEnable = VK_FALSE;
+		sampler.compareOp = VK_COMPARE_OP_ALWAYS;
+
+		tex->sampler = inst.get_sampler(sampler);
+		if (!tex->sampler)
+		{
+			entries_.pop_back();
+			delete job;
+			return false;
+		}
+
+		// Not drawn until update() uploads its first levels.
+		tex->img = {};
+		tex->img_view = nullptr;
+		tex->mip_lvl = 0;
+		tex->base_lvl = e.lvl_cnt;
+
+		job->w = e.w;
+		job->h = e.h;
+		job->lvl_cnt = e.lvl_cnt;
+		job->size = size;
+		if (!thread::start(job->worker, load, job))
+		{
+			log::error("Failed to start the loading thread of %s", path.data());
+			entries_.pop_back();
+			delete job;
+			return false;
+		}
+		e.loading = job;
+
+		return true;
+	}
+
+	void texture_streamer::load(uint32_t, void* user)
+	{
+		load_job& job = *static_cast<load_job*>(user);
+
+		int32_t  w, h, c;
+		uint8_t* pix = stbi_load_from_memory(job.file.data, job.file.size, &w, &h, &c,
+		                                     STBI_rgb_alpha);
+		job.failed = !pix || static_cast<uint32_t>(w) != job.w ||
+		             static_cast<uint32_t>(h) != job.h;
+		if (!job.failed)
+		{
+			job.pixels.resize(job.size);
+			memcpy(job.pixels.data(), pix, job.w * job.h * 4);
+
+			uint64_t off {0};
+			for (uint32_t i {1}; i < job.lvl_cnt; ++i)
+			{
+				uint64_t next = off + lvl_dim(job.w, i - 1) * lvl_dim(job.h, i - 1) * 4;
+				downsample(job.pixels.data() + off, lvl_dim(job.w, i - 1),
+				           lvl_dim(job.h, i - 1), job.pixels.data() + next,
+				           lvl_dim(job.w, i), lvl_dim(job.h, i));
+				off = next;
+			}
+		}
+		if (pix)
+			stbi_image_free(pix);
+
+		__atomic_store_n(&job.done, 1, __ATOMIC_RELEASE);
+	}
+
+	bool texture_streamer::finish_load(entry& e)
+	{
+		load_job* job = e.loading;
+		thread::join(job->worker);
+
+		bool loaded = !job->failed;
+		if (loaded)
+			e.pixels = static_cast<mc::vector<uint8_t>&&>(job->pixels);
+
+		e.loading = nullptr;
+		delete job;
+		return loaded;
+	}
+
+	bool texture_streamer::remove(texture_handle handle)
+	{
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+		{
+			if (entries_[i].tex != handle)
+				continue;
+
+			// Waits for the decoding, the thread can't be cancelled.
+			if (entries_[i].loading)
+				finish_load(entries_[i]);
+
+			texture& tex = tex_of(entries_[i]);
+			instance::get().get_deletion_queue().destroy(tex.img, tex.img_view);
+			tex.img = {};
+			tex.img_view = nullptr;
+			tex.sampler = nullptr;
+			tex.mip_lvl = 0;
+
+			if (i != entries_.size() - 1)
+				entries_[i] = static_cast<entry&&>(entries_.back());
+			entries_.pop_back();
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void texture_streamer::set_screen_size(texture_handle tex, float pixels)
+	{
+		entry* e = find(tex);
+		if (e && pixels > e->screen_size)
+			e->screen_size = pixels;
+	}
+
+	void texture_streamer::set_budget(uint64_t budget)
+	{
+		budget_ = budget;
+	}
+
+	uint64_t texture_streamer::resident_size() const
+	{
+		uint64_t size {0};
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+		{
+			entry const& e = entries_[i];
+			uint32_t     base_lvl = tex_of(e).base_lvl;
+			if (base_lvl < e.lvl_cnt)
+				size += e.lvl_offs[e.lvl_cnt] - e.lvl_offs[base_lvl];
+		}
+
+		return size;
+	}
+
+	void texture_streamer::update()
+	{
+		// Recorded lazily, most updates have nothing to do.
+		staging_ring&   ring = instance::get().get_staging_ring();
+		VkCommandBuffer cmd {nullptr};
+
+		// Textures done decoding get their tail first, so they can be sampled.
+		uint32_t i {0};
+		while (i < entries_.size())
+		{
+			entry& e = entries_[i];
+			if (!e.loading || !__atomic_load_n(&e.loading->done, __ATOMIC_ACQUIRE))
+			{
+				++i;
+				continue;
+			}
+
+			if (!finish_load(e))
+			{
+				log::error("Failed to decode streamed texture");
+				tex_of(e).sampler = nullptr;
+				if (i != entries_.size() - 1)
+					entries_[i] = static_cast<entry&&>(entries_.back());
+				entries_.pop_back();
+				continue;
+			}
+
+			uint32_t first = e.lvl_cnt - 1;
+			while (first > 0 && lvl_dim(e.w, first - 1) <= tail_size &&
+			       lvl_dim(e.h, first - 1) <= tail_size)
+				--first;
+
+			uint64_t             tail = e.lvl_offs[e.lvl_cnt] - e.lvl_offs[first];
+			staging_ring::region staging = ring.reserve(tail);
+			memcpy(staging.data, e.pixels.data() + e.lvl_offs[first], tail);
+			if (!cmd)
+				cmd = ring.begin_commands();
+			resize(cmd, e, first, e.lvl_cnt, staging.buffer, staging.offset);
+			++i;
+		}
+
+		select_levels();
+
+		// Evictions first, they only need GPU copies and release memory for the uploads.
+		for (i = 0; i < entries_.size(); ++i)
+		{
+			entry& e = entries_[i];
+			if (e.loading)
+				continue;
+			if (e.wanted_lvl > tex_of(e).base_lvl)
+			{
+				if (!cmd)
+					cmd = ring.begin_commands();
+				resize(cmd, e, e.wanted_lvl, e.wanted_lvl, nullptr, 0);
+			}
+		}
+
+		uint64_t used {0};
+		for (i = 0; i < entries_.size(); ++i)
+		{
+			entry& e = entries_[i];
+			uint32_t base_lvl = tex_of(e).base_lvl;
+			if (e.loading || e.wanted_lvl >= base_lvl)
+				continue;
+
+			// One level per texture and per frame, finer levels being 4 times larger.
+			uint32_t lvl = base_lvl - 1;
+			uint64_t size = e.lvl_offs[lvl + 1] - e.lvl_offs[lvl];
+			if (used && used + size > upload_per_frame_)
+				break;
+
+			staging_ring::region staging = ring.reserve(size);
+			memcpy(staging.data, e.pixels.data() + e.lvl_offs[lvl], size);
+			if (!cmd)
+				cmd = ring.begin_commands();
+			resize(cmd, e, lvl, lvl + 1, staging.buffer, staging.offset);
+			used += size;
+		}
+
+		if (cmd)
+			ring.submit(cmd);
+
+		for (i = 0; i < entries_.size(); ++i)
+			entries_[i].screen_size = 0.f;
+	}
+
+	texture_streamer::entry* texture_streamer::find(texture_handle tex)
+	{
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+			if (entries_[i].tex == tex)
+				return &entries_[i];
+
+		return nullptr;
+	}
+
+	texture& texture_streamer::tex_of(entry const& e) const
+	{
+		// Entries are removed with their texture, their handles stay alive.
+		return *textures_.get(e.tex);
+	}
+
+	void texture_streamer::select_levels()
+	{
+		// Textures still loading have nothing resident, nor anything to upload.
+		uint64_t total {0};
+		for (uint32_t i {0}; i < entries_.size(); ++i)
+		{
+			entry& e = entries_[i];
+			if (e.loading)
+				continue;
+
+			uint32_t max_dim = e.w > e.h ? e.w : e.h;
+			uint32_t lvl {0};
+			if (e.screen_size > 0.f && max_dim > e.screen_size)
+				lvl = floorf(log2f(max_dim / e.screen_size));
+			if (lvl >= e.lvl_cnt)
+				lvl = e.lvl_cnt - 1;
+
+			e.wanted_lvl = lvl;
+			total += e.lvl_offs[e.lvl_cnt] - e.lvl_offs[lvl];
+		}
+
+		// Over budget, drop the level with the most texels per screen pixel until it
+		// fits.
+		while (total > budget_)
+		{
+			entry* victim {nullptr};
+			float  victim_density {0.f};
+			for (uint32_t i {0}; i < entries_.size(); ++i)
+			{
+				entry& e = entries_[i];
+				if (e.loading || e.wanted_lvl + 1 >= e.lvl_cnt)
+					continue;
+
+				uint32_t max_dim = e.w > e.h ? e.w : e.h;
+				float    screen = e.screen_size > 0.f ? e.screen_size : max_dim;
+				float    density = lvl_dim(max_dim, e.wanted_lvl) / screen;
+				if (!victim || density > victim_density)
+				{
+					victim = &e;
+					victim_density = density;
+				}
+			}
+
+			if (!victim)
+				break;
+
+			total -= victim->lvl_offs[victim->wanted_lvl + 1] -
+			         victim->lvl_offs[victim->wanted_lvl];
+			++victim->wanted_lvl;
+		}
+	}
+
+	void texture_streamer::resize(VkCommandBuffer cmd, entry& e, uint32_t new_base,
+	                              uint32_t upload_end, VkBuffer staging_buf,
+	                              uint64_t staging_off)
+	{
+		instance& inst = instance::get();
+		texture&  tex = tex_of(e);
+
+		uint32_t lvl_cnt = e.lvl_cnt - new_base;
+		image    img = inst.create_image(lvl_dim(e.w, new_base), lvl_dim(e.h, new_base),
+		                                 lvl_cnt, stream_format, VK_IMAGE_TILING_OPTIMAL,
+		                                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+		                                     VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+		                                     VK_IMAGE_USAGE_SAMPLED_BIT,
+		                                 mem_intent::gpu_static, mem_category::textures);
+
+		inst.transition_image_layout(
+			cmd, img.image, VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT, lvl_cnt);
+
+		if (upload_end > new_base)
+		{
+			VkBufferImageCopy2 regions[max_lvl_cnt] {};
+			for (uint32_t i {new_base}; i < upload_end; ++i)
+			{
+				VkBufferImageCopy2& region = regions[i - new_base];
+				region.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+				region.bufferOffset = staging_off + e.lvl_offs[i] - e.lvl_offs[new_base];
+				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.imageSubresource.mipLevel = i - new_base;
+				region.imageSubresource.layerCount = 1;
+				region.imageExtent = {lvl_dim(e.w, i), lvl_dim(e.h, i), 1};
+			}
+
+			VkCopyBufferToImageInfo2 info {};
+			info.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2;
+			info.srcBuffer = staging_buf;
+			info.dstImage = img.image;
+			info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			info.regionCount = upload_end - new_base;
+			info.pRegions = regions;
+			vkCmdCopyBufferToImage2(cmd, &info);
+		}
+
+		if (tex.img.image)
+		{
+			inst.transition_image_layout(
+				cmd, tex.img.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, tex.mip_lvl);
+
+			VkImageCopy2 regions[max_lvl_cnt] {};
+			for (uint32_t i {upload_end}; i < e.lvl_cnt; ++i)
+			{
+				VkImageCopy2& region = regions[i - upload_end];
+				region.sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2;
+				region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.srcSubresource.mipLevel = i - tex.base_lvl;
+				region.srcSubresource.layerCount = 1;
+				region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.dstSubresource.mipLevel = i - new_base;
+				region.dstSubresource.layerCount = 1;
+				region.extent = {lvl_dim(e.w, i), lvl_dim(e.h, i), 1};
+			}
+
+			VkCopyImageInfo2 info {};
+			info.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2;
+			info.srcImage = tex.img.image;
+			info.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			info.dstImage = img.image;
+			info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			info.regionCount = e.lvl_cnt - upload_end;
+			info.pRegions = regions;
+			vkCmdCopyImage2(cmd, &info);
+
+			// Frames still referencing the old image sample it until they refresh their
+			// descriptors.
+			inst.transition_image_layout(
+				cmd, tex.img.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+				VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+				tex.mip_lvl);
+
+			inst.get_deletion_queue().destroy(tex.img, tex.img_view);
+		}
+
+		inst.transition_image_layout(
+			cmd, img.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_ASPECT_COLOR_BIT, lvl_cnt);
+
+		tex.img = img;
+		tex.img_view = inst.create_image_view(img.image, stream_format,
+		                                      VK_IMAGE_ASPECT_COLOR_BIT, lvl_cnt);
+		tex.mip_lvl = lvl_cnt;
+		tex.base_lvl = new_base;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "../core/handle.hh"
+#include "../core/pack.hh"
+#include "../core/thread.hh"
+#include "assets/texture.hh"
+
+#include <string_view.hh>
+#include <vector.hh>
+
+#include "vma/vma.hh"
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Streams textures level by level, coarsest levels first. Only the resident levels
+	// are allocated on the GPU: the image is reallocated each time levels are streamed
+	// in or evicted, which keeps the resident size under the budget. The level wanted
+	// for each texture depends on its size on screen.
+	class texture_streamer
+	{
+	public:
+		// The streamed textures are stored in textures, which must outlive the streamer.
+		texture_streamer(handle_pool<texture>& textures, uint64_t budget,
+		                 uint64_t upload_per_frame);
+		texture_streamer(texture_streamer const&) = delete;
+		texture_streamer(texture_streamer&&) = delete;
+		~texture_streamer();
+
+		texture_streamer& operator=(texture_streamer const&) = delete;
+		texture_streamer& operator=(texture_streamer&&) = delete;
+
+		// Reads the texture size, then decodes it and builds its levels on a worker
+		// thread. The texture has no image until update() picks up the decoded levels
+		// and uploads its smallest ones, finer levels following in the next updates.
+		bool add(texture_handle tex, mc::string_view path);
+		bool remove(texture_handle tex);
+
+		// Size in pixels covered on screen by the texture for the current frame. The
+		// largest size set between two updates is kept. Textures without size are
+		// streamed up to their full resolution.
+		void set_screen_size(texture_handle tex, float pixels);
+
+		void     set_budget(uint64_t budget);
+		uint64_t resident_size() const;
+
+		// Uploads the smallest levels of the textures done decoding, evicts levels above
+		// the budget, then uploads the next wanted levels through the staging ring.
+		// Submitted right away, before the commands of the frame.
+		void update();
+
+	private:
+		// Decoding of a texture on its own thread. pixels and failed are only read once
+		// done is set.
+		struct load_job
+		{
+			pack::resource      file;
+			uint32_t            w {0};
+			uint32_t            h {0};
+			uint32_t            lvl_cnt {0};
+			uint64_t            size {0};
+			mc::vector<uint8_t> pixels;
+			bool                failed {false};
+			uint32_t            done {0};
+			thread::handle      worker {0};
+		};
+
+		struct entry
+		{
+			texture_handle tex;
+			uint32_t       w {0};
+			uint32_t       h {0};
+			uint32_t       lvl_cnt {0};
+			uint32_t       wanted_lvl {0};
+			float          screen_size {0.f};
+
+			// Full mip chain, finest level first, tightly packed. Empty while loading.
+			mc::vector<uint8_t>  pixels;
+			mc::vector<uint64_t> lvl_offs;
+			load_job*            loading {nullptr};
+		};
+
+		static void load(uint32_t idx, void* user);
+		// Joins the loading thread. Returns false if the decoding failed.
+		static bool finish_load(entry& e);
+
+		entry*   find(texture_handle tex);
+		texture& tex_of(entry const& e) const;
+
+		void select_levels();
+		void resize(VkCommandBuffer cmd, entry& e, uint32_t new_base, uint32_t upload_end,
+		            VkBuffer staging_buf, uint64_t staging_off);
+
+		handle_pool<texture>& textures_;
+
+		uint64_t budget_ {0};
+		uint64_t upload_per_frame_ {0};
+
+		mc::vector<entry> entries_;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "uniform_arena.hh"
+
+#include "../core/frames.hh"
+#include "../log.hh"
+#include "instance.hh"
+
+namespace vkb::vk
+{
+	uniform_arena::uniform_arena(uint64_t frame_size)
+	{
+		instance& inst = instance::get();
+
+		align_ = inst.get_device_properties().limits.minUniformBufferOffsetAlignment;
+		frame_size_ = (frame_size + align_ - 1) & ~(align_ - 1);
+
+		buf_ = inst.create_buffer(frame_size_ * max_frames_in_flight,
+		                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		                          mem_intent::dynamic_upload, mem_category::uniforms);
+		data_ = static_cast<uint8_t*>(buf_.data);
+	}
+
+	uniform_arena::~uniform_arena()
+	{
+		instance::get().destroy_buffer(buf_);
+	}
+
+	void uniform_arena::begin_frame(uint32_t frame_idx)
+	{
+		log::assert(frame_idx < max_frames_in_flight, "Frame %u not in flight",
+		            frame_idx);
+		frame_off_ = frame_size_ * frame_idx;
+		used_ = 0;
+	}
+
+	uint32_t uniform_arena::alloc(uint32_t size, void*& data)
+	{
+		if (used_ + size > frame_size_)
+		{
+			log::error("Uniform arena full, %llu bytes per frame",
+			           static_cast<unsigned long long>(frame_size_));
+			return UINT32_MAX;
+		}
+
+		uint64_t off = frame_off_ + used_;
+		used_ = (used_ + size + align_ - 1) & ~(align_ - 1);
+
+		data = data_ + off;
+		return static_cast<uint32_t>(off);
+	}
+
+	VkBuffer uniform_arena::get_buffer() const
+	{
+		return buf_.buffer;
+	}
+}
\ No newline at end of file
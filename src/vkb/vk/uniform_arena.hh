@@ -0,0 +1,44 @@
+#pragma once
+
+#include "buffer.hh"
+
+#include <vulkan/vulkan.h>
+
+#include <stdint.h>
+
+namespace vkb::vk
+{
+	// Uniform data written by the CPU for each frame. A single persistently mapped
+	// buffer is split in one region per frame in flight, allocated linearly and reset
+	// when the frame is recorded again. It is bound as dynamic uniform buffers, so the
+	// descriptor sets pointing to it never change.
+	class uniform_arena
+	{
+	public:
+		uniform_arena(uint64_t frame_size);
+		uniform_arena(uniform_arena const&) = delete;
+		uniform_arena(uniform_arena&&) = delete;
+		~uniform_arena();
+
+		uniform_arena& operator=(uniform_arena const&) = delete;
+		uniform_arena& operator=(uniform_arena&&) = delete;
+
+		// frame_idx is the frame in flight, in [0, max_frames_in_flight), and its
+		// previous submission must have completed.
+		void begin_frame(uint32_t frame_idx);
+
+		// Returns the offset of size bytes in the buffer, aligned for dynamic offsets,
+		// and their mapped memory in data. UINT32_MAX when the frame region is full.
+		uint32_t alloc(uint32_t size, void*& data);
+
+		VkBuffer get_buffer() const;
+
+	private:
+		buffer   buf_;
+		uint8_t* data_ {nullptr};
+		uint64_t frame_size_ {0};
+		uint64_t align_ {0};
+		uint64_t frame_off_ {0};
+		uint64_t used_ {0};
+	};
+}
\ No newline at end of file